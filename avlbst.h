@@ -6,207 +6,1622 @@
 #include <cstdlib>
 #include <cstdint>
 #include <algorithm>
+#include <vector>
 #include "bst.h"
+#include "forkjoin.h"
 
 struct KeyError { };
 
+/**
+* The default value merge for AVLTree::unionWith() and intersectWith():
+* the other tree's value wins, as if its items had been inserted.
+*/
+struct KeepTheirs
+{
+    template<typename V>
+    V operator()(V&, V& theirs) const { return std::move(theirs); }
+};
+
 /**
 * A special kind of node for an AVL tree, which adds the balance as a data member, plus
 * other additional helper functions. You do NOT need to implement any functionality or
 * add additional data members or helper functions.
 */
-template <typename Key, typename Value>
-class AVLNode : public Node<Key, Value>
+template <typename Key, typename Value>
+class AVLNode : public Node<Key, Value>
+{
+public:
+    // Constructor/destructor.
+    AVLNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent);
+    AVLNode(Key&& key, Value&& value, AVLNode<Key, Value>* parent);
+    ~AVLNode();
+
+    // Getter/setter for the node's height.
+    int8_t getBalance () const;
+    void setBalance (int8_t balance);
+    void updateBalance(int8_t diff);
+
+    // Getters for parent, left, and right. These need to be redefined since they
+    // return pointers to AVLNodes - not plain Nodes. They hide (rather than
+    // override) the Node versions, so the cast is resolved at compile time.
+    // See the Node class in bst.h for more information.
+    AVLNode<Key, Value>* getParent() const;
+    AVLNode<Key, Value>* getLeft() const;
+    AVLNode<Key, Value>* getRight() const;
+
+protected:
+    int8_t balance_;    // effectively a signed char
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the AVLNode class.
+  -------------------------------------------------
+*/
+
+/**
+* An explicit constructor to initialize the elements by calling the base class constructor
+*/
+template<class Key, class Value>
+AVLNode<Key, Value>::AVLNode(const Key& key, const Value& value, AVLNode<Key, Value> *parent) :
+    Node<Key, Value>(key, value, parent), balance_(0)
+{
+
+}
+
+/**
+* Same as above, moving the key and value into the node.
+*/
+template<class Key, class Value>
+AVLNode<Key, Value>::AVLNode(Key&& key, Value&& value, AVLNode<Key, Value> *parent) :
+    Node<Key, Value>(std::move(key), std::move(value), parent), balance_(0)
+{
+
+}
+
+/**
+* A destructor which does nothing.
+*/
+template<class Key, class Value>
+AVLNode<Key, Value>::~AVLNode()
+{
+
+}
+
+/**
+* A getter for the balance of a AVLNode.
+*/
+template<class Key, class Value>
+int8_t AVLNode<Key, Value>::getBalance() const
+{
+    return balance_;
+}
+
+/**
+* A setter for the balance of a AVLNode.
+*/
+template<class Key, class Value>
+void AVLNode<Key, Value>::setBalance(int8_t balance)
+{
+    balance_ = balance;
+}
+
+/**
+* Adds diff to the balance of a AVLNode.
+*/
+template<class Key, class Value>
+void AVLNode<Key, Value>::updateBalance(int8_t diff)
+{
+    balance_ += diff;
+}
+
+/**
+* A redeclared getter for the parent since a static_cast is necessary to make sure
+* that our node is a AVLNode. Every node in an AVLTree is an AVLNode, so the cast
+* is always valid.
+*/
+template<class Key, class Value>
+AVLNode<Key, Value> *AVLNode<Key, Value>::getParent() const
+{
+    return static_cast<AVLNode<Key, Value>*>(Node<Key, Value>::getParent());
+}
+
+/**
+* Overridden for the same reasons as above.
+*/
+template<class Key, class Value>
+AVLNode<Key, Value> *AVLNode<Key, Value>::getLeft() const
+{
+    return static_cast<AVLNode<Key, Value>*>(this->left_);
+}
+
+/**
+* Overridden for the same reasons as above.
+*/
+template<class Key, class Value>
+AVLNode<Key, Value> *AVLNode<Key, Value>::getRight() const
+{
+    return static_cast<AVLNode<Key, Value>*>(this->right_);
+}
+
+
+/*
+  -----------------------------------------------
+  End implementations for the AVLNode class.
+  -----------------------------------------------
+*/
+
+
+/**
+* A compact AVL node that stores its balance in the low bits of the parent
+* link instead of a separate byte. For an 8-byte aligned node that removes
+* the padded balance word, e.g. 48 -> 40 bytes for AVLNode<uint64_t,uint64_t>.
+* The balance is kept as balance + 2 so the transient +/-2 seen right before
+* a rotation also fits, which needs three tag bits (pointers must be 8-byte
+* aligned, i.e. a 64-bit target).
+*/
+template <typename Key, typename Value>
+class PackedAVLNode : public Node<Key, Value>
+{
+public:
+    PackedAVLNode(const Key& key, const Value& value, PackedAVLNode<Key, Value>* parent);
+    PackedAVLNode(Key&& key, Value&& value, PackedAVLNode<Key, Value>* parent);
+
+    int8_t getBalance () const;
+    void setBalance (int8_t balance);
+    void updateBalance(int8_t diff);
+
+    PackedAVLNode<Key, Value>* getParent() const;
+    PackedAVLNode<Key, Value>* getLeft() const;
+    PackedAVLNode<Key, Value>* getRight() const;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the PackedAVLNode class.
+  -------------------------------------------------
+*/
+
+/**
+* An explicit constructor, which starts the node with a balance of 0.
+*/
+template<class Key, class Value>
+PackedAVLNode<Key, Value>::PackedAVLNode(const Key& key, const Value& value, PackedAVLNode<Key, Value> *parent) :
+    Node<Key, Value>(key, value, parent)
+{
+    static_assert(Node<Key, Value>::kParentTagMask >= 7, "PackedAVLNode needs 8-byte aligned nodes");
+    setBalance(0);
+}
+
+/**
+* Same as above, moving the key and value into the node.
+*/
+template<class Key, class Value>
+PackedAVLNode<Key, Value>::PackedAVLNode(Key&& key, Value&& value, PackedAVLNode<Key, Value> *parent) :
+    Node<Key, Value>(std::move(key), std::move(value), parent)
+{
+    setBalance(0);
+}
+
+/**
+* A getter for the balance, decoded from the parent link tag.
+*/
+template<class Key, class Value>
+int8_t PackedAVLNode<Key, Value>::getBalance() const
+{
+    return static_cast<int8_t>(this->getParentTag()) - 2;
+}
+
+/**
+* A setter for the balance, which must be in [-2, 2].
+*/
+template<class Key, class Value>
+void PackedAVLNode<Key, Value>::setBalance(int8_t balance)
+{
+    this->setParentTag(static_cast<std::uintptr_t>(balance + 2));
+}
+
+/**
+* Adds diff to the balance.
+*/
+template<class Key, class Value>
+void PackedAVLNode<Key, Value>::updateBalance(int8_t diff)
+{
+    setBalance(getBalance() + diff);
+}
+
+/**
+* Redeclared getter for the parent, see AVLNode.
+*/
+template<class Key, class Value>
+PackedAVLNode<Key, Value> *PackedAVLNode<Key, Value>::getParent() const
+{
+    return static_cast<PackedAVLNode<Key, Value>*>(Node<Key, Value>::getParent());
+}
+
+/**
+* Redeclared getter for the left child, see AVLNode.
+*/
+template<class Key, class Value>
+PackedAVLNode<Key, Value> *PackedAVLNode<Key, Value>::getLeft() const
+{
+    return static_cast<PackedAVLNode<Key, Value>*>(this->left_);
+}
+
+/**
+* Redeclared getter for the right child, see AVLNode.
+*/
+template<class Key, class Value>
+PackedAVLNode<Key, Value> *PackedAVLNode<Key, Value>::getRight() const
+{
+    return static_cast<PackedAVLNode<Key, Value>*>(this->right_);
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the PackedAVLNode class.
+  -----------------------------------------------
+*/
+
+/**
+* An AVL node that also records the size of its subtree, which lets an
+* AVLTree answer select(k) and rank(key) and advance iterators in
+* O(log n). It costs one extra word per node, so it is opt-in:
+* AVLTree<Key, Value, Compare, SizedAVLNode<Key, Value> >.
+*/
+template <typename Key, typename Value>
+class SizedAVLNode : public AVLNode<Key, Value>
+{
+public:
+    SizedAVLNode(const Key& key, const Value& value, SizedAVLNode<Key, Value>* parent);
+    SizedAVLNode(Key&& key, Value&& value, SizedAVLNode<Key, Value>* parent);
+
+    std::size_t getSize() const;
+    void setSize(std::size_t size);
+
+    SizedAVLNode<Key, Value>* getParent() const;
+    SizedAVLNode<Key, Value>* getLeft() const;
+    SizedAVLNode<Key, Value>* getRight() const;
+
+protected:
+    std::size_t size_;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the SizedAVLNode class.
+  -------------------------------------------------
+*/
+
+/**
+* An explicit constructor for a new leaf, whose subtree is just itself.
+*/
+template<class Key, class Value>
+SizedAVLNode<Key, Value>::SizedAVLNode(const Key& key, const Value& value, SizedAVLNode<Key, Value> *parent) :
+    AVLNode<Key, Value>(key, value, parent), size_(1)
+{
+
+}
+
+/**
+* Same as above, moving the key and value into the node.
+*/
+template<class Key, class Value>
+SizedAVLNode<Key, Value>::SizedAVLNode(Key&& key, Value&& value, SizedAVLNode<Key, Value> *parent) :
+    AVLNode<Key, Value>(std::move(key), std::move(value), parent), size_(1)
+{
+
+}
+
+/**
+* A getter for the number of nodes in this node's subtree.
+*/
+template<class Key, class Value>
+std::size_t SizedAVLNode<Key, Value>::getSize() const
+{
+    return size_;
+}
+
+/**
+* A setter for the number of nodes in this node's subtree.
+*/
+template<class Key, class Value>
+void SizedAVLNode<Key, Value>::setSize(std::size_t size)
+{
+    size_ = size;
+}
+
+/**
+* Redeclared getter for the parent, see AVLNode.
+*/
+template<class Key, class Value>
+SizedAVLNode<Key, Value> *SizedAVLNode<Key, Value>::getParent() const
+{
+    return static_cast<SizedAVLNode<Key, Value>*>(Node<Key, Value>::getParent());
+}
+
+/**
+* Redeclared getter for the left child, see AVLNode.
+*/
+template<class Key, class Value>
+SizedAVLNode<Key, Value> *SizedAVLNode<Key, Value>::getLeft() const
+{
+    return static_cast<SizedAVLNode<Key, Value>*>(this->left_);
+}
+
+/**
+* Redeclared getter for the right child, see AVLNode.
+*/
+template<class Key, class Value>
+SizedAVLNode<Key, Value> *SizedAVLNode<Key, Value>::getRight() const
+{
+    return static_cast<SizedAVLNode<Key, Value>*>(this->right_);
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the SizedAVLNode class.
+  -----------------------------------------------
+*/
+
+/**
+* True for node types that keep their subtree size (getSize/setSize),
+* such as SizedAVLNode. AVLTree only maintains sizes for those.
+*/
+template<typename N, typename = void>
+struct HasSubtreeSize : std::false_type { };
+
+template<typename N>
+struct HasSubtreeSize<N, typename VoidType<decltype(std::declval<const N&>().getSize())>::type> : std::true_type { };
+
+
+
+/**
+* An AVL node that also links to its neighbours in key order, so that
+* iterators of an AVLTree over it take one step per ++ or -- instead of
+* climbing parent links. The links cost two words per node and are kept
+* up by every update of the tree, so they are opt-in:
+* AVLTree<Key, Value, Compare, ThreadedAVLNode<Key, Value> >.
+*/
+template <typename Key, typename Value>
+class ThreadedAVLNode : public AVLNode<Key, Value>
+{
+public:
+    ThreadedAVLNode(const Key& key, const Value& value, ThreadedAVLNode<Key, Value>* parent);
+    ThreadedAVLNode(Key&& key, Value&& value, ThreadedAVLNode<Key, Value>* parent);
+
+    ThreadedAVLNode<Key, Value>* getPrev() const;
+    ThreadedAVLNode<Key, Value>* getNext() const;
+    void setPrev(ThreadedAVLNode<Key, Value>* prev);
+    void setNext(ThreadedAVLNode<Key, Value>* next);
+
+    ThreadedAVLNode<Key, Value>* getParent() const;
+    ThreadedAVLNode<Key, Value>* getLeft() const;
+    ThreadedAVLNode<Key, Value>* getRight() const;
+
+protected:
+    ThreadedAVLNode<Key, Value>* prev_;
+    ThreadedAVLNode<Key, Value>* next_;
+};
+
+/*
+  ----------------------------------------------------
+  Begin implementations for the ThreadedAVLNode class.
+  ----------------------------------------------------
+*/
+
+/**
+* An explicit constructor for a node that is not linked to any other yet.
+*/
+template<class Key, class Value>
+ThreadedAVLNode<Key, Value>::ThreadedAVLNode(const Key& key, const Value& value, ThreadedAVLNode<Key, Value> *parent) :
+    AVLNode<Key, Value>(key, value, parent), prev_(NULL), next_(NULL)
+{
+
+}
+
+/**
+* Same as above, moving the key and value into the node.
+*/
+template<class Key, class Value>
+ThreadedAVLNode<Key, Value>::ThreadedAVLNode(Key&& key, Value&& value, ThreadedAVLNode<Key, Value> *parent) :
+    AVLNode<Key, Value>(std::move(key), std::move(value), parent), prev_(NULL), next_(NULL)
+{
+
+}
+
+/**
+* A getter for the node before this one in key order, or NULL.
+*/
+template<class Key, class Value>
+ThreadedAVLNode<Key, Value> *ThreadedAVLNode<Key, Value>::getPrev() const
+{
+    return prev_;
+}
+
+/**
+* A getter for the node after this one in key order, or NULL.
+*/
+template<class Key, class Value>
+ThreadedAVLNode<Key, Value> *ThreadedAVLNode<Key, Value>::getNext() const
+{
+    return next_;
+}
+
+/**
+* A setter for the node before this one in key order.
+*/
+template<class Key, class Value>
+void ThreadedAVLNode<Key, Value>::setPrev(ThreadedAVLNode<Key, Value>* prev)
+{
+    prev_ = prev;
+}
+
+/**
+* A setter for the node after this one in key order.
+*/
+template<class Key, class Value>
+void ThreadedAVLNode<Key, Value>::setNext(ThreadedAVLNode<Key, Value>* next)
+{
+    next_ = next;
+}
+
+/**
+* Redeclared getter for the parent, see AVLNode.
+*/
+template<class Key, class Value>
+ThreadedAVLNode<Key, Value> *ThreadedAVLNode<Key, Value>::getParent() const
+{
+    return static_cast<ThreadedAVLNode<Key, Value>*>(Node<Key, Value>::getParent());
+}
+
+/**
+* Redeclared getter for the left child, see AVLNode.
+*/
+template<class Key, class Value>
+ThreadedAVLNode<Key, Value> *ThreadedAVLNode<Key, Value>::getLeft() const
+{
+    return static_cast<ThreadedAVLNode<Key, Value>*>(this->left_);
+}
+
+/**
+* Redeclared getter for the right child, see AVLNode.
+*/
+template<class Key, class Value>
+ThreadedAVLNode<Key, Value> *ThreadedAVLNode<Key, Value>::getRight() const
+{
+    return static_cast<ThreadedAVLNode<Key, Value>*>(this->right_);
+}
+
+/*
+  --------------------------------------------------
+  End implementations for the ThreadedAVLNode class.
+  --------------------------------------------------
+*/
+
+/**
+* True for node types that link to their in-order neighbours
+* (getPrev/getNext), such as ThreadedAVLNode. AVLTree only maintains
+* the links for those.
+*/
+template<typename N, typename = void>
+struct HasThreads : std::false_type { };
+
+template<typename N>
+struct HasThreads<N, typename VoidType<decltype(std::declval<const N&>().getNext())>::type> : std::true_type { };
+
+
+/**
+* A self-balancing AVL tree. Compare orders the keys as in BinarySearchTree.
+* NodeType selects the node layout: the default AVLNode keeps the balance in
+* its own byte, while PackedAVLNode hides it in the parent link to save a
+* word per node. Any node type with the AVLNode interface
+* (getBalance/setBalance/updateBalance and typed getters) works.
+* With SizedAVLNode the tree also supports the order statistics
+* select(), rank() and iterator += n, and with ThreadedAVLNode its
+* iterators step in O(1) worst case.
+*/
+template <class Key, class Value, class Compare = std::less<Key>, class NodeType = AVLNode<Key, Value> >
+class AVLTree : public BinarySearchTree<Key, Value, Compare>
+{
+public:
+    AVLTree();
+    explicit AVLTree(const Compare& comp);
+    template<typename ForwardIterator>
+    AVLTree(ForwardIterator first, ForwardIterator last, const Compare& comp = Compare());
+    AVLTree(const AVLTree& other);
+    AVLTree(AVLTree&& other);
+    AVLTree& operator=(const AVLTree& other);
+    AVLTree& operator=(AVLTree&& other);
+    void swap(AVLTree& other);
+
+    /**
+    * The BST iterator plus O(log n) random steps, which need a node
+    * type that keeps subtree sizes. Every BST iterator converts to it.
+    */
+    class iterator : public BinarySearchTree<Key, Value, Compare>::iterator
+    {
+    public:
+        iterator();
+        iterator(const typename BinarySearchTree<Key, Value, Compare>::iterator& it);
+
+        iterator& operator+=(std::ptrdiff_t n);
+
+    protected:
+        friend class AVLTree<Key, Value, Compare, NodeType>;
+        iterator(NodeType* ptr, const AVLTree<Key, Value, Compare, NodeType>* tree);
+    };
+
+    // Order statistics, only available with a sized node type
+    iterator select(std::size_t k) const;
+    std::size_t rank(const Key& key) const;
+
+    // Splitting at a key and joining around a pivot, both O(log n).
+    // Nodes change trees without being copied, so the trees involved
+    // share their node pools from then on (see NodePool::share()).
+    bool split(const Key& key, AVLTree& less, AVLTree& greater);
+    void join(AVLTree& left, const std::pair<const Key, Value>& pivot, AVLTree& right);
+
+    // Set operations by join-based divide and conquer, in
+    // O(m log(n/m + 1)) work for trees of m <= n items, with the two
+    // halves of each level running in parallel. other is left empty:
+    // its nodes are either reused here or destroyed. For a key in both
+    // trees the value becomes merge(ours, theirs), which may move from
+    // either and must not throw, as it can run on several threads.
+    template<typename Merge>
+    void unionWith(AVLTree& other, Merge merge);
+    void unionWith(AVLTree& other);
+    template<typename Merge>
+    void intersectWith(AVLTree& other, Merge merge);
+    void intersectWith(AVLTree& other);
+    void differenceWith(AVLTree& other);
+
+protected:
+    virtual void nodeSwap( NodeType* n1, NodeType* n2);
+
+    // Add helper functions here
+    bool addUpdate(NodeType* parent, NodeType* node);
+    void rotateLeft(NodeType* node);
+    void rotateRight(NodeType* node);
+    void removeUpdate(NodeType* parent, int diff);
+
+    // Subtree size upkeep, which compiles away for unsized node types
+    typedef HasSubtreeSize<NodeType> Sized;
+    static std::size_t subtreeSize(const NodeType* node);
+    static void updateSize(NodeType* node, std::true_type sized);
+    static void updateSize(NodeType*, std::false_type) { }
+    static void adjustSizes(NodeType* node, bool grow, std::true_type sized);
+    static void adjustSizes(NodeType*, bool, std::false_type) { }
+    static void copySize(NodeType* to, const NodeType* from, std::true_type sized);
+    static void copySize(NodeType*, const NodeType*, std::false_type) { }
+    static void swapSizes(NodeType* n1, NodeType* n2, std::true_type sized);
+    static void swapSizes(NodeType*, NodeType*, std::false_type) { }
+    static NodeType* selectNode(NodeType* root, std::size_t k);
+
+    // In-order link upkeep, which compiles away for unthreaded node types
+    typedef HasThreads<NodeType> Threaded;
+    static void linkThreads(NodeType* before, NodeType* after, std::true_type threaded);
+    static void linkThreads(NodeType*, NodeType*, std::false_type) { }
+    static void threadNode(NodeType* node, std::true_type threaded);
+    static void threadNode(NodeType*, std::false_type) { }
+    static void unthreadNode(NodeType* node, std::true_type threaded);
+    static void unthreadNode(NodeType*, std::false_type) { }
+    static void swapThreads(NodeType* n1, NodeType* n2, std::true_type threaded);
+    static void swapThreads(NodeType*, NodeType*, std::false_type) { }
+    static Node<Key, Value>* nextThread(NodeType* node, std::true_type threaded);
+    static Node<Key, Value>* nextThread(NodeType* node, std::false_type) { return AVLTree::successor(node); }
+    static Node<Key, Value>* prevThread(NodeType* node, std::true_type threaded);
+    static Node<Key, Value>* prevThread(NodeType* node, std::false_type) { return AVLTree::predecessor(node); }
+    void rethread(std::true_type threaded);
+    void rethread(std::false_type) { }
+
+    // Split and join of detached subtrees, which carry their heights
+    // along so that neither has to measure a tree
+    static int subtreeHeight(const NodeType* node);
+    NodeType* joinNodes(NodeType* left, int leftHeight, NodeType* pivot, NodeType* right, int rightHeight, int& height);
+    void splitNodes(NodeType* root, int height, const Key& key,
+                    NodeType*& less, int& lessHeight, NodeType*& equal, NodeType*& greater, int& greaterHeight);
+    static void detachChildren(NodeType* root, int height, NodeType*& left, int& leftHeight, NodeType*& right, int& rightHeight);
+    NodeType* joinPair(NodeType* left, int leftHeight, NodeType* right, int rightHeight, int& height);
+
+    // The recursions behind the set operations. Nodes that leave the
+    // result are collected in dropped and destroyed afterwards, because
+    // the node pool can't be used from several threads at once.
+    template<typename Merge>
+    NodeType* unionNodes(NodeType* a, int aHeight, NodeType* b, int bHeight, int& height,
+                         const Merge& merge, std::vector<NodeType*>& dropped, int depth);
+    template<typename Merge>
+    NodeType* intersectNodes(NodeType* a, int aHeight, NodeType* b, int bHeight, int& height,
+                             const Merge& merge, std::vector<NodeType*>& dropped, int depth);
+    NodeType* differenceNodes(NodeType* a, int aHeight, NodeType* b, int bHeight, int& height,
+                              std::vector<NodeType*>& dropped, int depth);
+    template<typename Operation>
+    void combineWith(AVLTree& other, Operation operation);
+    // subtrees lower than this are not worth a thread of their own
+    static const int kForkHeight = 12;
+
+    void adopt(NodeType* root, AVLTree& from);
+    void adoptSize(NodeType* root, std::true_type sized);
+    void adoptSize(NodeType*, std::false_type) { this->sizeKnown_ = false; }
+
+    virtual void eraseNode(Node<Key, Value>* node);
+    virtual void eraseRange(Node<Key, Value>* first, Node<Key, Value>* last);
+    virtual Node<Key, Value>* createNode(const Key& key, const Value& value, Node<Key, Value>* parent);
+    virtual Node<Key, Value>* createNode(Key&& key, Value&& value, Node<Key, Value>* parent);
+    virtual Node<Key, Value>* placeNode(void* slot, Key&& key, Value&& value);
+    virtual void insertFixup(Node<Key, Value>* node);
+    virtual Node<Key, Value>* cloneNode(const Node<Key, Value>* source, Node<Key, Value>* parent);
+    virtual void buildFixup(Node<Key, Value>* node, int leftHeight, int rightHeight);
+    virtual void rebuiltFixup();
+    virtual Node<Key, Value>* nextNode(Node<Key, Value>* node) const;
+    virtual Node<Key, Value>* prevNode(Node<Key, Value>* node) const;
+
+
+
+};
+
+/**
+* Default constructor, which sizes the node pool for the tree's node type.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+AVLTree<Key, Value, Compare, NodeType>::AVLTree() :
+    BinarySearchTree<Key, Value, Compare>(sizeof(NodeType), alignof(NodeType))
+{
+    this->threaded_ = Threaded::value;
+}
+
+/**
+* Constructor for an empty tree ordered by the given comparator.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+AVLTree<Key, Value, Compare, NodeType>::AVLTree(const Compare& comp) :
+    BinarySearchTree<Key, Value, Compare>(sizeof(NodeType), alignof(NodeType), comp)
+{
+    this->threaded_ = Threaded::value;
+}
+
+/**
+* Constructs a tree holding the items of a sorted range in O(n),
+* see BinarySearchTree::assign().
+*/
+template<class Key, class Value, class Compare, class NodeType>
+template<typename ForwardIterator>
+AVLTree<Key, Value, Compare, NodeType>::AVLTree(ForwardIterator first, ForwardIterator last, const Compare& comp) :
+    BinarySearchTree<Key, Value, Compare>(sizeof(NodeType), alignof(NodeType), comp)
+{
+    // the base class cannot do this, our hooks aren't set up until now
+    this->threaded_ = Threaded::value;
+    this->assign(first, last);
+}
+
+/**
+* Copy constructor, which copies the shape and balance factors of other
+* in O(n) without any rotations.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+AVLTree<Key, Value, Compare, NodeType>::AVLTree(const AVLTree& other) :
+    BinarySearchTree<Key, Value, Compare>(sizeof(NodeType), alignof(NodeType), other.comp_)
+{
+    // as with the range constructor, cloneNode() only reaches us from here
+    this->threaded_ = Threaded::value;
+    this->cloneFrom(other);
+}
+
+/**
+* Move constructor, O(1). other is left empty.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+AVLTree<Key, Value, Compare, NodeType>::AVLTree(AVLTree&& other) :
+    BinarySearchTree<Key, Value, Compare>(std::move(other))
+{
+
+}
+
+/**
+* Copy assignment, see the copy constructor.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+AVLTree<Key, Value, Compare, NodeType>& AVLTree<Key, Value, Compare, NodeType>::operator=(const AVLTree& other)
+{
+    BinarySearchTree<Key, Value, Compare>::operator=(other);
+    return *this;
+}
+
+/**
+* Move assignment, O(1) apart from destroying the old items.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+AVLTree<Key, Value, Compare, NodeType>& AVLTree<Key, Value, Compare, NodeType>::operator=(AVLTree&& other)
+{
+    BinarySearchTree<Key, Value, Compare>::operator=(std::move(other));
+    return *this;
+}
+
+/**
+* Exchanges the contents of two trees in O(1), see
+* BinarySearchTree::swap(). Both must have the same node type.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+void AVLTree<Key, Value, Compare, NodeType>::swap(AVLTree& other)
+{
+    BinarySearchTree<Key, Value, Compare>::swap(other);
+}
+
+/**
+* Non-member swap, so that swap(a, b) finds the O(1) version.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+void swap(AVLTree<Key, Value, Compare, NodeType>& a, AVLTree<Key, Value, Compare, NodeType>& b)
+{
+    a.swap(b);
+}
+
+/**
+* Default constructor, which makes an end() iterator.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+AVLTree<Key, Value, Compare, NodeType>::iterator::iterator()
+{
+
+}
+
+/**
+* Converts any iterator of the underlying BST, e.g. the result of find().
+*/
+template<class Key, class Value, class Compare, class NodeType>
+AVLTree<Key, Value, Compare, NodeType>::iterator::iterator(const typename BinarySearchTree<Key, Value, Compare>::iterator& it) :
+    BinarySearchTree<Key, Value, Compare>::iterator(it)
+{
+
+}
+
+/**
+* Constructor that points the iterator at the given node.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+AVLTree<Key, Value, Compare, NodeType>::iterator::iterator(NodeType* ptr, const AVLTree<Key, Value, Compare, NodeType>* tree)
+{
+    this->current_ = ptr;
+    this->tree_ = tree;
+}
+
+/**
+* Moves the iterator n items forward (or back, for negative n) in
+* O(log n). The iterator must not be end(). Stepping outside the tree
+* gives end().
+*/
+template<class Key, class Value, class Compare, class NodeType>
+typename AVLTree<Key, Value, Compare, NodeType>::iterator&
+AVLTree<Key, Value, Compare, NodeType>::iterator::operator+=(std::ptrdiff_t n)
+{
+    static_assert(Sized::value, "iterator += n needs a node type with subtree sizes, e.g. SizedAVLNode");
+    // find our own rank on the way up to the root
+    NodeType* node = static_cast<NodeType*>(this->current_);
+    std::size_t index = subtreeSize(node->getLeft());
+    while (node->getParent() != NULL) {
+      if (node->getParent()->getRight() == node) {
+        index += subtreeSize(node->getParent()->getLeft()) + 1;
+      }
+      node = node->getParent();
+    }
+    this->current_ = selectNode(node, index + n);
+    return *this;
+}
+
+/**
+* Returns an iterator to the item with k items before it (k = 0 is
+* the smallest), or end() if the tree has no more than k items.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+typename AVLTree<Key, Value, Compare, NodeType>::iterator
+AVLTree<Key, Value, Compare, NodeType>::select(std::size_t k) const
+{
+    static_assert(Sized::value, "select() needs a node type with subtree sizes, e.g. SizedAVLNode");
+    return iterator(selectNode(static_cast<NodeType*>(this->root_), k), this);
+}
+
+/**
+* Returns the number of keys in the tree that come before key, which
+* is also the position key has or would have in the tree.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+std::size_t AVLTree<Key, Value, Compare, NodeType>::rank(const Key& key) const
+{
+    static_assert(Sized::value, "rank() needs a node type with subtree sizes, e.g. SizedAVLNode");
+    std::size_t index = 0;
+    NodeType* node = static_cast<NodeType*>(this->root_);
+    while (node != NULL) {
+      if (this->comp_(node->getKey(), key)) {
+        // node and its left subtree all come before key
+        index += subtreeSize(node->getLeft()) + 1;
+        node = node->getRight();
+      } else {
+        node = node->getLeft();
+      }
+    }
+    return index;
+}
+
+/**
+* Gives a cloned node the subtree size of its source.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+void AVLTree<Key, Value, Compare, NodeType>::copySize(NodeType* to, const NodeType* from, std::true_type)
+{
+    to->setSize(from->getSize());
+}
+
+/**
+* Exchanges the subtree sizes of two nodes, whose positions were swapped.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+void AVLTree<Key, Value, Compare, NodeType>::swapSizes(NodeType* n1, NodeType* n2, std::true_type)
+{
+    std::size_t size = n1->getSize();
+    n1->setSize(n2->getSize());
+    n2->setSize(size);
+}
+
+/**
+* Finds the node with k nodes before it under root, or NULL.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+NodeType* AVLTree<Key, Value, Compare, NodeType>::selectNode(NodeType* root, std::size_t k)
+{
+    NodeType* node = root;
+    while (node != NULL) {
+      std::size_t leftsize = subtreeSize(node->getLeft());
+      if (k < leftsize) {
+        node = node->getLeft();
+      } else if (k == leftsize) {
+        return node;
+      } else {
+        k -= leftsize + 1;
+        node = node->getRight();
+      }
+    }
+    return NULL;
+}
+
+/**
+* Returns the size of the subtree under node, 0 for NULL.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+std::size_t AVLTree<Key, Value, Compare, NodeType>::subtreeSize(const NodeType* node)
 {
-public:
-    // Constructor/destructor.
-    AVLNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent);
-    virtual ~AVLNode();
-
-    // Getter/setter for the node's height.
-    int8_t getBalance () const;
-    void setBalance (int8_t balance);
-    void updateBalance(int8_t diff);
+    return node == NULL ? 0 : node->getSize();
+}
 
-    // Getters for parent, left, and right. These need to be redefined since they
-    // return pointers to AVLNodes - not plain Nodes. See the Node class in bst.h
-    // for more information.
-    virtual AVLNode<Key, Value>* getParent() const override;
-    virtual AVLNode<Key, Value>* getLeft() const override;
-    virtual AVLNode<Key, Value>* getRight() const override;
+/**
+* Recomputes the subtree size of node from its children, used after
+* a rotation has given it new ones.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+void AVLTree<Key, Value, Compare, NodeType>::updateSize(NodeType* node, std::true_type)
+{
+    node->setSize(1 + subtreeSize(node->getLeft()) + subtreeSize(node->getRight()));
+}
 
-protected:
-    int8_t balance_;    // effectively a signed char
-};
+/**
+* Adds or removes one from the subtree size of node and every node
+* above it, after a leaf was linked in or spliced out below node.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+void AVLTree<Key, Value, Compare, NodeType>::adjustSizes(NodeType* node, bool grow, std::true_type)
+{
+    for (; node != NULL; node = node->getParent()) {
+      node->setSize(grow ? node->getSize() + 1 : node->getSize() - 1);
+    }
+}
 
-/*
-  -------------------------------------------------
-  Begin implementations for the AVLNode class.
-  -------------------------------------------------
+/**
+* Links before and after as neighbours in key order. Either may be NULL
+* at the ends of the tree.
 */
+template<class Key, class Value, class Compare, class NodeType>
+void AVLTree<Key, Value, Compare, NodeType>::linkThreads(NodeType* before, NodeType* after, std::true_type)
+{
+    if (before != NULL) {
+      before->setNext(after);
+    }
+    if (after != NULL) {
+      after->setPrev(before);
+    }
+}
 
 /**
-* An explicit constructor to initialize the elements by calling the base class constructor
+* Links a new leaf in between its neighbours: a left child comes right
+* before its parent, a right child right after it.
 */
-template<class Key, class Value>
-AVLNode<Key, Value>::AVLNode(const Key& key, const Value& value, AVLNode<Key, Value> *parent) :
-    Node<Key, Value>(key, value, parent), balance_(0)
+template<class Key, class Value, class Compare, class NodeType>
+void AVLTree<Key, Value, Compare, NodeType>::threadNode(NodeType* node, std::true_type threaded)
 {
+    NodeType* parent = node->getParent();
+    if (parent == NULL) {
+      linkThreads(NULL, node, threaded);
+      linkThreads(node, NULL, threaded);
+    } else if (parent->getLeft() == node) {
+      linkThreads(parent->getPrev(), node, threaded);
+      linkThreads(node, parent, threaded);
+    } else {
+      linkThreads(node, parent->getNext(), threaded);
+      linkThreads(parent, node, threaded);
+    }
+}
 
+/**
+* Takes a node that is about to be removed out of the in-order links.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+void AVLTree<Key, Value, Compare, NodeType>::unthreadNode(NodeType* node, std::true_type threaded)
+{
+    linkThreads(node->getPrev(), node->getNext(), threaded);
 }
 
 /**
-* A destructor which does nothing.
+* Exchanges the places of two nodes in the in-order links, to match
+* nodeSwap() exchanging their places in the tree.
 */
-template<class Key, class Value>
-AVLNode<Key, Value>::~AVLNode()
+template<class Key, class Value, class Compare, class NodeType>
+void AVLTree<Key, Value, Compare, NodeType>::swapThreads(NodeType* n1, NodeType* n2, std::true_type threaded)
+{
+    if (n2->getNext() == n1) {
+      std::swap(n1, n2);
+    }
+    NodeType* prev1 = n1->getPrev();
+    NodeType* next1 = n1->getNext();
+    NodeType* prev2 = n2->getPrev();
+    NodeType* next2 = n2->getNext();
+    if (next1 == n2) {
+      // neighbours, n1 first
+      linkThreads(prev1, n2, threaded);
+      linkThreads(n2, n1, threaded);
+      linkThreads(n1, next2, threaded);
+    } else {
+      linkThreads(prev1, n2, threaded);
+      linkThreads(n2, next1, threaded);
+      linkThreads(prev2, n1, threaded);
+      linkThreads(n1, next2, threaded);
+    }
+}
+
+template<class Key, class Value, class Compare, class NodeType>
+Node<Key, Value>* AVLTree<Key, Value, Compare, NodeType>::nextThread(NodeType* node, std::true_type)
 {
+    return node->getNext();
+}
 
+template<class Key, class Value, class Compare, class NodeType>
+Node<Key, Value>* AVLTree<Key, Value, Compare, NodeType>::prevThread(NodeType* node, std::true_type)
+{
+    return node->getPrev();
 }
 
 /**
-* A getter for the balance of a AVLNode.
+* Lays all in-order links anew in one O(n) walk, after the tree was
+* put together in a way that did not keep them.
 */
-template<class Key, class Value>
-int8_t AVLNode<Key, Value>::getBalance() const
+template<class Key, class Value, class Compare, class NodeType>
+void AVLTree<Key, Value, Compare, NodeType>::rethread(std::true_type threaded)
 {
-    return balance_;
+    NodeType* prev = NULL;
+    for (Node<Key, Value>* node = this->smallest_; node != NULL; node = this->successor(node)) {
+      linkThreads(prev, static_cast<NodeType*>(node), threaded);
+      prev = static_cast<NodeType*>(node);
+    }
+    linkThreads(prev, NULL, threaded);
 }
 
 /**
-* A setter for the balance of a AVLNode.
+* A tree built or copied in bulk gets its in-order links afterwards.
 */
-template<class Key, class Value>
-void AVLNode<Key, Value>::setBalance(int8_t balance)
+template<class Key, class Value, class Compare, class NodeType>
+void AVLTree<Key, Value, Compare, NodeType>::rebuiltFixup()
 {
-    balance_ = balance;
+    rethread(Threaded());
 }
 
 /**
-* Adds diff to the balance of a AVLNode.
+* One step along the in-order links, for threaded node types.
 */
-template<class Key, class Value>
-void AVLNode<Key, Value>::updateBalance(int8_t diff)
+template<class Key, class Value, class Compare, class NodeType>
+Node<Key, Value>* AVLTree<Key, Value, Compare, NodeType>::nextNode(Node<Key, Value>* node) const
 {
-    balance_ += diff;
+    return nextThread(static_cast<NodeType*>(node), Threaded());
+}
+
+template<class Key, class Value, class Compare, class NodeType>
+Node<Key, Value>* AVLTree<Key, Value, Compare, NodeType>::prevNode(Node<Key, Value>* node) const
+{
+    return prevThread(static_cast<NodeType*>(node), Threaded());
 }
 
 /**
-* An overridden function for getting the parent since a static_cast is necessary to make sure
-* that our node is a AVLNode.
+* Returns the height of a valid AVL subtree in O(log n) by always
+* stepping into the taller child.
 */
-template<class Key, class Value>
-AVLNode<Key, Value> *AVLNode<Key, Value>::getParent() const
+template<class Key, class Value, class Compare, class NodeType>
+int AVLTree<Key, Value, Compare, NodeType>::subtreeHeight(const NodeType* node)
 {
-    return static_cast<AVLNode<Key, Value>*>(this->parent_);
+    int height = 0;
+    while (node != NULL) {
+      height++;
+      node = node->getBalance() < 0 ? node->getRight() : node->getLeft();
+    }
+    return height;
 }
 
 /**
-* Overridden for the same reasons as above.
+* Joins two detached subtrees, every key of left before pivot and every
+* key of right after it, into one balanced subtree and returns its root.
+* The pivot hangs off the inner spine of the taller tree at the point
+* where the heights match, and the climb back up is just an insertion
+* fixup, so this takes O(|leftHeight - rightHeight| + 1) time.
 */
-template<class Key, class Value>
-AVLNode<Key, Value> *AVLNode<Key, Value>::getLeft() const
+template<class Key, class Value, class Compare, class NodeType>
+NodeType* AVLTree<Key, Value, Compare, NodeType>::joinNodes(NodeType* left, int leftHeight, NodeType* pivot,
+                                                            NodeType* right, int rightHeight, int& height)
 {
-    return static_cast<AVLNode<Key, Value>*>(this->left_);
+    pivot->setParent(NULL);
+    if (leftHeight - rightHeight <= 1 && rightHeight - leftHeight <= 1) {
+      pivot->setLeft(left);
+      pivot->setRight(right);
+      if (left != NULL) {
+        left->setParent(pivot);
+      }
+      if (right != NULL) {
+        right->setParent(pivot);
+      }
+      pivot->setBalance(leftHeight - rightHeight);
+      updateSize(pivot, Sized());
+      height = std::max(leftHeight, rightHeight) + 1;
+      return pivot;
+    }
+
+    // walk down the taller tree until the subtree is no more than one
+    // level taller than the other tree
+    bool leftTaller = leftHeight > rightHeight;
+    NodeType* top = leftTaller ? left : right;
+    int shortHeight = leftTaller ? rightHeight : leftHeight;
+    int h = leftTaller ? leftHeight : rightHeight;
+    NodeType* parent = NULL;
+    NodeType* node = top;
+    while (h > shortHeight + 1) {
+      parent = node;
+      if (leftTaller) {
+        h -= node->getBalance() > 0 ? 2 : 1;
+        node = node->getRight();
+      } else {
+        h -= node->getBalance() < 0 ? 2 : 1;
+        node = node->getLeft();
+      }
+    }
+
+    if (leftTaller) {
+      pivot->setLeft(node);
+      pivot->setRight(right);
+      pivot->setBalance(h - shortHeight);
+      parent->setRight(pivot);
+      if (right != NULL) {
+        right->setParent(pivot);
+      }
+    } else {
+      pivot->setLeft(left);
+      pivot->setRight(node);
+      pivot->setBalance(shortHeight - h);
+      parent->setLeft(pivot);
+      if (left != NULL) {
+        left->setParent(pivot);
+      }
+    }
+    if (node != NULL) {
+      node->setParent(pivot);
+    }
+    pivot->setParent(parent);
+    if (Sized::value) {
+      for (NodeType* n = pivot; n != NULL; n = n->getParent()) {
+        updateSize(n, Sized());
+      }
+    }
+
+    // the pivot's subtree is one level taller than the one it replaced,
+    // exactly as after an insertion. A rotation at the top moves the old
+    // top at most two levels down, so the new top is found from there.
+    bool grew = addUpdate(parent, pivot);
+    NodeType* joined = top;
+    while (joined->getParent() != NULL) {
+      joined = joined->getParent();
+    }
+    height = (leftTaller ? leftHeight : rightHeight) + (grew ? 1 : 0);
+    return joined;
 }
 
 /**
-* Overridden for the same reasons as above.
+* Cuts both subtrees off root, which is left on its own, and works out
+* their heights from root's height and balance.
 */
-template<class Key, class Value>
-AVLNode<Key, Value> *AVLNode<Key, Value>::getRight() const
+template<class Key, class Value, class Compare, class NodeType>
+void AVLTree<Key, Value, Compare, NodeType>::detachChildren(NodeType* root, int height, NodeType*& left, int& leftHeight,
+                                                            NodeType*& right, int& rightHeight)
 {
-    return static_cast<AVLNode<Key, Value>*>(this->right_);
+    left = root->getLeft();
+    right = root->getRight();
+    leftHeight = height - (root->getBalance() < 0 ? 2 : 1);
+    rightHeight = height - (root->getBalance() > 0 ? 2 : 1);
+    if (left != NULL) {
+      left->setParent(NULL);
+    }
+    if (right != NULL) {
+      right->setParent(NULL);
+    }
+    root->setLeft(NULL);
+    root->setRight(NULL);
 }
 
-
-/*
-  -----------------------------------------------
-  End implementations for the AVLNode class.
-  -----------------------------------------------
+/**
+* Splits the detached subtree under root into the nodes before key,
+* the node with key (or NULL) and the nodes after it, each a detached
+* balanced subtree. Every level rejoins the part it cuts off, and the
+* joins telescope to O(log n) in total.
 */
+template<class Key, class Value, class Compare, class NodeType>
+void AVLTree<Key, Value, Compare, NodeType>::splitNodes(NodeType* root, int height, const Key& key,
+                                                        NodeType*& less, int& lessHeight, NodeType*& equal,
+                                                        NodeType*& greater, int& greaterHeight)
+{
+    if (root == NULL) {
+      less = equal = greater = NULL;
+      lessHeight = greaterHeight = 0;
+      return;
+    }
+    NodeType* left;
+    NodeType* right;
+    int leftHeight, rightHeight;
+    detachChildren(root, height, left, leftHeight, right, rightHeight);
 
+    if (this->comp_(key, root->getKey())) {
+      splitNodes(left, leftHeight, key, less, lessHeight, equal, greater, greaterHeight);
+      greater = joinNodes(greater, greaterHeight, root, right, rightHeight, greaterHeight);
+    } else if (this->comp_(root->getKey(), key)) {
+      splitNodes(right, rightHeight, key, less, lessHeight, equal, greater, greaterHeight);
+      less = joinNodes(left, leftHeight, root, less, lessHeight, lessHeight);
+    } else {
+      less = left;
+      lessHeight = leftHeight;
+      equal = root;
+      greater = right;
+      greaterHeight = rightHeight;
+      root->setBalance(0);
+      updateSize(root, Sized());
+    }
+}
 
-template <class Key, class Value>
-class AVLTree : public BinarySearchTree<Key, Value>
+/**
+* Moves the items before key into less and the items after it into
+* greater, discarding whatever those two held before. If key is present
+* its item stays behind as the only item of this tree and true is
+* returned, otherwise this tree ends up empty. less and greater must be
+* two other trees. Without a sized node type their size() has to count
+* the items once afterwards.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+bool AVLTree<Key, Value, Compare, NodeType>::split(const Key& key, AVLTree& less, AVLTree& greater)
 {
-public:
-    virtual void insert(const std::pair<const Key, Value> &new_item); // TODO
-    virtual void remove(const Key& key);  // TODO
-protected:
-    virtual void nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2);
+    less.clear();
+    greater.clear();
+    NodeType* root = static_cast<NodeType*>(this->root_);
+    NodeType* before;
+    NodeType* match;
+    NodeType* after;
+    int beforeHeight, afterHeight;
+    splitNodes(root, subtreeHeight(root), key, before, beforeHeight, match, after, afterHeight);
+    less.adopt(before, *this);
+    greater.adopt(after, *this);
+    this->forgetNodes();
+    // the in-order links only need cutting where the parts met
+    linkThreads(static_cast<NodeType*>(less.largest_), NULL, Threaded());
+    linkThreads(NULL, static_cast<NodeType*>(greater.smallest_), Threaded());
+    if (match != NULL) {
+      this->root_ = match;
+      this->size_ = 1;
+      this->smallest_ = match;
+      this->largest_ = match;
+      linkThreads(NULL, match, Threaded());
+      linkThreads(match, NULL, Threaded());
+    }
+    return match != NULL;
+}
 
-    // Add helper functions here
-    void addUpdate(AVLNode<Key,Value>* parent, AVLNode<Key,Value>* node);
-    void rotateLeft(AVLNode<Key,Value>* node);
-    void rotateRight(AVLNode<Key,Value>* node);
-    void removeUpdate(AVLNode<Key,Value>* parent, int diff);
+/**
+* Replaces the contents of this tree with the items of left, then pivot,
+* then the items of right, leaving left and right empty. Every key in
+* left must come before pivot.first and every key in right after it.
+* This tree may be left or right itself.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+void AVLTree<Key, Value, Compare, NodeType>::join(AVLTree& left, const std::pair<const Key, Value>& pivot, AVLTree& right)
+{
+    if (this != &left && this != &right) {
+      this->clear();
+    }
+    // copying the pivot is all that can throw, so do it before anything moves
+    NodeType* middle = static_cast<NodeType*>(this->createNode(pivot.first, pivot.second, NULL));
+    NodeType* leftRoot = static_cast<NodeType*>(left.root_);
+    NodeType* rightRoot = static_cast<NodeType*>(right.root_);
+    NodeType* leftLast = static_cast<NodeType*>(left.largest_);
+    NodeType* rightFirst = static_cast<NodeType*>(right.smallest_);
+    bool known = left.sizeKnown_ && right.sizeKnown_;
+    std::size_t count = left.size_ + right.size_ + 1;
+    this->pool_.share(left.pool_);
+    this->pool_.share(right.pool_);
+    left.forgetNodes();
+    right.forgetNodes();
+
+    int height;
+    this->root_ = joinNodes(leftRoot, subtreeHeight(leftRoot), middle, rightRoot, subtreeHeight(rightRoot), height);
+    this->size_ = count;
+    this->sizeKnown_ = known;
+    this->resetEnds();
+    linkThreads(leftLast, middle, Threaded());
+    linkThreads(middle, rightFirst, Threaded());
+}
 
+/**
+* Adds the items of other to this tree, see the declaration.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+template<typename Merge>
+void AVLTree<Key, Value, Compare, NodeType>::unionWith(AVLTree& other, Merge merge)
+{
+    combineWith(other, [&](NodeType* a, int aHeight, NodeType* b, int bHeight, int& height, std::vector<NodeType*>& dropped) {
+      return unionNodes(a, aHeight, b, bHeight, height, merge, dropped, forkDepth());
+    });
+}
 
+/**
+* Union in which other's values win for keys in both trees.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+void AVLTree<Key, Value, Compare, NodeType>::unionWith(AVLTree& other)
+{
+    unionWith(other, KeepTheirs());
+}
 
-};
+/**
+* Keeps only the items whose keys are also in other.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+template<typename Merge>
+void AVLTree<Key, Value, Compare, NodeType>::intersectWith(AVLTree& other, Merge merge)
+{
+    combineWith(other, [&](NodeType* a, int aHeight, NodeType* b, int bHeight, int& height, std::vector<NodeType*>& dropped) {
+      return intersectNodes(a, aHeight, b, bHeight, height, merge, dropped, forkDepth());
+    });
+}
 
-/*
- * Recall: If key is already in the tree, you should 
- * overwrite the current value with the updated value.
- */
-template<class Key, class Value>
-void AVLTree<Key, Value>::insert(const std::pair<const Key, Value> &new_item)
+/**
+* Intersection in which other's values win.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+void AVLTree<Key, Value, Compare, NodeType>::intersectWith(AVLTree& other)
 {
-    // TODO
-    // insert as BST and if unbalanced perform rotations
-    // reusing bst insert logic but need to use an AVL node and
-    // check for imbalances with bf as walking up
+    intersectWith(other, KeepTheirs());
+}
 
+/**
+* Removes every item whose key is in other.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+void AVLTree<Key, Value, Compare, NodeType>::differenceWith(AVLTree& other)
+{
+    if (&other == this) {
+      this->clear();
+      return;
+    }
+    combineWith(other, [&](NodeType* a, int aHeight, NodeType* b, int bHeight, int& height, std::vector<NodeType*>& dropped) {
+      return differenceNodes(a, aHeight, b, bHeight, height, dropped, forkDepth());
+    });
+}
 
-    // TODO
-    // start from parent and walk through, left if smaller
-    // go right if bigger 
-    AVLNode<Key, Value>* child = static_cast<AVLNode<Key, Value>*>(this->root_);
-    // keep track of the child value and parent is the one previous so can change
-    // linkage when correct spot is found
-    AVLNode<Key, Value>* parent = NULL;
-
-
-    // empty tree case
-    if (child == NULL) {
-      AVLNode<Key, Value>* addednode = new AVLNode<Key, Value>(new_item.first, new_item.second, NULL);
-      this->root_ = addednode;
-      addednode->setBalance(0);
+/**
+* Takes the nodes of both trees, lets operation build the result out
+* of them and then destroys the nodes it dropped. Combining a tree with
+* itself changes nothing.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+template<typename Operation>
+void AVLTree<Key, Value, Compare, NodeType>::combineWith(AVLTree& other, Operation operation)
+{
+    if (&other == this) {
       return;
     }
-    while (child != NULL) {
-      if (new_item.first < child->getKey()) {
-        // parent is now the old child, reassign child
-        parent = child;
-        child = child->getLeft();
-      } else if (new_item.first > child->getKey()) {
-        parent = child;
-        child = child->getRight();
-      } else {
-        // key already exists
-        child->setValue(new_item.second);
-        return;
+    NodeType* a = static_cast<NodeType*>(this->root_);
+    NodeType* b = static_cast<NodeType*>(other.root_);
+    bool known = this->sizeKnown_ && other.sizeKnown_;
+    std::size_t count = this->size_ + other.size_;
+    this->pool_.share(other.pool_);
+    this->forgetNodes();
+    other.forgetNodes();
+
+    std::vector<NodeType*> dropped;
+    int height;
+    this->root_ = operation(a, subtreeHeight(a), b, subtreeHeight(b), height, dropped);
+    this->size_ = count;
+    this->sizeKnown_ = known;
+    // every dropped subtree is detached, so this doesn't reach the result
+    for (std::size_t i = 0; i < dropped.size(); i++) {
+      this->clearHelper(dropped[i]);
+    }
+    this->resetEnds();
+    // the result interleaves both trees, so its links are laid anew
+    rethread(Threaded());
+}
+
+/**
+* Union of two detached subtrees: a's root splits b, and the two
+* halves are merged independently before being joined around it.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+template<typename Merge>
+NodeType* AVLTree<Key, Value, Compare, NodeType>::unionNodes(NodeType* a, int aHeight, NodeType* b, int bHeight, int& height,
+                                                             const Merge& merge, std::vector<NodeType*>& dropped, int depth)
+{
+    if (a == NULL || b == NULL) {
+      height = (a == NULL) ? bHeight : aHeight;
+      return (a == NULL) ? b : a;
+    }
+    NodeType *aLeft, *aRight, *bLeft, *match, *bRight;
+    int aLeftHeight, aRightHeight, bLeftHeight, bRightHeight;
+    detachChildren(a, aHeight, aLeft, aLeftHeight, aRight, aRightHeight);
+    splitNodes(b, bHeight, a->getKey(), bLeft, bLeftHeight, match, bRight, bRightHeight);
+    if (match != NULL) {
+      a->setValue(merge(a->getValue(), match->getValue()));
+      dropped.push_back(match);
+    }
+
+    NodeType *left, *right;
+    int leftHeight, rightHeight;
+    int fork = std::min(aHeight, bHeight) >= kForkHeight ? depth : 0;
+    std::vector<NodeType*> forkedDropped;
+    std::vector<NodeType*>& leftDropped = fork > 0 ? forkedDropped : dropped;
+    forkJoin(fork,
+      [&]() { left = unionNodes(aLeft, aLeftHeight, bLeft, bLeftHeight, leftHeight, merge, leftDropped, depth - 1); },
+      [&]() { right = unionNodes(aRight, aRightHeight, bRight, bRightHeight, rightHeight, merge, dropped, depth - 1); });
+    dropped.insert(dropped.end(), forkedDropped.begin(), forkedDropped.end());
+    return joinNodes(left, leftHeight, a, right, rightHeight, height);
+}
+
+/**
+* Intersection of two detached subtrees, split the same way as for
+* the union. a's root only stays if b had its key.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+template<typename Merge>
+NodeType* AVLTree<Key, Value, Compare, NodeType>::intersectNodes(NodeType* a, int aHeight, NodeType* b, int bHeight, int& height,
+                                                                 const Merge& merge, std::vector<NodeType*>& dropped, int depth)
+{
+    if (a == NULL || b == NULL) {
+      if (a != NULL) {
+        dropped.push_back(a);
       }
+      if (b != NULL) {
+        dropped.push_back(b);
+      }
+      height = 0;
+      return NULL;
     }
-    AVLNode<Key, Value>* addednode = new AVLNode<Key, Value>(new_item.first, new_item.second, parent);
-    
-    if (new_item.first < parent->getKey()) {
-        parent->setLeft(addednode);
-      } else {
-        parent->setRight(addednode);
+    NodeType *aLeft, *aRight, *bLeft, *match, *bRight;
+    int aLeftHeight, aRightHeight, bLeftHeight, bRightHeight;
+    detachChildren(a, aHeight, aLeft, aLeftHeight, aRight, aRightHeight);
+    splitNodes(b, bHeight, a->getKey(), bLeft, bLeftHeight, match, bRight, bRightHeight);
+
+    NodeType *left, *right;
+    int leftHeight, rightHeight;
+    int fork = std::min(aHeight, bHeight) >= kForkHeight ? depth : 0;
+    std::vector<NodeType*> forkedDropped;
+    std::vector<NodeType*>& leftDropped = fork > 0 ? forkedDropped : dropped;
+    forkJoin(fork,
+      [&]() { left = intersectNodes(aLeft, aLeftHeight, bLeft, bLeftHeight, leftHeight, merge, leftDropped, depth - 1); },
+      [&]() { right = intersectNodes(aRight, aRightHeight, bRight, bRightHeight, rightHeight, merge, dropped, depth - 1); });
+    dropped.insert(dropped.end(), forkedDropped.begin(), forkedDropped.end());
+    if (match == NULL) {
+      dropped.push_back(a);
+      return joinPair(left, leftHeight, right, rightHeight, height);
+    }
+    a->setValue(merge(a->getValue(), match->getValue()));
+    dropped.push_back(match);
+    return joinNodes(left, leftHeight, a, right, rightHeight, height);
+}
+
+/**
+* Difference of two detached subtrees. Here b's root splits a, since
+* it is the one whose key has to go.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+NodeType* AVLTree<Key, Value, Compare, NodeType>::differenceNodes(NodeType* a, int aHeight, NodeType* b, int bHeight, int& height,
+                                                                  std::vector<NodeType*>& dropped, int depth)
+{
+    if (a == NULL || b == NULL) {
+      if (b != NULL) {
+        dropped.push_back(b);
       }
+      height = aHeight;
+      return a;
+    }
+    NodeType *bLeft, *bRight, *aLeft, *match, *aRight;
+    int bLeftHeight, bRightHeight, aLeftHeight, aRightHeight;
+    detachChildren(b, bHeight, bLeft, bLeftHeight, bRight, bRightHeight);
+    splitNodes(a, aHeight, b->getKey(), aLeft, aLeftHeight, match, aRight, aRightHeight);
+    dropped.push_back(b);
+    if (match != NULL) {
+      dropped.push_back(match);
+    }
 
-    // added node is a leaf, so balance factor is 0
-    addednode->setBalance(0);
-    addUpdate(parent, addednode);
-    
+    NodeType *left, *right;
+    int leftHeight, rightHeight;
+    int fork = std::min(aHeight, bHeight) >= kForkHeight ? depth : 0;
+    std::vector<NodeType*> forkedDropped;
+    std::vector<NodeType*>& leftDropped = fork > 0 ? forkedDropped : dropped;
+    forkJoin(fork,
+      [&]() { left = differenceNodes(aLeft, aLeftHeight, bLeft, bLeftHeight, leftHeight, leftDropped, depth - 1); },
+      [&]() { right = differenceNodes(aRight, aRightHeight, bRight, bRightHeight, rightHeight, dropped, depth - 1); });
+    dropped.insert(dropped.end(), forkedDropped.begin(), forkedDropped.end());
+    return joinPair(left, leftHeight, right, rightHeight, height);
+}
+
+/**
+* Joins two detached subtrees without a pivot, every key of left before
+* every key of right, by taking the first node of right as the pivot.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+NodeType* AVLTree<Key, Value, Compare, NodeType>::joinPair(NodeType* left, int leftHeight, NodeType* right, int rightHeight, int& height)
+{
+    if (left == NULL || right == NULL) {
+      height = (left == NULL) ? rightHeight : leftHeight;
+      return (left == NULL) ? right : left;
+    }
+    NodeType* first = right;
+    while (first->getLeft() != NULL) {
+      first = first->getLeft();
+    }
+    NodeType *none, *pivot, *rest;
+    int noneHeight, restHeight;
+    splitNodes(right, rightHeight, first->getKey(), none, noneHeight, pivot, rest, restHeight);
+    return joinNodes(left, leftHeight, pivot, rest, restHeight, height);
+}
+
+/**
+* Makes the detached subtree under root, taken from the tree from,
+* the whole of this (empty) tree.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+void AVLTree<Key, Value, Compare, NodeType>::adopt(NodeType* root, AVLTree& from)
+{
+    this->root_ = root;
+    this->pool_.share(from.pool_);
+    this->resetEnds();
+    adoptSize(root, Sized());
+}
+
+/**
+* A sized node type knows how many items it brought along.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+void AVLTree<Key, Value, Compare, NodeType>::adoptSize(NodeType* root, std::true_type)
+{
+    this->size_ = subtreeSize(root);
+    this->sizeKnown_ = true;
+}
+
+/**
+* Removes [first, last) by splitting the tree just before first and
+* just before last, dropping the middle part and joining the rest with
+* last as the pivot. That is O(log n) plus the cost of destroying the
+* removed nodes, instead of one rebalancing pass per node.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+void AVLTree<Key, Value, Compare, NodeType>::eraseRange(Node<Key, Value>* first, Node<Key, Value>* last)
+{
+    // a single node is cheaper to remove the usual way
+    if (this->successor(first) == last) {
+      eraseNode(first);
+      return;
+    }
+    NodeType* before = Threaded::value ? static_cast<NodeType*>(prevNode(first)) : NULL;
+    NodeType* root = static_cast<NodeType*>(this->root_);
+    NodeType* less;
+    NodeType* equal;
+    NodeType* rest;
+    NodeType* middle;
+    int lessHeight, restHeight;
+    splitNodes(root, subtreeHeight(root), first->getKey(), less, lessHeight, equal, rest, restHeight);
+    if (last == NULL) {
+      middle = rest;
+      this->root_ = less;
+    } else {
+      NodeType* pivot;
+      NodeType* greater;
+      int middleHeight, greaterHeight, height;
+      splitNodes(rest, restHeight, last->getKey(), middle, middleHeight, pivot, greater, greaterHeight);
+      this->root_ = joinNodes(less, lessHeight, pivot, greater, greaterHeight, height);
+    }
+    linkThreads(before, static_cast<NodeType*>(last), Threaded());
+    // equal is first itself
+    this->destroyNode(equal);
+    this->clearHelper(middle);
+}
+
+/**
+* Creates an AVL node with a balance of 0.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+Node<Key, Value>* AVLTree<Key, Value, Compare, NodeType>::createNode(const Key& key, const Value& value, Node<Key, Value>* parent)
+{
+    return this->template constructNode<NodeType>(key, value, static_cast<NodeType*>(parent));
+}
+
+/**
+* The heights of a freshly built subtree give its balance directly.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+void AVLTree<Key, Value, Compare, NodeType>::buildFixup(Node<Key, Value>* node, int leftHeight, int rightHeight)
+{
+    static_cast<NodeType*>(node)->setBalance(leftHeight - rightHeight);
+    updateSize(static_cast<NodeType*>(node), Sized());
+}
 
+/**
+* Same as above, moving the key and value into the node.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+Node<Key, Value>* AVLTree<Key, Value, Compare, NodeType>::createNode(Key&& key, Value&& value, Node<Key, Value>* parent)
+{
+    return this->template constructNode<NodeType>(std::move(key), std::move(value), static_cast<NodeType*>(parent));
+}
+
+/**
+* Builds an AVL node in a slot taken from the pool beforehand.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+Node<Key, Value>* AVLTree<Key, Value, Compare, NodeType>::placeNode(void* slot, Key&& key, Value&& value)
+{
+    return new (slot) NodeType(std::move(key), std::move(value), NULL);
+}
+
+/**
+* Copies a node along with its balance factor.
+*/
+template<class Key, class Value, class Compare, class NodeType>
+Node<Key, Value>* AVLTree<Key, Value, Compare, NodeType>::cloneNode(const Node<Key, Value>* source, Node<Key, Value>* parent)
+{
+    NodeType* copy = static_cast<NodeType*>(createNode(source->getKey(), source->getValue(), parent));
+    copy->setBalance(static_cast<const NodeType*>(source)->getBalance());
+    copySize(copy, static_cast<const NodeType*>(source), Sized());
+    return copy;
+}
+
+/*
+ * Every insertion path of the BST (insert, emplace, try_emplace, ...)
+ * links the new leaf and then calls this, so the AVL tree only has to
+ * walk back up from it and rotate where necessary.
+ */
+template<class Key, class Value, class Compare, class NodeType>
+void AVLTree<Key, Value, Compare, NodeType>::insertFixup(Node<Key, Value>* node)
+{
+    // added node is a leaf, so balance factor is already 0
+    NodeType* addednode = static_cast<NodeType*>(node);
+    threadNode(addednode, Threaded());
+    if (addednode->getParent() != NULL) {
+      adjustSizes(addednode->getParent(), true, Sized());
+      addUpdate(addednode->getParent(), addednode);
+    }
 }
 
 // helper function to update balanaces and rotate where necessary
-template<class Key, class Value>
-void AVLTree<Key,Value>::addUpdate(AVLNode<Key,Value>* parent, AVLNode<Key,Value>* node) {
+// returns true if the climb went past the top of the tree, i.e. the
+// whole tree got one level taller (joinNodes needs to know)
+template<class Key, class Value, class Compare, class NodeType>
+bool AVLTree<Key, Value, Compare, NodeType>::addUpdate(NodeType* parent, NodeType* node) {
 
   while (parent != NULL) {
    // if left child added, increase parent bf by 1
@@ -219,7 +1634,7 @@ void AVLTree<Key,Value>::addUpdate(AVLNode<Key,Value>* parent, AVLNode<Key,Value
     }
     // if the parents bf is now 0 then tree is balanced and can return
     if (parent->getBalance() == 0) {
-      return;
+      return false;
     } else if (parent->getBalance() == -1 || parent->getBalance() == 1) {
       // keep moving up and checking previous parents
       node = parent;
@@ -231,7 +1646,7 @@ void AVLTree<Key,Value>::addUpdate(AVLNode<Key,Value>* parent, AVLNode<Key,Value
       // at this point the parent balance factor is -2 or 2. it cant be more becaues we are rotating
       // as we update and go through the tree
       if (parent->getBalance() == 2 && node->getBalance() == -1) {
-        AVLNode<Key,Value>* gchild = node->getRight();
+        NodeType* gchild = node->getRight();
         int gchildbf = 0;
         if (gchild != NULL) {
           gchildbf = gchild->getBalance();
@@ -254,7 +1669,7 @@ void AVLTree<Key,Value>::addUpdate(AVLNode<Key,Value>* parent, AVLNode<Key,Value
         }
         
       } else if (parent->getBalance() == -2 && node->getBalance() == 1) {
-        AVLNode<Key,Value>* gchild = node->getLeft();
+        NodeType* gchild = node->getLeft();
         int gchildbf = 0;
         if (gchild != NULL) {
           gchildbf = gchild->getBalance();
@@ -289,18 +1704,23 @@ void AVLTree<Key,Value>::addUpdate(AVLNode<Key,Value>* parent, AVLNode<Key,Value
         parent->setBalance(0);
         node->setBalance(0);
       }
-      return;
+      return false;
     }
   }
+  // the subtree that was updated last is the whole tree, and it grew
+  return true;
 }
 
-template<class Key, class Value>
-void AVLTree<Key,Value>::rotateLeft(AVLNode<Key,Value>* node) {
-  AVLNode<Key,Value>* initialSubtree = node->getRight()->getLeft();
-  AVLNode<Key,Value>* newhead = node->getRight();
+template<class Key, class Value, class Compare, class NodeType>
+void AVLTree<Key, Value, Compare, NodeType>::rotateLeft(NodeType* node) {
+  NodeType* initialSubtree = node->getRight()->getLeft();
+  NodeType* newhead = node->getRight();
 
   if (node->getParent() == NULL) {
-    this->root_ = newhead;
+    // the top of a detached subtree (see joinNodes()) isn't root_
+    if (node == this->root_) {
+      this->root_ = newhead;
+    }
   } else if (node->getParent()->getLeft() == node) {
     node->getParent()->setLeft(newhead);
   } else {
@@ -320,19 +1740,25 @@ void AVLTree<Key,Value>::rotateLeft(AVLNode<Key,Value>* node) {
   if (initialSubtree != NULL) {
     initialSubtree->setParent(node);
   }
+  // node is now below newhead, so its size has to be fixed first
+  updateSize(node, Sized());
+  updateSize(newhead, Sized());
 
 }
 
-template<class Key, class Value>
-void AVLTree<Key,Value>::rotateRight(AVLNode<Key,Value>* node) {
-  AVLNode<Key,Value>* initialSubtree = node->getLeft()->getRight();
-  AVLNode<Key,Value>* newhead = node->getLeft();
+template<class Key, class Value, class Compare, class NodeType>
+void AVLTree<Key, Value, Compare, NodeType>::rotateRight(NodeType* node) {
+  NodeType* initialSubtree = node->getLeft()->getRight();
+  NodeType* newhead = node->getLeft();
 
 
   // need to connect new head to the parents of old head (node)
   // checking root case and setting children of parents to new head
   if (node->getParent() == NULL) {
-    this->root_ = newhead;
+    // the top of a detached subtree (see joinNodes()) isn't root_
+    if (node == this->root_) {
+      this->root_ = newhead;
+    }
   } else if (node->getParent()->getLeft() == node) {
     node->getParent()->setLeft(newhead);
   } else {
@@ -352,6 +1778,9 @@ void AVLTree<Key,Value>::rotateRight(AVLNode<Key,Value>* node) {
   if (initialSubtree != NULL) {
     initialSubtree->setParent(node);
   }
+  // node is now below newhead, so its size has to be fixed first
+  updateSize(node, Sized());
+  updateSize(newhead, Sized());
 
   // // updating balance factors
   // // left left -> rotate Right
@@ -369,21 +1798,24 @@ void AVLTree<Key,Value>::rotateRight(AVLNode<Key,Value>* node) {
 /*
  * Recall: The writeup specifies that if a node has 2 children you
  * should swap with the predecessor and then remove.
+ * remove() and erase() in the BST both end up here.
  */
-template<class Key, class Value>
-void AVLTree<Key, Value>:: remove(const Key& key)
+template<class Key, class Value, class Compare, class NodeType>
+void AVLTree<Key, Value, Compare, NodeType>::eraseNode(Node<Key, Value>* node)
 {
     // TODO
     // BST implementation:
-
-    // check if is in tree
-    AVLNode<Key, Value>* removednode = static_cast<AVLNode<Key,Value>*>(this->internalFind(key));
+    NodeType* removednode = static_cast<NodeType*>(node);
 
     
     if (removednode == NULL) {
       return;
     } else {
-      AVLNode<Key, Value>* parent = removednode->getParent();
+      // with two children it is unlinked once it has moved down
+      if (removednode->getLeft() == NULL || removednode->getRight() == NULL) {
+        unthreadNode(removednode, Threaded());
+      }
+      NodeType* parent = removednode->getParent();
       int diff = 0;
 
       // find balance differences to use for later
@@ -401,16 +1833,16 @@ void AVLTree<Key, Value>:: remove(const Key& key)
         // check if root node
         if (removednode->getParent() == NULL) {
           this->root_ = NULL;
-          delete removednode;
+          this->destroyNode(removednode);
           return;
         }
         // check whether to unlink left or right side
-        if (removednode->getKey() < removednode->getParent()->getKey()) {
+        if (removednode->getParent()->getLeft() == removednode) {
           removednode->getParent()->setLeft(NULL);
-          delete removednode;
+          this->destroyNode(removednode);
         } else {
           removednode->getParent()->setRight(NULL);
-          delete removednode;
+          this->destroyNode(removednode);
         }
       } 
       // node has 1 child, needs to link parent to the nodes child
@@ -426,7 +1858,7 @@ void AVLTree<Key, Value>:: remove(const Key& key)
             this->root_ = removednode->getRight();
             this->root_->setParent(NULL);
           }
-          delete removednode;
+          this->destroyNode(removednode);
           return;
         }
         // only left child exists
@@ -435,20 +1867,20 @@ void AVLTree<Key, Value>:: remove(const Key& key)
           // check which side removednode is on
           if (removednode->getParent()->getLeft() == removednode) {
             removednode->getParent()->setLeft(removednode->getLeft());
-            delete removednode;
+            this->destroyNode(removednode);
           } else {
             removednode->getParent()->setRight(removednode->getLeft());
-            delete removednode;
+            this->destroyNode(removednode);
           }
         } else {
           removednode->getRight()->setParent(removednode->getParent());
           // check which side removednode is on:
           if (removednode->getParent()->getLeft() == removednode) {
             removednode->getParent()->setLeft(removednode->getRight());
-            delete removednode;
+            this->destroyNode(removednode);
           } else {
             removednode->getParent()->setRight(removednode->getRight());
-            delete removednode;
+            this->destroyNode(removednode);
           }
         }
       } 
@@ -458,8 +1890,9 @@ void AVLTree<Key, Value>:: remove(const Key& key)
     // predecessor: maximum value in the left subtree
     else {
       // finding predecessor (max value in left subtree)
-      AVLNode<Key, Value>* predec = static_cast<AVLNode<Key, Value>*>(this->predecessor(removednode));
+      NodeType* predec = static_cast<NodeType*>(this->predecessor(removednode));
       nodeSwap(removednode, predec);
+      unthreadNode(removednode, Threaded());
       // now check if has 1 or 0 children
       
       parent = removednode->getParent();
@@ -476,10 +1909,10 @@ void AVLTree<Key, Value>:: remove(const Key& key)
         // check whether to unlink left or right side
         if (removednode->getParent()->getLeft() == removednode) {
           removednode->getParent()->setLeft(NULL);
-          delete removednode;
+          this->destroyNode(removednode);
         } else {
           removednode->getParent()->setRight(NULL);
-          delete removednode;
+          this->destroyNode(removednode);
         }
       } 
       // has 1 child
@@ -489,20 +1922,20 @@ void AVLTree<Key, Value>:: remove(const Key& key)
           // check which side removednode is on
           if (removednode->getParent()->getLeft() == removednode) {
             removednode->getParent()->setLeft(removednode->getLeft());
-            delete removednode;
+            this->destroyNode(removednode);
           } else {
             removednode->getParent()->setRight(removednode->getLeft());
-            delete removednode;
+            this->destroyNode(removednode);
           }
         } else {
           removednode->getRight()->setParent(removednode->getParent());
           // check which side removednode is on:
           if (removednode->getParent()->getLeft() == removednode) {
             removednode->getParent()->setLeft(removednode->getRight());
-            delete removednode;
+            this->destroyNode(removednode);
           } else {
             removednode->getParent()->setRight(removednode->getRight());
-            delete removednode;
+            this->destroyNode(removednode);
           }
         }
       }
@@ -510,6 +1943,7 @@ void AVLTree<Key, Value>:: remove(const Key& key)
 
     }
       // ADDITION: avl remove helper function
+      adjustSizes(parent, false, Sized());
       if (parent != NULL) {
         removeUpdate(parent, diff);
       }
@@ -519,8 +1953,8 @@ void AVLTree<Key, Value>:: remove(const Key& key)
     
 }
 
-template<class Key, class Value>
-void AVLTree<Key,Value>::removeUpdate(AVLNode<Key,Value>* parent, int diff) {
+template<class Key, class Value, class Compare, class NodeType>
+void AVLTree<Key, Value, Compare, NodeType>::removeUpdate(NodeType* parent, int diff) {
   // after removing from left subtree, decrease parents balance by 1
   // after removing from right subtree, increase parent bf by 1
   // diff represents which side removed from. (-1 if left, 1, if right)
@@ -532,7 +1966,7 @@ void AVLTree<Key,Value>::removeUpdate(AVLNode<Key,Value>* parent, int diff) {
   parent->updateBalance(diff);
 
   // calculate the next diff if needed later
-  AVLNode<Key,Value>* gparent = parent->getParent();
+  NodeType* gparent = parent->getParent();
   int ndiff = 0;
   if (gparent != NULL) {
     if (gparent->getRight() == parent) {
@@ -556,11 +1990,11 @@ void AVLTree<Key,Value>::removeUpdate(AVLNode<Key,Value>* parent, int diff) {
     if (parent->getBalance() == 2) {
       
       // storing left child balance BEFORE rotation
-      AVLNode<Key,Value>* child = parent->getLeft();
+      NodeType* child = parent->getLeft();
       int childBalance = parent->getLeft()->getBalance();
       // taller side is left bc left heavy
       if (childBalance == -1) {
-        AVLNode<Key,Value>* gchild = child->getRight();
+        NodeType* gchild = child->getRight();
         int gchildbf = 0;
         if (gchild != NULL) {
           gchildbf = gchild->getBalance();
@@ -603,10 +2037,10 @@ void AVLTree<Key,Value>::removeUpdate(AVLNode<Key,Value>* parent, int diff) {
     } else {
       // parent balance must be -2
       // storing right child balance BEFORE rotation
-      AVLNode<Key,Value>* child = parent->getRight();
+      NodeType* child = parent->getRight();
       int childBalance = parent->getRight()->getBalance();
       if (childBalance == 1) {
-        AVLNode<Key,Value>* gchild = child->getLeft();
+        NodeType* gchild = child->getLeft();
         int gchildbf = 0;
         if (gchild != NULL) {
           gchildbf = gchild->getBalance();
@@ -653,13 +2087,15 @@ void AVLTree<Key,Value>::removeUpdate(AVLNode<Key,Value>* parent, int diff) {
 
 
 
-template<class Key, class Value>
-void AVLTree<Key, Value>::nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2)
+template<class Key, class Value, class Compare, class NodeType>
+void AVLTree<Key, Value, Compare, NodeType>::nodeSwap( NodeType* n1, NodeType* n2)
 {
-    BinarySearchTree<Key, Value>::nodeSwap(n1, n2);
+    BinarySearchTree<Key, Value, Compare>::nodeSwap(n1, n2);
     int8_t tempB = n1->getBalance();
     n1->setBalance(n2->getBalance());
     n2->setBalance(tempB);
+    swapSizes(n1, n2, Sized());
+    swapThreads(n1, n2, Threaded());
 }
 
 
@@ -0,0 +1,117 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <thread>
+#include <cstdint>
+#include <cstdlib>
+#include "bst.h"
+#include "avlbst.h"
+#include "balancedtree.h"
+
+using namespace std;
+
+// Compares AVLTree with BalancedTree under its AVL, weak AVL and
+// red-black policies, for each tree size given on the command line
+// (1M, 4M and 16M by default), on
+//   insert   n random keys into an empty tree
+//   churn    n rounds of removing a random key and inserting a new one,
+//            also giving the 99th and 99.9th percentile remove times
+//   find     2M lookups of present keys
+//   drain    removing every key in random order
+
+typedef chrono::steady_clock Clock;
+
+static double msSince(Clock::time_point start)
+{
+    return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+template<typename Tree>
+void run(const char* name, const vector<uint64_t>& keys, const vector<uint64_t>& fresh, const vector<size_t>& victims)
+{
+    size_t n = keys.size();
+    Tree tree;
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < n; i++) {
+      tree.insert(make_pair(keys[i], i));
+    }
+    double insertMs = msSince(start);
+
+    // victims[i] picks which of the present keys goes in round i
+    vector<uint64_t> present(keys);
+    vector<double> removeNs(n);
+    start = Clock::now();
+    for (size_t i = 0; i < n; i++) {
+      uint64_t& slot = present[victims[i]];
+      Clock::time_point before = Clock::now();
+      tree.remove(slot);
+      removeNs[i] = chrono::duration<double, nano>(Clock::now() - before).count();
+      slot = fresh[i];
+      tree.insert(make_pair(slot, i));
+    }
+    double churnMs = msSince(start);
+    sort(removeNs.begin(), removeNs.end());
+
+    uint64_t checksum = 0;
+    size_t finds = 2000000;
+    start = Clock::now();
+    for (size_t i = 0; i < finds; i++) {
+      checksum += tree.find(present[victims[i % n]])->second;
+    }
+    double findMs = msSince(start);
+
+    start = Clock::now();
+    for (size_t i = 0; i < n; i++) {
+      tree.remove(present[i]);
+    }
+    double drainMs = msSince(start);
+    checksum += tree.size();
+
+    cout << setw(26) << name << setw(10) << n << fixed << setprecision(2)
+         << setw(10) << n / insertMs / 1000.0 << setw(10) << n / churnMs / 1000.0
+         << setprecision(0) << setw(9) << removeNs[n * 99 / 100] << setw(9) << removeNs[n * 999 / 1000]
+         << setprecision(2) << setw(10) << finds / findMs / 1000.0 << setw(10) << n / drainMs / 1000.0
+         << "   (checksum " << checksum << ")" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    vector<size_t> sizes;
+    for (int i = 1; i < argc; i++) {
+      sizes.push_back(strtoul(argv[i], NULL, 10));
+    }
+    if (sizes.empty()) {
+      sizes.push_back(1000000);
+      sizes.push_back(4000000);
+      sizes.push_back(16000000);
+    }
+
+    cout << "hardware threads: " << thread::hardware_concurrency() << endl;
+    cout << "throughput in M operations/s, remove percentiles in ns" << endl;
+    cout << setw(26) << "tree" << setw(10) << "n" << setw(10) << "insert" << setw(10) << "churn"
+         << setw(9) << "rm p99" << setw(9) << "rm p99.9" << setw(10) << "find" << setw(10) << "drain" << endl;
+    for (size_t s = 0; s < sizes.size(); s++) {
+      size_t n = sizes[s];
+      mt19937_64 rng(104);
+      // odd keys to start with, even ones come in during the churn
+      vector<uint64_t> keys(n), fresh(n);
+      for (size_t i = 0; i < n; i++) {
+        keys[i] = 2 * i + 1;
+        fresh[i] = 2 * i;
+      }
+      shuffle(keys.begin(), keys.end(), rng);
+      shuffle(fresh.begin(), fresh.end(), rng);
+      vector<size_t> victims(n);
+      for (size_t i = 0; i < n; i++) {
+        victims[i] = rng() % n;
+      }
+      run<AVLTree<uint64_t, uint64_t> >("AVLTree", keys, fresh, victims);
+      run<BalancedTree<uint64_t, uint64_t, less<uint64_t>, AVLBalance> >("BalancedTree<AVLBalance>", keys, fresh, victims);
+      run<WAVLTree<uint64_t, uint64_t> >("WAVLTree", keys, fresh, victims);
+      run<RedBlackTree<uint64_t, uint64_t> >("RedBlackTree", keys, fresh, victims);
+    }
+    return 0;
+}
@@ -0,0 +1,831 @@
+#ifndef BALANCEDTREE_H
+#define BALANCEDTREE_H
+
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include "bst.h"
+
+/**
+* A node for BalancedTree. It carries one byte of balance data whose
+* meaning is up to the tree's balancing policy: the height for
+* AVLBalance, the rank for WAVLBalance and the colour for
+* RedBlackBalance. A new node starts out at 0, which is a leaf for the
+* first two and red for the last.
+*/
+template <typename Key, typename Value>
+class BalancedNode : public Node<Key, Value>
+{
+public:
+    BalancedNode(const Key& key, const Value& value, BalancedNode<Key, Value>* parent);
+    BalancedNode(Key&& key, Value&& value, BalancedNode<Key, Value>* parent);
+
+    int8_t getBalance() const;
+    void setBalance(int8_t balance);
+    void updateBalance(int8_t diff);
+
+    // Hide the Node getters, see AVLNode
+    BalancedNode<Key, Value>* getParent() const;
+    BalancedNode<Key, Value>* getLeft() const;
+    BalancedNode<Key, Value>* getRight() const;
+
+protected:
+    int8_t balance_;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the BalancedNode class.
+  -------------------------------------------------
+*/
+
+template<class Key, class Value>
+BalancedNode<Key, Value>::BalancedNode(const Key& key, const Value& value, BalancedNode<Key, Value>* parent) :
+    Node<Key, Value>(key, value, parent), balance_(0)
+{
+
+}
+
+/**
+* Same as above, moving the key and value into the node.
+*/
+template<class Key, class Value>
+BalancedNode<Key, Value>::BalancedNode(Key&& key, Value&& value, BalancedNode<Key, Value>* parent) :
+    Node<Key, Value>(std::move(key), std::move(value), parent), balance_(0)
+{
+
+}
+
+template<class Key, class Value>
+int8_t BalancedNode<Key, Value>::getBalance() const
+{
+    return balance_;
+}
+
+template<class Key, class Value>
+void BalancedNode<Key, Value>::setBalance(int8_t balance)
+{
+    balance_ = balance;
+}
+
+template<class Key, class Value>
+void BalancedNode<Key, Value>::updateBalance(int8_t diff)
+{
+    balance_ += diff;
+}
+
+template<class Key, class Value>
+BalancedNode<Key, Value>* BalancedNode<Key, Value>::getParent() const
+{
+    return static_cast<BalancedNode<Key, Value>*>(Node<Key, Value>::getParent());
+}
+
+template<class Key, class Value>
+BalancedNode<Key, Value>* BalancedNode<Key, Value>::getLeft() const
+{
+    return static_cast<BalancedNode<Key, Value>*>(this->left_);
+}
+
+template<class Key, class Value>
+BalancedNode<Key, Value>* BalancedNode<Key, Value>::getRight() const
+{
+    return static_cast<BalancedNode<Key, Value>*>(this->right_);
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the BalancedNode class.
+  -----------------------------------------------
+*/
+
+/**
+* Balancing policies for BalancedTree. A policy is a set of static
+* functions the tree calls at fixed points:
+*
+*   afterInsert(tree, node)       a new leaf was linked in
+*   afterErase(tree, removed, child, parent)
+*                                 removed, which had at most one child,
+*                                 was spliced out and child (maybe NULL)
+*                                 took its place under parent
+*   afterBuild(node, leftHeight, rightHeight)
+*                                 a bulk load finished node's subtrees
+*   isValid(root)                 the policy's invariants hold
+*
+* and rebalances with tree.rotateUp() (see BinarySearchTree), so it
+* never touches the links itself.
+*/
+
+/**
+* Height-balanced AVL trees in terms of heights (leaves have height 0).
+* A removal may rotate at every level on the way up, which is what the
+* other two policies avoid; it is here mostly to compare them against.
+*/
+struct AVLBalance
+{
+    template<typename Tree, typename NodeT>
+    static void afterInsert(Tree& tree, NodeT* node);
+    template<typename Tree, typename NodeT>
+    static void afterErase(Tree& tree, NodeT* removed, NodeT* child, NodeT* parent);
+    template<typename NodeT>
+    static void afterBuild(NodeT* node, int leftHeight, int rightHeight);
+    template<typename NodeT>
+    static bool isValid(const NodeT* root);
+
+    template<typename Tree, typename NodeT>
+    static void rebalance(Tree& tree, NodeT* node);
+    template<typename NodeT>
+    static int height(const NodeT* node);
+    template<typename NodeT>
+    static void fixHeight(NodeT* node);
+    template<typename NodeT>
+    static int checkedHeight(const NodeT* node);
+};
+
+/**
+* Weak AVL trees (Haeupler, Sen and Tarjan, "Rank-balanced trees"). Each
+* node has a rank, missing children count as rank -1, and every rank
+* difference between a parent and a child is 1 or 2, with leaves at
+* rank 0. Insertions keep the tree an AVL tree, so without removals it
+* is exactly as shallow as one. A removal may leave two 2-children
+* where AVL would insist on rotating, so each update does at most two
+* rotations and O(1) amortized rank changes.
+*/
+struct WAVLBalance
+{
+    template<typename Tree, typename NodeT>
+    static void afterInsert(Tree& tree, NodeT* node);
+    template<typename Tree, typename NodeT>
+    static void afterErase(Tree& tree, NodeT* removed, NodeT* child, NodeT* parent);
+    template<typename NodeT>
+    static void afterBuild(NodeT* node, int leftHeight, int rightHeight);
+    template<typename NodeT>
+    static bool isValid(const NodeT* root);
+
+    template<typename NodeT>
+    static int rank(const NodeT* node);
+    template<typename NodeT>
+    static int checkedRank(const NodeT* node);
+};
+
+/**
+* Red-black trees. An insertion does at most two rotations and a
+* removal at most three, the rest is recolouring. Paths may be up to
+* twice as long as in an AVL tree.
+*/
+struct RedBlackBalance
+{
+    static const int8_t kRed = 0;
+    static const int8_t kBlack = 1;
+
+    template<typename Tree, typename NodeT>
+    static void afterInsert(Tree& tree, NodeT* node);
+    template<typename Tree, typename NodeT>
+    static void afterErase(Tree& tree, NodeT* removed, NodeT* child, NodeT* parent);
+    template<typename NodeT>
+    static void afterBuild(NodeT* node, int leftHeight, int rightHeight);
+    template<typename NodeT>
+    static bool isValid(const NodeT* root);
+
+    template<typename NodeT>
+    static bool isRed(const NodeT* node);
+    template<typename NodeT>
+    static int checkedBlackHeight(const NodeT* node);
+};
+
+/**
+* A self-balancing search tree on top of the shared BinarySearchTree
+* code, with the balancing scheme as a policy (see AVLBalance,
+* WAVLBalance and RedBlackBalance). The tree does the splicing and the
+* rotations, the policy decides where to rotate and keeps the balance
+* data of the nodes.
+*
+* AVLTree stays a class of its own, since split/join, the set
+* operations and its node layouts all rely on AVL heights.
+*/
+template <class Key, class Value, class Compare = std::less<Key>, class Balance = WAVLBalance>
+class BalancedTree : public BinarySearchTree<Key, Value, Compare>
+{
+public:
+    typedef BalancedNode<Key, Value> NodeType;
+
+    BalancedTree();
+    explicit BalancedTree(const Compare& comp);
+    template<typename ForwardIterator>
+    BalancedTree(ForwardIterator first, ForwardIterator last, const Compare& comp = Compare());
+    BalancedTree(const BalancedTree& other);
+    BalancedTree(BalancedTree&& other);
+    BalancedTree& operator=(const BalancedTree& other);
+    BalancedTree& operator=(BalancedTree&& other);
+    void swap(BalancedTree& other);
+
+    // Hides the AVL check of the BST: true iff the policy's invariants
+    // hold, along with the parent links
+    bool isBalanced() const;
+
+protected:
+    friend Balance;
+
+    bool linksValid(const NodeType* node) const;
+
+    virtual void nodeSwap(Node<Key, Value>* n1, Node<Key, Value>* n2);
+    virtual void eraseNode(Node<Key, Value>* node);
+    virtual Node<Key, Value>* createNode(const Key& key, const Value& value, Node<Key, Value>* parent);
+    virtual Node<Key, Value>* createNode(Key&& key, Value&& value, Node<Key, Value>* parent);
+    virtual Node<Key, Value>* placeNode(void* slot, Key&& key, Value&& value);
+    virtual void insertFixup(Node<Key, Value>* node);
+    virtual Node<Key, Value>* cloneNode(const Node<Key, Value>* source, Node<Key, Value>* parent);
+    virtual void buildFixup(Node<Key, Value>* node, int leftHeight, int rightHeight);
+};
+
+template <class Key, class Value, class Compare = std::less<Key> >
+using WAVLTree = BalancedTree<Key, Value, Compare, WAVLBalance>;
+
+template <class Key, class Value, class Compare = std::less<Key> >
+using RedBlackTree = BalancedTree<Key, Value, Compare, RedBlackBalance>;
+
+/*
+------------------------------------------------
+Begin implementations for the AVLBalance policy.
+------------------------------------------------
+*/
+
+template<typename Tree, typename NodeT>
+void AVLBalance::afterInsert(Tree& tree, NodeT* node)
+{
+    rebalance(tree, node->getParent());
+}
+
+template<typename Tree, typename NodeT>
+void AVLBalance::afterErase(Tree& tree, NodeT*, NodeT*, NodeT* parent)
+{
+    rebalance(tree, parent);
+}
+
+/**
+* A bulk-loaded subtree is height balanced already.
+*/
+template<typename NodeT>
+void AVLBalance::afterBuild(NodeT* node, int leftHeight, int rightHeight)
+{
+    // the builder counts a leaf as height 1
+    node->setBalance(leftHeight > rightHeight ? leftHeight : rightHeight);
+}
+
+/**
+* Walks up from node fixing heights, with a single or double rotation
+* wherever the two sides differ by 2. It stops at the first subtree
+* that ends up as high as it was before.
+*/
+template<typename Tree, typename NodeT>
+void AVLBalance::rebalance(Tree& tree, NodeT* node)
+{
+    while (node != NULL) {
+      int before = node->getBalance();
+      int diff = height(node->getLeft()) - height(node->getRight());
+      NodeT* top = node;
+      if (diff > 1 || diff < -1) {
+        NodeT* taller = diff > 1 ? node->getLeft() : node->getRight();
+        NodeT* outer = diff > 1 ? taller->getLeft() : taller->getRight();
+        NodeT* inner = diff > 1 ? taller->getRight() : taller->getLeft();
+        top = taller;
+        if (height(inner) > height(outer)) {
+          tree.rotateUp(inner);
+          fixHeight(taller);
+          top = inner;
+        }
+        tree.rotateUp(top);
+        fixHeight(node);
+      }
+      fixHeight(top);
+      if (top->getBalance() == before) {
+        return;
+      }
+      node = top->getParent();
+    }
+}
+
+template<typename NodeT>
+int AVLBalance::height(const NodeT* node)
+{
+    return node == NULL ? -1 : node->getBalance();
+}
+
+template<typename NodeT>
+void AVLBalance::fixHeight(NodeT* node)
+{
+    int left = height(node->getLeft());
+    int right = height(node->getRight());
+    node->setBalance(1 + (left > right ? left : right));
+}
+
+template<typename NodeT>
+bool AVLBalance::isValid(const NodeT* root)
+{
+    return checkedHeight(root) != -2;
+}
+
+// returns the height of the subtree, or -2 if it breaks the rules
+template<typename NodeT>
+int AVLBalance::checkedHeight(const NodeT* node)
+{
+    if (node == NULL) return -1;
+    int left = checkedHeight(node->getLeft());
+    int right = checkedHeight(node->getRight());
+    if (left == -2 || right == -2 || left - right > 1 || right - left > 1) return -2;
+    int h = 1 + (left > right ? left : right);
+    return node->getBalance() == h ? h : -2;
+}
+
+/*
+----------------------------------------------
+End implementations for the AVLBalance policy.
+----------------------------------------------
+*/
+
+/*
+-------------------------------------------------
+Begin implementations for the WAVLBalance policy.
+-------------------------------------------------
+*/
+
+/**
+* The new leaf is a 0-child if its parent was a leaf. Promoting the
+* parent moves the 0-child up a level, until either a parent is no
+* longer even with its child or its other child is a 2-child, in which
+* case one or two rotations finish the job.
+*/
+template<typename Tree, typename NodeT>
+void WAVLBalance::afterInsert(Tree& tree, NodeT* node)
+{
+    NodeT* parent = node->getParent();
+    while (parent != NULL && rank(parent) == rank(node)) {
+      bool left = parent->getLeft() == node;
+      NodeT* sibling = left ? parent->getRight() : parent->getLeft();
+      if (rank(parent) - rank(sibling) == 1) {
+        parent->updateBalance(1);
+        node = parent;
+        parent = node->getParent();
+        continue;
+      }
+      NodeT* inner = left ? node->getRight() : node->getLeft();
+      if (rank(node) - rank(inner) == 2) {
+        tree.rotateUp(node);
+        parent->updateBalance(-1);
+      } else {
+        tree.rotateUp(inner);
+        tree.rotateUp(inner);
+        inner->updateBalance(1);
+        node->updateBalance(-1);
+        parent->updateBalance(-1);
+      }
+      return;
+    }
+}
+
+/**
+* Taking a node out can leave a 2,2 leaf, which is demoted, or a
+* 3-child. A 3-child is dealt with by demoting its parent (and maybe
+* its sibling), which can move the 3-child up, or by a single or double
+* rotation, which ends it.
+*/
+template<typename Tree, typename NodeT>
+void WAVLBalance::afterErase(Tree& tree, NodeT*, NodeT* child, NodeT* parent)
+{
+    if (parent == NULL) {
+      return;
+    }
+    if (parent->getLeft() == NULL && parent->getRight() == NULL && rank(parent) == 1) {
+      parent->setBalance(0);
+      child = parent;
+      parent = child->getParent();
+    }
+    while (parent != NULL && rank(parent) - rank(child) == 3) {
+      // a missing child is on the side the remaining child isn't
+      bool left = child != NULL ? parent->getLeft() == child : parent->getLeft() == NULL;
+      NodeT* sibling = left ? parent->getRight() : parent->getLeft();
+      if (rank(parent) - rank(sibling) == 2) {
+        parent->updateBalance(-1);
+      } else if (rank(sibling) - rank(sibling->getLeft()) == 2 && rank(sibling) - rank(sibling->getRight()) == 2) {
+        parent->updateBalance(-1);
+        sibling->updateBalance(-1);
+      } else {
+        NodeT* outer = left ? sibling->getRight() : sibling->getLeft();
+        NodeT* inner = left ? sibling->getLeft() : sibling->getRight();
+        if (rank(sibling) - rank(outer) == 1) {
+          tree.rotateUp(sibling);
+          sibling->updateBalance(1);
+          parent->updateBalance(-1);
+          if (parent->getLeft() == NULL && parent->getRight() == NULL) {
+            parent->updateBalance(-1);
+          }
+        } else {
+          tree.rotateUp(inner);
+          tree.rotateUp(inner);
+          inner->updateBalance(2);
+          sibling->updateBalance(-1);
+          parent->updateBalance(-2);
+        }
+        return;
+      }
+      child = parent;
+      parent = child->getParent();
+    }
+}
+
+/**
+* A bulk-loaded subtree is an AVL tree, whose heights are valid ranks.
+*/
+template<typename NodeT>
+void WAVLBalance::afterBuild(NodeT* node, int leftHeight, int rightHeight)
+{
+    node->setBalance(leftHeight > rightHeight ? leftHeight : rightHeight);
+}
+
+template<typename NodeT>
+int WAVLBalance::rank(const NodeT* node)
+{
+    return node == NULL ? -1 : node->getBalance();
+}
+
+template<typename NodeT>
+bool WAVLBalance::isValid(const NodeT* root)
+{
+    return checkedRank(root) != -2;
+}
+
+// returns the rank of node, or -2 if its subtree breaks the rules
+template<typename NodeT>
+int WAVLBalance::checkedRank(const NodeT* node)
+{
+    if (node == NULL) return -1;
+    int left = checkedRank(node->getLeft());
+    int right = checkedRank(node->getRight());
+    int r = node->getBalance();
+    if (left == -2 || right == -2 || r - left < 1 || r - left > 2 || r - right < 1 || r - right > 2) return -2;
+    if (left == -1 && right == -1 && r != 0) return -2;
+    return r;
+}
+
+/*
+-----------------------------------------------
+End implementations for the WAVLBalance policy.
+-----------------------------------------------
+*/
+
+/*
+-----------------------------------------------------
+Begin implementations for the RedBlackBalance policy.
+-----------------------------------------------------
+*/
+
+/**
+* The new leaf is red. While its parent is red too, a red uncle lets
+* the grandparent take the red up two levels; otherwise one or two
+* rotations end it.
+*/
+template<typename Tree, typename NodeT>
+void RedBlackBalance::afterInsert(Tree& tree, NodeT* node)
+{
+    while (true) {
+      NodeT* parent = node->getParent();
+      if (parent == NULL) {
+        node->setBalance(kBlack);
+        return;
+      }
+      if (!isRed(parent)) {
+        return;
+      }
+      // a red parent is never the root
+      NodeT* grand = parent->getParent();
+      NodeT* uncle = grand->getLeft() == parent ? grand->getRight() : grand->getLeft();
+      if (isRed(uncle)) {
+        parent->setBalance(kBlack);
+        uncle->setBalance(kBlack);
+        grand->setBalance(kRed);
+        node = grand;
+        continue;
+      }
+      if ((grand->getLeft() == parent) != (parent->getLeft() == node)) {
+        tree.rotateUp(node);
+        parent = node;
+      }
+      tree.rotateUp(parent);
+      parent->setBalance(kBlack);
+      grand->setBalance(kRed);
+      return;
+    }
+}
+
+/**
+* Taking out a black node leaves child one black short. A red child
+* just turns black; otherwise the missing black moves up through black
+* siblings turned red, until a red node absorbs it or at most three
+* rotations around a sibling with a red child settle it.
+*/
+template<typename Tree, typename NodeT>
+void RedBlackBalance::afterErase(Tree& tree, NodeT* removed, NodeT* child, NodeT* parent)
+{
+    if (isRed(removed)) {
+      return;
+    }
+    while (parent != NULL && !isRed(child)) {
+      // a short child always has a sibling, so a missing child is the one on the empty side
+      bool left = parent->getLeft() == child;
+      NodeT* sibling = left ? parent->getRight() : parent->getLeft();
+      if (isRed(sibling)) {
+        tree.rotateUp(sibling);
+        sibling->setBalance(kBlack);
+        parent->setBalance(kRed);
+        sibling = left ? parent->getRight() : parent->getLeft();
+      }
+      NodeT* inner = left ? sibling->getLeft() : sibling->getRight();
+      NodeT* outer = left ? sibling->getRight() : sibling->getLeft();
+      if (!isRed(inner) && !isRed(outer)) {
+        sibling->setBalance(kRed);
+        child = parent;
+        parent = child->getParent();
+        continue;
+      }
+      if (!isRed(outer)) {
+        tree.rotateUp(inner);
+        inner->setBalance(kBlack);
+        sibling->setBalance(kRed);
+        outer = sibling;
+        sibling = inner;
+      }
+      tree.rotateUp(sibling);
+      sibling->setBalance(parent->getBalance());
+      parent->setBalance(kBlack);
+      outer->setBalance(kBlack);
+      return;
+    }
+    if (child != NULL) {
+      child->setBalance(kBlack);
+    }
+}
+
+/**
+* A bulk-loaded subtree is an AVL tree. Taking the black height of a
+* subtree of height h (a leaf counts as 1) to be (h - 1) / 2 + 1, a
+* node is red when it has the same black height as its parent, which
+* never happens twice in a row. So each node is made black and colours
+* its children, and the root stays black.
+*/
+template<typename NodeT>
+void RedBlackBalance::afterBuild(NodeT* node, int leftHeight, int rightHeight)
+{
+    int height = 1 + (leftHeight > rightHeight ? leftHeight : rightHeight);
+    node->setBalance(kBlack);
+    if (node->getLeft() != NULL && (leftHeight - 1) / 2 == (height - 1) / 2) {
+      node->getLeft()->setBalance(kRed);
+    }
+    if (node->getRight() != NULL && (rightHeight - 1) / 2 == (height - 1) / 2) {
+      node->getRight()->setBalance(kRed);
+    }
+}
+
+template<typename NodeT>
+bool RedBlackBalance::isRed(const NodeT* node)
+{
+    return node != NULL && node->getBalance() == kRed;
+}
+
+template<typename NodeT>
+bool RedBlackBalance::isValid(const NodeT* root)
+{
+    return !isRed(root) && checkedBlackHeight(root) != -1;
+}
+
+// returns the number of black nodes on every path down from node, or
+// -1 if they differ or a red node has a red child
+template<typename NodeT>
+int RedBlackBalance::checkedBlackHeight(const NodeT* node)
+{
+    if (node == NULL) return 0;
+    if (isRed(node) && (isRed(node->getLeft()) || isRed(node->getRight()))) return -1;
+    int left = checkedBlackHeight(node->getLeft());
+    int right = checkedBlackHeight(node->getRight());
+    if (left == -1 || left != right) return -1;
+    return left + (isRed(node) ? 0 : 1);
+}
+
+/*
+---------------------------------------------------
+End implementations for the RedBlackBalance policy.
+---------------------------------------------------
+*/
+
+/*
+-------------------------------------------------
+Begin implementations for the BalancedTree class.
+-------------------------------------------------
+*/
+
+/**
+* Default constructor, which sizes the node pool for BalancedNode.
+*/
+template<class Key, class Value, class Compare, class Balance>
+BalancedTree<Key, Value, Compare, Balance>::BalancedTree() :
+    BinarySearchTree<Key, Value, Compare>(sizeof(NodeType), alignof(NodeType))
+{
+
+}
+
+/**
+* Constructor for an empty tree ordered by the given comparator.
+*/
+template<class Key, class Value, class Compare, class Balance>
+BalancedTree<Key, Value, Compare, Balance>::BalancedTree(const Compare& comp) :
+    BinarySearchTree<Key, Value, Compare>(sizeof(NodeType), alignof(NodeType), comp)
+{
+
+}
+
+/**
+* Constructs a tree holding the items of a sorted range in O(n),
+* see BinarySearchTree::assign().
+*/
+template<class Key, class Value, class Compare, class Balance>
+template<typename ForwardIterator>
+BalancedTree<Key, Value, Compare, Balance>::BalancedTree(ForwardIterator first, ForwardIterator last, const Compare& comp) :
+    BinarySearchTree<Key, Value, Compare>(sizeof(NodeType), alignof(NodeType), comp)
+{
+    // the base class cannot do this, our hooks aren't set up until now
+    this->assign(first, last);
+}
+
+/**
+* Copy constructor, which copies the shape and balance data of other.
+*/
+template<class Key, class Value, class Compare, class Balance>
+BalancedTree<Key, Value, Compare, Balance>::BalancedTree(const BalancedTree& other) :
+    BinarySearchTree<Key, Value, Compare>(sizeof(NodeType), alignof(NodeType), other.comp_)
+{
+    this->cloneFrom(other);
+}
+
+/**
+* Move constructor, O(1). other is left empty.
+*/
+template<class Key, class Value, class Compare, class Balance>
+BalancedTree<Key, Value, Compare, Balance>::BalancedTree(BalancedTree&& other) :
+    BinarySearchTree<Key, Value, Compare>(std::move(other))
+{
+
+}
+
+template<class Key, class Value, class Compare, class Balance>
+BalancedTree<Key, Value, Compare, Balance>& BalancedTree<Key, Value, Compare, Balance>::operator=(const BalancedTree& other)
+{
+    BinarySearchTree<Key, Value, Compare>::operator=(other);
+    return *this;
+}
+
+template<class Key, class Value, class Compare, class Balance>
+BalancedTree<Key, Value, Compare, Balance>& BalancedTree<Key, Value, Compare, Balance>::operator=(BalancedTree&& other)
+{
+    BinarySearchTree<Key, Value, Compare>::operator=(std::move(other));
+    return *this;
+}
+
+/**
+* Exchanges the contents of two trees in O(1), see
+* BinarySearchTree::swap().
+*/
+template<class Key, class Value, class Compare, class Balance>
+void BalancedTree<Key, Value, Compare, Balance>::swap(BalancedTree& other)
+{
+    BinarySearchTree<Key, Value, Compare>::swap(other);
+}
+
+/**
+* Non-member swap, so that swap(a, b) finds the O(1) version.
+*/
+template<class Key, class Value, class Compare, class Balance>
+void swap(BalancedTree<Key, Value, Compare, Balance>& a, BalancedTree<Key, Value, Compare, Balance>& b)
+{
+    a.swap(b);
+}
+
+template<class Key, class Value, class Compare, class Balance>
+bool BalancedTree<Key, Value, Compare, Balance>::isBalanced() const
+{
+    const NodeType* root = static_cast<const NodeType*>(this->root_);
+    return (root == NULL || root->getParent() == NULL) && linksValid(root) && Balance::isValid(root);
+}
+
+// checks that every child points back at its parent
+template<class Key, class Value, class Compare, class Balance>
+bool BalancedTree<Key, Value, Compare, Balance>::linksValid(const NodeType* node) const
+{
+    if (node == NULL) return true;
+    if ((node->getLeft() != NULL && node->getLeft()->getParent() != node) ||
+        (node->getRight() != NULL && node->getRight()->getParent() != node)) {
+      return false;
+    }
+    return linksValid(node->getLeft()) && linksValid(node->getRight());
+}
+
+/**
+* Swaps two nodes' places, see BinarySearchTree::nodeSwap(). The balance
+* data belongs to the places, so it is swapped back.
+*/
+template<class Key, class Value, class Compare, class Balance>
+void BalancedTree<Key, Value, Compare, Balance>::nodeSwap(Node<Key, Value>* n1, Node<Key, Value>* n2)
+{
+    BinarySearchTree<Key, Value, Compare>::nodeSwap(n1, n2);
+    NodeType* a = static_cast<NodeType*>(n1);
+    NodeType* b = static_cast<NodeType*>(n2);
+    int8_t balance = a->getBalance();
+    a->setBalance(b->getBalance());
+    b->setBalance(balance);
+}
+
+/**
+* A node with two children first trades places with its predecessor,
+* as in the BST. The node then has at most one child, which takes its
+* place before the policy rebalances.
+*/
+template<class Key, class Value, class Compare, class Balance>
+void BalancedTree<Key, Value, Compare, Balance>::eraseNode(Node<Key, Value>* node)
+{
+    NodeType* removed = static_cast<NodeType*>(node);
+    if (removed == NULL) {
+      return;
+    }
+    if (removed->getLeft() != NULL && removed->getRight() != NULL) {
+      nodeSwap(removed, this->predecessor(removed));
+    }
+    NodeType* child = removed->getLeft() != NULL ? removed->getLeft() : removed->getRight();
+    NodeType* parent = removed->getParent();
+    if (child != NULL) {
+      child->setParent(parent);
+    }
+    if (parent == NULL) {
+      this->root_ = child;
+    } else if (parent->getLeft() == removed) {
+      parent->setLeft(child);
+    } else {
+      parent->setRight(child);
+    }
+    Balance::afterErase(*this, removed, child, parent);
+    this->destroyNode(removed);
+}
+
+template<class Key, class Value, class Compare, class Balance>
+Node<Key, Value>* BalancedTree<Key, Value, Compare, Balance>::createNode(const Key& key, const Value& value, Node<Key, Value>* parent)
+{
+    return this->template constructNode<NodeType>(key, value, static_cast<NodeType*>(parent));
+}
+
+/**
+* Same as above, moving the key and value into the node.
+*/
+template<class Key, class Value, class Compare, class Balance>
+Node<Key, Value>* BalancedTree<Key, Value, Compare, Balance>::createNode(Key&& key, Value&& value, Node<Key, Value>* parent)
+{
+    return this->template constructNode<NodeType>(std::move(key), std::move(value), static_cast<NodeType*>(parent));
+}
+
+/**
+* Builds a node in a slot taken from the pool beforehand.
+*/
+template<class Key, class Value, class Compare, class Balance>
+Node<Key, Value>* BalancedTree<Key, Value, Compare, Balance>::placeNode(void* slot, Key&& key, Value&& value)
+{
+    return new (slot) NodeType(std::move(key), std::move(value), NULL);
+}
+
+/**
+* Hands the new leaf to the policy.
+*/
+template<class Key, class Value, class Compare, class Balance>
+void BalancedTree<Key, Value, Compare, Balance>::insertFixup(Node<Key, Value>* node)
+{
+    Balance::afterInsert(*this, static_cast<NodeType*>(node));
+}
+
+/**
+* Copies a node along with its balance data.
+*/
+template<class Key, class Value, class Compare, class Balance>
+Node<Key, Value>* BalancedTree<Key, Value, Compare, Balance>::cloneNode(const Node<Key, Value>* source, Node<Key, Value>* parent)
+{
+    NodeType* copy = static_cast<NodeType*>(createNode(source->getKey(), source->getValue(), parent));
+    copy->setBalance(static_cast<const NodeType*>(source)->getBalance());
+    return copy;
+}
+
+template<class Key, class Value, class Compare, class Balance>
+void BalancedTree<Key, Value, Compare, Balance>::buildFixup(Node<Key, Value>* node, int leftHeight, int rightHeight)
+{
+    Balance::afterBuild(static_cast<NodeType*>(node), leftHeight, rightHeight);
+}
+
+/*
+-----------------------------------------------
+End implementations for the BalancedTree class.
+-----------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,84 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <thread>
+#include <cstdint>
+#include <cstdlib>
+#include "bst.h"
+#include "avlbst.h"
+
+using namespace std;
+
+// Resolves the same random keys (nine in ten present) against an
+// AVLTree with a find() loop and with findBatch() in batches of 1024,
+// for each tree size given on the command line (1M, 4M and 16M by
+// default, all larger than a typical last-level cache).
+
+typedef chrono::steady_clock Clock;
+typedef AVLTree<uint64_t, uint64_t> Tree;
+
+static double msSince(Clock::time_point start)
+{
+    return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+    vector<size_t> sizes;
+    for (int i = 1; i < argc; i++) {
+      sizes.push_back(strtoul(argv[i], NULL, 10));
+    }
+    if (sizes.empty()) {
+      sizes.push_back(1000000);
+      sizes.push_back(4000000);
+      sizes.push_back(16000000);
+    }
+    const size_t batch = 1024;
+
+    cout << "hardware threads: " << thread::hardware_concurrency() << endl;
+    cout << setw(12) << "n" << setw(14) << "find Mkeys/s" << setw(14) << "batch Mkeys/s" << setw(10) << "speedup" << endl;
+    for (size_t s = 0; s < sizes.size(); s++) {
+      size_t n = sizes[s];
+      mt19937_64 rng(104);
+      vector<pair<uint64_t, uint64_t> > items(n);
+      for (size_t i = 0; i < n; i++) {
+        items[i] = make_pair(i * 2, i);
+      }
+      Tree tree;
+      tree.assign(items.begin(), items.end());
+      vector<uint64_t> probes(4 * 1024 * 1024);
+      for (size_t i = 0; i < probes.size(); i++) {
+        probes[i] = rng() % n * 2 + (rng() % 10 == 0 ? 1 : 0);
+      }
+
+      uint64_t loopSum = 0;
+      Clock::time_point start = Clock::now();
+      for (size_t i = 0; i < probes.size(); i++) {
+        Tree::iterator it = tree.find(probes[i]);
+        loopSum += it == tree.end() ? 1 : it->second;
+      }
+      double loopMs = msSince(start);
+
+      uint64_t batchSum = 0;
+      vector<Tree::iterator> found(batch);
+      start = Clock::now();
+      for (size_t i = 0; i < probes.size(); i += batch) {
+        tree.findBatch(&probes[i], batch, found.begin());
+        for (size_t j = 0; j < batch; j++) {
+          batchSum += found[j] == tree.end() ? 1 : found[j]->second;
+        }
+      }
+      double batchMs = msSince(start);
+
+      if (loopSum != batchSum) {
+        cout << "findBatch() disagrees with find()!" << endl;
+        return 1;
+      }
+      cout << setw(12) << n << fixed << setprecision(1) << setw(14) << probes.size() / loopMs / 1000.0
+           << setw(14) << probes.size() / batchMs / 1000.0 << setw(9) << loopMs / batchMs << "x" << endl;
+    }
+    return 0;
+}
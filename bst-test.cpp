@@ -1,10 +1,1581 @@
 #include <iostream>
 #include <map>
+#include <set>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+#include <functional>
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <stdexcept>
 #include "bst.h"
 #include "avlbst.h"
+#include "indexavl.h"
+#include "concurrentavl.h"
+#include "persistentavl.h"
+#include "shardedavl.h"
+#include "btree.h"
+#include "frozenmap.h"
+#include "balancedtree.h"
+#include "splaytree.h"
 
 using namespace std;
 
+// Runs the same random inserts/removes on a tree and a std::map and
+// checks that both hold the same items and that the tree stays balanced.
+template<typename Tree>
+bool matchesMap(const char* name)
+{
+    Tree tree;
+    map<int, int> expected;
+    srand(104);
+    for (int i = 0; i < 4000; i++) {
+      int key = rand() % 500;
+      if (rand() % 3 == 0) {
+        tree.remove(key);
+        expected.erase(key);
+      } else {
+        tree.insert(std::make_pair(key, i));
+        expected[key] = i;
+      }
+    }
+    bool ok = tree.isBalanced();
+    map<int, int>::iterator mit = expected.begin();
+    for (typename Tree::iterator it = tree.begin(); it != tree.end(); ++it, ++mit) {
+      if (mit == expected.end() || it->first != mit->first || it->second != mit->second) {
+        ok = false;
+        break;
+      }
+    }
+    ok = ok && mit == expected.end() && tree.size() == expected.size();
+    cout << name << (ok ? " matches std::map" : " DOES NOT match std::map") << endl;
+    return ok;
+}
+
+
+// Builds a tree from sorted input (with duplicate keys) and checks that it
+// comes out balanced, holds the last value for each key, and still
+// behaves after more inserts and removes (staying balanced if it should).
+template<typename Tree>
+bool bulkLoads(const char* name, bool selfBalancing)
+{
+    vector<pair<int, int> > items;
+    for (int i = 0; i < 1000; i++) {
+      items.push_back(make_pair(i / 2, i));
+    }
+    Tree tree(items.begin(), items.end());
+    bool ok = tree.isBalanced();
+    int expectedKey = 0;
+    for (typename Tree::iterator it = tree.begin(); it != tree.end(); ++it, ++expectedKey) {
+      ok = ok && it->first == expectedKey && it->second == 2 * expectedKey + 1;
+    }
+    ok = ok && expectedKey == 500;
+    for (int i = 0; i < 500; i += 3) {
+      tree.remove(i);
+    }
+    for (int i = 500; i < 700; i++) {
+      tree.insert(make_pair(i, i));
+    }
+    int count = 0, prevKey = -1;
+    for (typename Tree::iterator it = tree.begin(); it != tree.end(); ++it, ++count) {
+      ok = ok && prevKey < it->first;
+      prevKey = it->first;
+    }
+    ok = ok && count == 500 - 167 + 200;
+    ok = ok && (!selfBalancing || tree.isBalanced());
+    cout << name << (ok ? " bulk loads sorted input" : " FAILED to bulk load sorted input") << endl;
+    return ok;
+}
+
+// Value whose copies can be made to throw, counting the live ones.
+struct Fragile
+{
+    static int live;
+    static int copiesLeft;
+    Fragile(int v = 0) : value(v) { ++live; }
+    Fragile(const Fragile& other) : value(other.value)
+    {
+      if (copiesLeft-- == 0) throw runtime_error("copy failed");
+      ++live;
+    }
+    ~Fragile() { --live; }
+    int value;
+};
+ostream& operator<<(ostream& out, const Fragile& f) { return out << f.value; }
+int Fragile::live = 0;
+int Fragile::copiesLeft = -1;
+
+// Bulk loads sorted input whose copies fail at every point of the build,
+// through assign() and the range constructor, and checks that nothing
+// built so far is left behind and the tree can still be loaded.
+template<typename Tree>
+bool bulkLoadsThrowSafely(const char* name)
+{
+    vector<pair<int, Fragile> > items;
+    for (int i = 0; i < 100; i++) {
+      items.push_back(make_pair(i, Fragile(i)));
+    }
+    bool ok = true;
+    for (int fail = 0; fail < 100 && ok; fail += 7) {
+      Tree tree;
+      tree.insert(make_pair(-1, Fragile(-1)));
+      Fragile::copiesLeft = fail;
+      try {
+        tree.assign(items.begin(), items.end());
+        ok = false;
+      } catch (const runtime_error&) {
+      }
+      Fragile::copiesLeft = fail;
+      try {
+        Tree built(items.begin(), items.end());
+        ok = false;
+      } catch (const runtime_error&) {
+      }
+      Fragile::copiesLeft = -1;
+      ok = ok && tree.empty() && tree.begin() == tree.end() && Fragile::live == 100;
+      tree.assign(items.begin(), items.end());
+      ok = ok && tree.size() == 100 && tree.isBalanced() && tree.begin()->second.value == 0;
+    }
+    ok = ok && Fragile::live == 100;
+    cout << name << (ok ? " bulk loads safely when a copy throws" : " FAILED throwing bulk load checks") << endl;
+    return ok;
+}
+
+// Inserts into an IndexedAVLTree whose copies throw, once into a slot
+// off the free list and once at the end of the array, and checks that
+// the failed slots hold no item the tree would destroy later.
+bool indexedInsertsThrowSafely()
+{
+    bool ok = true;
+    int before = Fragile::live;
+    {
+      IndexedAVLTree<int, Fragile> tree;
+      for (int i = 0; i < 40; i++) {
+        tree.insert(make_pair(i, Fragile(i)));
+      }
+      tree.remove(7);
+      pair<const int, Fragile> reused(100, Fragile(100)), appended(101, Fragile(101));
+      for (int round = 0; round < 2; round++) {
+        Fragile::copiesLeft = 0;
+        try {
+          tree.insert(round == 0 ? reused : appended);
+          ok = false;
+        } catch (const runtime_error&) {
+        }
+        Fragile::copiesLeft = -1;
+        ok = ok && tree.size() == size_t(39 + round) && tree.isBalanced() && Fragile::live == before + 39 + round + 2;
+        // use up the free slot, so the second round appends
+        tree.insert(make_pair(200 + round, Fragile(200 + round)));
+        tree.remove(200 + round);
+        tree.insert(make_pair(300 + round, Fragile(300 + round)));
+      }
+    }
+    ok = ok && Fragile::live == before;
+    cout << "IndexedAVLTree" << (ok ? " inserts safely when a copy throws" : " FAILED throwing insert checks") << endl;
+    return ok;
+}
+
+// Transparent comparator that orders std::string keys and can also compare
+// them against C strings directly, so lookups never build a std::string.
+struct CStringLess
+{
+    typedef void is_transparent;
+    bool operator()(const string& a, const string& b) const { return a < b; }
+    bool operator()(const char* a, const string& b) const { return b.compare(a) > 0; }
+    bool operator()(const string& a, const char* b) const { return a.compare(b) < 0; }
+};
+
+// Comparator with a three-way compare() member that counts its calls.
+struct CountingCompare
+{
+    CountingCompare(int* calls) : calls_(calls) { }
+    bool operator()(int a, int b) const { ++*calls_; return a < b; }
+    int compare(int a, int b) const { ++*calls_; return a < b ? -1 : (b < a ? 1 : 0); }
+    int* calls_;
+};
+
+bool comparators()
+{
+    bool ok = true;
+
+    // reverse order
+    AVLTree<int, int, greater<int> > reversed;
+    for (int i = 0; i < 100; i++) {
+      reversed.insert(make_pair(i, i));
+    }
+    int expected = 99;
+    for (AVLTree<int, int, greater<int> >::iterator it = reversed.begin(); it != reversed.end(); ++it) {
+      ok = ok && it->first == expected--;
+    }
+    ok = ok && reversed.isBalanced() && expected == -1;
+
+    // heterogeneous lookup
+    BinarySearchTree<string, int, CStringLess> names;
+    names.insert(make_pair(string("carol"), 3));
+    names.insert(make_pair(string("alice"), 1));
+    names.insert(make_pair(string("bob"), 2));
+    ok = ok && names.find("bob") != names.end() && names.find("bob")->second == 2;
+    ok = ok && names.find("dave") == names.end();
+
+    // one three-way comparison per level: a 1023-node perfect tree has
+    // 10 levels, so no lookup may take more than 10 calls
+    int calls = 0;
+    vector<pair<int, int> > items;
+    for (int i = 0; i < 1023; i++) {
+      items.push_back(make_pair(i, i));
+    }
+    AVLTree<int, int, CountingCompare> counted(items.begin(), items.end(), CountingCompare(&calls));
+    for (int i = 0; i < 1023; i++) {
+      calls = 0;
+      ok = ok && counted.find(i) != counted.end() && calls <= 10;
+    }
+
+    cout << "Comparators " << (ok ? "work" : "FAILED") << endl;
+    return ok;
+}
+
+// Value type that counts how often it is constructed and copied.
+struct Tracked
+{
+    static int constructed;
+    static int copies;
+    Tracked(int v = 0) : value(v) { ++constructed; }
+    Tracked(const Tracked& other) : value(other.value) { ++copies; }
+    Tracked(Tracked&& other) : value(other.value) { other.value = -1; }
+    Tracked& operator=(const Tracked& other) { value = other.value; ++copies; return *this; }
+    Tracked& operator=(Tracked&& other) { value = other.value; other.value = -1; return *this; }
+    int value;
+};
+ostream& operator<<(ostream& out, const Tracked& t) { return out << t.value; }
+int Tracked::constructed = 0;
+int Tracked::copies = 0;
+
+// Checks the emplace family: return values, overwrite rules, and that
+// values are moved rather than copied.
+template<typename Tree>
+bool emplaces(const char* name)
+{
+    Tree tree;
+    bool ok = true;
+    Tracked::constructed = Tracked::copies = 0;
+    for (int i = 0; i < 200; i++) {
+      pair<typename Tree::iterator, bool> res = tree.emplace(i, Tracked(i));
+      ok = ok && res.second && res.first->first == i && res.first->second.value == i;
+    }
+    // insert and emplace overwrite, the bool reports that no node was added
+    ok = ok && !tree.insert(make_pair(5, Tracked(50))).second && tree[5].value == 50;
+    ok = ok && !tree.emplace(6, Tracked(60)).second && tree[6].value == 60;
+    ok = ok && tree.insert(make_pair(500, Tracked(500))).second;
+
+    // try_emplace must not even construct the value for an existing key
+    int before = Tracked::constructed;
+    pair<typename Tree::iterator, bool> res = tree.try_emplace(7, 70);
+    ok = ok && !res.second && res.first->second.value == 7 && Tracked::constructed == before;
+    res = tree.try_emplace(700, 700);
+    ok = ok && res.second && res.first->second.value == 700 && Tracked::constructed == before + 1;
+
+    res = tree.insert_or_assign(8, Tracked(80));
+    ok = ok && !res.second && res.first->second.value == 80;
+    res = tree.insert_or_assign(800, Tracked(800));
+    ok = ok && res.second && tree[800].value == 800;
+
+    Tracked moved(900);
+    tree.insert(pair<const int, Tracked>(900, std::move(moved)));
+    ok = ok && tree[900].value == 900 && Tracked::copies == 0;
+    ok = ok && tree.isBalanced();
+    cout << name << (ok ? " emplaces correctly" : " FAILED emplace checks") << endl;
+    return ok;
+}
+
+// Checks that two trees have the same shape and items.
+bool sameShape(Node<int, int>* a, Node<int, int>* b)
+{
+    if (a == NULL || b == NULL) return a == b;
+    return a->getItem() == b->getItem()
+        && sameShape(a->getLeft(), b->getLeft())
+        && sameShape(a->getRight(), b->getRight());
+}
+
+// Exposes the root so the shape of a copy can be compared, the
+// memory of the node pool, and the swap() of the plain BST, which is
+// protected.
+template<typename Tree>
+struct Inspected : public Tree
+{
+    using Tree::swap;
+    Node<int, int>* root() const { return this->root_; }
+    size_t poolBytes() const { return this->pool_.bytesReserved(); }
+};
+
+// Checks copy, move and swap: a copy is independent of its source and
+// has the same shape, a moved-from tree is empty.
+template<typename Tree>
+bool copies(const char* name)
+{
+    Inspected<Tree> original;
+    srand(7);
+    for (int i = 0; i < 2000; i++) {
+      original.insert(make_pair(rand() % 1000, i));
+    }
+    Inspected<Tree> copy(original);
+    bool ok = sameShape(original.root(), copy.root()) && copy.isBalanced() == original.isBalanced();
+    copy.insert(make_pair(5000, 1));
+    copy.remove(original.begin()->first);
+    ok = ok && original.find(5000) == original.end() && copy.find(original.begin()->first) == copy.end();
+
+    Inspected<Tree> assigned;
+    assigned.insert(make_pair(-1, -1));
+    assigned = original;
+    ok = ok && sameShape(original.root(), assigned.root()) && assigned.find(-1) == assigned.end();
+
+    Inspected<Tree> moved(std::move(assigned));
+    ok = ok && assigned.empty() && sameShape(original.root(), moved.root());
+    assigned = std::move(moved);
+    ok = ok && moved.empty() && sameShape(original.root(), assigned.root());
+
+    assigned.swap(copy);
+    ok = ok && sameShape(original.root(), copy.root()) && assigned.find(5000) != assigned.end();
+    // the moved-from trees are still usable
+    moved.insert(make_pair(1, 1));
+    ok = ok && moved.find(1) != moved.end();
+    cout << name << (ok ? " copies and moves correctly" : " FAILED copy/move checks") << endl;
+    return ok;
+}
+
+// Whether a.swap(b) or swap(a, b) compiles for a tree a of type A and
+// b of type B.
+template<typename A, typename B>
+struct CanSwap
+{
+    template<typename X, typename Y>
+    static char member(decltype(std::declval<X&>().swap(std::declval<Y&>()))*);
+    template<typename X, typename Y>
+    static long member(...);
+    template<typename X, typename Y>
+    static char nonMember(decltype(swap(std::declval<X&>(), std::declval<Y&>()))*);
+    template<typename X, typename Y>
+    static long nonMember(...);
+    static const bool value = sizeof(member<A, B>(0)) == 1 || sizeof(nonMember<A, B>(0)) == 1;
+};
+
+// Checks that only trees of the same type can trade nodes: swapping or
+// move-assigning through the BST base would hand a tree a node pool
+// with another node type's slots, and copy-assigning would read balance
+// data from nodes that have none.
+bool swapsOnlyItsOwnType()
+{
+    typedef BinarySearchTree<int, int> Plain;
+    typedef AVLTree<int, int> AVL;
+    typedef AVLTree<int, int, std::less<int>, ThreadedAVLNode<int, int> > Threaded;
+    bool ok = CanSwap<AVL, AVL>::value && CanSwap<Threaded, Threaded>::value
+        && CanSwap<WAVLTree<int, int>, WAVLTree<int, int> >::value
+        && CanSwap<SplayTree<int, int>, SplayTree<int, int> >::value;
+    ok = ok && !CanSwap<AVL, Plain>::value && !CanSwap<Plain, AVL>::value
+        && !CanSwap<Threaded, AVL>::value && !CanSwap<AVL, Threaded>::value
+        && !CanSwap<Plain, Plain>::value
+        && !CanSwap<WAVLTree<int, int>, RedBlackTree<int, int> >::value
+        && !CanSwap<SplayTree<int, int>, Plain>::value && !CanSwap<Plain, SplayTree<int, int> >::value;
+    ok = ok && is_assignable<AVL&, AVL&&>::value && !is_assignable<AVL&, Plain&&>::value
+        && !is_assignable<Threaded&, AVL&&>::value
+        && !is_assignable<SplayTree<int, int>&, Plain&&>::value;
+    // nor copied into through the base, e.g. a plain tree's nodes into
+    // an AVLTree
+    ok = ok && is_assignable<AVL&, const AVL&>::value && is_assignable<SplayTree<int, int>&, const SplayTree<int, int>&>::value
+        && !is_assignable<Plain&, const Plain&>::value && !is_assignable<Plain&, const AVL&>::value
+        && !is_assignable<AVL&, const Plain&>::value && !is_assignable<Threaded&, const AVL&>::value
+        && !is_assignable<WAVLTree<int, int>&, const RedBlackTree<int, int>&>::value
+        && !is_assignable<SplayTree<int, int>&, const Plain&>::value;
+    cout << (ok ? "Trees only swap and assign with their own type" : "FAILED: trees of different types can swap or assign") << endl;
+    return ok;
+}
+
+// Value with a destructor, so clear() has to visit every node.
+struct Counted
+{
+    static size_t destroyed;
+    Counted(int v = 0) : value(v) { }
+    ~Counted() { ++destroyed; }
+    int value;
+};
+ostream& operator<<(ostream& out, const Counted& c) { return out << c.value; }
+size_t Counted::destroyed = 0;
+
+// A tree that can grow a right-leaning chain in O(1) per node, which
+// is what monotonic inserts produce, minus the O(n^2) searching.
+struct ChainTree : public BinarySearchTree<int, Counted>
+{
+    void growChain(int n)
+    {
+      Node<int, Counted>* last = NULL;
+      for (int i = 0; i < n; i++) {
+        Node<int, Counted>* node = createNode(i, Counted(i), last);
+        linkNode(node, last, false);
+        last = node;
+      }
+    }
+};
+
+// Checks that isBalanced(), clear() and the destructor cope with a
+// degenerate tree far deeper than the call stack could handle.
+bool deepChain(int n)
+{
+    bool ok = true;
+    {
+      ChainTree chain;
+      chain.growChain(n);
+      ok = ok && !chain.isBalanced();
+      Counted::destroyed = 0;
+      chain.clear();
+      ok = ok && chain.empty() && Counted::destroyed == size_t(n);
+
+      // the destructor takes the same path
+      chain.growChain(n);
+      Counted::destroyed = 0;
+    }
+    ok = ok && Counted::destroyed == size_t(n);
+    cout << n << "-node chain " << (ok ? "is torn down safely" : "FAILED") << endl;
+    return ok;
+}
+
+// Caps an index at the size of the tree.
+template<typename Tree>
+size_t keysBefore(const Tree& tree, size_t k)
+{
+    return k < tree.size() ? k : tree.size();
+}
+
+// Checks select(), rank() and iterator += n against a sorted copy of
+// the keys while the tree is churned.
+bool orderStatistics()
+{
+    typedef AVLTree<int, int, std::less<int>, SizedAVLNode<int, int> > Tree;
+    Tree tree;
+    map<int, int> expected;
+    bool ok = true;
+    srand(11);
+    for (int round = 0; round < 20; round++) {
+      for (int i = 0; i < 300; i++) {
+        int key = rand() % 1000;
+        if (rand() % 3 == 0) {
+          tree.remove(key);
+          expected.erase(key);
+        } else {
+          tree.insert(std::make_pair(key, i));
+          expected[key] = i;
+        }
+      }
+      vector<int> keys;
+      for (map<int, int>::iterator it = expected.begin(); it != expected.end(); ++it) {
+        keys.push_back(it->first);
+      }
+      ok = ok && tree.size() == keys.size() && tree.select(keys.size()) == tree.end();
+      for (size_t k = 0; k < keys.size(); k++) {
+        ok = ok && tree.select(k)->first == keys[k] && tree.rank(keys[k]) == k;
+        // a missing key ranks where it would be inserted
+        ok = ok && tree.rank(keys[k] + 1) == k + 1;
+      }
+      Tree::iterator it = tree.begin();
+      it += 5;
+      ok = ok && it->first == keys[5];
+      it += -3;
+      ok = ok && it->first == keys[2];
+      it += keys.size();
+      ok = ok && it == tree.end();
+    }
+    // cutting out a range keeps the sizes right
+    tree.erase(tree.select(10), tree.select(keysBefore(tree, 60)));
+    size_t k = 0;
+    for (Tree::iterator it = tree.begin(); it != tree.end(); ++it, ++k) {
+      ok = ok && tree.select(k) == it && tree.rank(it->first) == k;
+    }
+    ok = ok && k == tree.size();
+
+    Tree copy(tree);
+    ok = ok && copy.select(17)->first == tree.select(17)->first && copy.size() == tree.size();
+
+    // sizes set up by a bulk load
+    vector<pair<int, int> > items;
+    for (int i = 0; i < 100; i++) {
+      items.push_back(make_pair(2 * i, i));
+    }
+    Tree loaded(items.begin(), items.end());
+    for (int i = 0; i < 100; i++) {
+      ok = ok && loaded.select(i)->first == 2 * i && loaded.rank(2 * i + 1) == size_t(i) + 1;
+    }
+    cout << "Order statistics " << (ok ? "work" : "FAILED") << endl;
+    return ok;
+}
+
+// Checks lower_bound, upper_bound, equal_range and range views against
+// std::map on a tree holding the even numbers below 200.
+template<typename Tree>
+bool boundsMatch(const char* name)
+{
+    Tree tree;
+    map<int, int> expected;
+    for (int i = 0; i < 200; i += 2) {
+      tree.insert(make_pair(i, i));
+      expected[i] = i;
+    }
+    bool ok = true;
+    for (int key = -3; key < 205; key++) {
+      typename Tree::iterator lb = tree.lower_bound(key);
+      typename Tree::iterator ub = tree.upper_bound(key);
+      map<int, int>::iterator mlb = expected.lower_bound(key);
+      map<int, int>::iterator mub = expected.upper_bound(key);
+      ok = ok && (lb == tree.end() ? mlb == expected.end() : mlb != expected.end() && lb->first == mlb->first);
+      ok = ok && (ub == tree.end() ? mub == expected.end() : mub != expected.end() && ub->first == mub->first);
+      pair<typename Tree::iterator, typename Tree::iterator> eq = tree.equal_range(key);
+      ok = ok && eq.first == lb && eq.second == ub;
+    }
+    for (int lo = -3; lo < 205; lo += 7) {
+      for (int hi = lo - 5; hi < 210; hi += 11) {
+        int count = 0;
+        int last = lo - 1;
+        typename Tree::RangeView view = tree.range(lo, hi);
+        for (typename Tree::iterator it = view.begin(); it != view.end(); ++it) {
+          ok = ok && it->first >= lo && it->first < hi && it->first > last;
+          last = it->first;
+          count++;
+        }
+        int want = 0;
+        for (map<int, int>::iterator it = expected.begin(); it != expected.end(); ++it) {
+          want += (it->first >= lo && it->first < hi);
+        }
+        ok = ok && count == want && view.empty() == (want == 0);
+      }
+    }
+    cout << name << (ok ? " bounds match std::map" : " bounds DO NOT match std::map") << endl;
+    return ok;
+}
+
+// Checks that iterators walk both ways, that end() can be decremented
+// and that std:: algorithms work on the tree as it is.
+template<typename Tree>
+bool iteratesBothWays(const char* name)
+{
+    Tree tree;
+    for (int i = 0; i < 100; i++) {
+      tree.insert(make_pair((i * 37) % 100, i));
+    }
+    const Tree& view = tree;
+    bool ok = true;
+
+    // newest-first scan straight off the tree
+    int expected = 99;
+    for (typename Tree::const_reverse_iterator it = view.rbegin(); it != view.rend(); ++it) {
+      ok = ok && it->first == expected--;
+    }
+    ok = ok && expected == -1;
+
+    typename Tree::iterator last = tree.end();
+    --last;
+    ok = ok && last->first == 99;
+    typename Tree::iterator it = tree.begin();
+    typename Tree::iterator old = it++;
+    ok = ok && old->first == 0 && it->first == 1;
+    old = it--;
+    ok = ok && old->first == 1 && it == tree.begin();
+
+    // mixed comparisons and the std algorithms
+    typename Tree::const_iterator cit = tree.find(50);
+    ok = ok && cit != view.end() && tree.find(50) == cit && cit == tree.find(50);
+    ok = ok && std::distance(view.begin(), view.end()) == 100;
+    ok = ok && std::prev(view.end())->first == 99 && std::next(view.begin(), 3)->first == 3;
+    typename Tree::const_iterator big = std::find_if(view.begin(), view.end(), [](const pair<const int, int>& item) { return item.first >= 42; });
+    ok = ok && big->first == 42;
+    ok = ok && std::is_sorted(tree.begin(), tree.end(), [](const pair<const int, int>& a, const pair<const int, int>& b) { return a.first < b.first; });
+    std::for_each(tree.begin(), tree.end(), [](pair<const int, int>& item) { item.second = -item.first; });
+    ok = ok && tree[7] == -7;
+
+    Tree empty;
+    ok = ok && empty.begin() == empty.end() && empty.rbegin() == empty.rend();
+    cout << name << (ok ? " iterates both ways" : " FAILED iterator checks") << endl;
+    return ok;
+}
+
+// Returns the height of the subtree under node, clearing ok if a parent
+// link or an AVL balance factor does not match the actual shape.
+template<typename NodeT>
+int checkedHeight(NodeT* node, bool& ok)
+{
+    if (node == NULL) return 0;
+    if ((node->getLeft() != NULL && node->getLeft()->getParent() != node) ||
+        (node->getRight() != NULL && node->getRight()->getParent() != node)) {
+      ok = false;
+    }
+    int left = checkedHeight(node->getLeft(), ok);
+    int right = checkedHeight(node->getRight(), ok);
+    if (node->getBalance() != left - right) ok = false;
+    return 1 + max(left, right);
+}
+
+// Removes random single items and ranges by iterator from a tree and a
+// std::map and checks that they agree, and for AVL trees that the balance
+// factors and parent links are still exact.
+template<typename Tree, typename NodeT>
+bool erasesRanges(const char* name, bool selfBalancing)
+{
+    Inspected<Tree> tree;
+    map<int, int> expected;
+    bool ok = true;
+    srand(23);
+    for (int round = 0; round < 200; round++) {
+      for (int i = 0; i < 100; i++) {
+        int key = rand() % 2000;
+        tree.insert(make_pair(key, i));
+        expected[key] = i;
+      }
+      int lo = rand() % 2000;
+      int hi = lo + rand() % (round % 4 == 0 ? 2000 : 100);
+      typename Tree::iterator first = tree.lower_bound(lo);
+      typename Tree::iterator last = round % 10 == 0 ? tree.end() : tree.lower_bound(hi);
+      map<int, int>::iterator mlast = round % 10 == 0 ? expected.end() : expected.lower_bound(hi);
+      typename Tree::iterator after = tree.erase(first, last);
+      expected.erase(expected.lower_bound(lo), mlast);
+      ok = ok && after == last;
+
+      // and one item on its own, checking the returned successor
+      typename Tree::iterator one = tree.lower_bound(rand() % 2000);
+      if (one != tree.end()) {
+        int key = one->first;
+        typename Tree::iterator next = tree.erase(one);
+        map<int, int>::iterator mnext = expected.upper_bound(key);
+        expected.erase(key);
+        ok = ok && (next == tree.end() ? mnext == expected.end() : next->first == mnext->first);
+      }
+      if (round % 20 == 0) {
+        checkedHeight(static_cast<NodeT*>(tree.root()), ok);
+      }
+    }
+    map<int, int>::iterator mit = expected.begin();
+    for (typename Tree::iterator it = tree.begin(); it != tree.end(); ++it, ++mit) {
+      ok = ok && mit != expected.end() && it->first == mit->first && it->second == mit->second;
+    }
+    ok = ok && mit == expected.end() && tree.size() == expected.size();
+    ok = ok && (!selfBalancing || tree.isBalanced());
+    checkedHeight(static_cast<NodeT*>(tree.root()), ok);
+    cout << name << (ok ? " erases ranges correctly" : " FAILED erase checks") << endl;
+    return ok;
+}
+
+// Plain BST nodes have no balance to check.
+template<>
+int checkedHeight(Node<int, int>* node, bool& ok)
+{
+    if (node == NULL) return 0;
+    if ((node->getLeft() != NULL && node->getLeft()->getParent() != node) ||
+        (node->getRight() != NULL && node->getRight()->getParent() != node)) {
+      ok = false;
+    }
+    return 1 + max(checkedHeight(node->getLeft(), ok), checkedHeight(node->getRight(), ok));
+}
+
+// Inserts ascending keys with end() as the hint, descending keys with
+// begin(), then random keys with hints that are mostly wrong, and checks
+// the result against std::map. Both ends of the tree are also checked
+// after erasing from them, since begin() and end() are cached.
+template<typename Tree, typename NodeT>
+bool insertsWithHints(const char* name, bool selfBalancing)
+{
+    Inspected<Tree> tree;
+    map<int, int> expected;
+    bool ok = true;
+    for (int i = 0; i < 1000; i++) {
+      typename Tree::iterator it = tree.emplace_hint(tree.end(), i, i);
+      expected[i] = i;
+      ok = ok && it->first == i && std::prev(tree.end()) == it;
+    }
+    for (int i = -1; i >= -1000; i--) {
+      typename Tree::iterator it = tree.insert(tree.begin(), make_pair(i, i));
+      expected[i] = i;
+      ok = ok && it->first == i && tree.begin() == it;
+    }
+    srand(31);
+    for (int i = 0; i < 4000; i++) {
+      int key = rand() % 6000 - 3000;
+      typename Tree::iterator hint = i % 3 == 0 ? tree.upper_bound(key) : tree.lower_bound(rand() % 6000 - 3000);
+      typename Tree::iterator it = tree.insert(hint, make_pair(key, i));
+      expected[key] = i;
+      ok = ok && it->first == key && it->second == i;
+      if (i % 100 == 0) {
+        tree.erase(tree.begin());
+        tree.erase(std::prev(tree.end()));
+        expected.erase(expected.begin());
+        expected.erase(std::prev(expected.end()));
+        ok = ok && tree.begin()->first == expected.begin()->first;
+        ok = ok && tree.rbegin()->first == expected.rbegin()->first;
+      }
+    }
+    map<int, int>::iterator mit = expected.begin();
+    for (typename Tree::iterator it = tree.begin(); it != tree.end(); ++it, ++mit) {
+      ok = ok && mit != expected.end() && it->first == mit->first && it->second == mit->second;
+    }
+    ok = ok && mit == expected.end() && tree.size() == expected.size();
+    ok = ok && (!selfBalancing || tree.isBalanced());
+    checkedHeight(static_cast<NodeT*>(tree.root()), ok);
+
+    tree.erase(tree.begin(), tree.end());
+    ok = ok && tree.empty() && tree.begin() == tree.end();
+    tree.emplace_hint(tree.begin(), 5, 5);
+    ok = ok && tree.begin()->first == 5 && std::prev(tree.end())->first == 5;
+    cout << name << (ok ? " inserts with hints correctly" : " FAILED hinted insert checks") << endl;
+    return ok;
+}
+
+// Returns true if tree holds exactly the keys lo..hi-1 that are in keys,
+// with a valid shape and a size() that agrees.
+template<typename Tree, typename NodeT>
+bool holdsKeys(Inspected<Tree>& tree, const set<int>& keys, int lo, int hi)
+{
+    bool ok = true;
+    set<int>::const_iterator want = keys.lower_bound(lo);
+    size_t count = 0;
+    for (typename Tree::iterator it = tree.begin(); it != tree.end(); ++it, ++want, count++) {
+      ok = ok && want != keys.end() && *want < hi && it->first == *want && it->second == -*want;
+    }
+    ok = ok && (want == keys.end() || *want >= hi) && tree.size() == count && tree.isBalanced();
+    checkedHeight(static_cast<NodeT*>(tree.root()), ok);
+    return ok;
+}
+
+// Splits a tree at present and missing keys, checks the three parts and
+// joins them back together, including joins into one of the parts and
+// parts that outlive the tree they came from.
+template<typename Tree, typename NodeT>
+bool splitsAndJoins(const char* name)
+{
+    bool ok = true;
+    srand(47);
+    for (int round = 0; round < 40; round++) {
+      set<int> keys;
+      Inspected<Tree> tree;
+      for (int i = 0; i < round * 50; i++) {
+        int key = rand() % 4000;
+        keys.insert(key);
+        tree.insert(make_pair(key, -key));
+      }
+      int at = rand() % 4100 - 50;
+      Inspected<Tree>* less = new Inspected<Tree>;
+      Inspected<Tree> greater;
+      less->insert(make_pair(1, 1));
+      bool found = tree.split(at, *less, greater);
+      ok = ok && found == (keys.count(at) == 1) && tree.size() == (found ? 1 : 0);
+      ok = ok && holdsKeys<Tree, NodeT>(*less, keys, INT_MIN, at) && holdsKeys<Tree, NodeT>(greater, keys, at + 1, INT_MAX);
+
+      // the parts must still work once the tree they came from is gone
+      if (round % 2 == 0) {
+        tree.clear();
+      }
+      for (int i = 0; i < 20; i++) {
+        int key = rand() % 4000;
+        if (key < at) {
+          keys.insert(key);
+          less->insert(make_pair(key, -key));
+        } else if (key > at) {
+          keys.insert(key);
+          greater.insert(make_pair(key, -key));
+        }
+      }
+      keys.insert(at);
+      if (round % 3 == 0) {
+        less->join(*less, make_pair(at, -at), greater);
+        ok = ok && greater.empty() && holdsKeys<Tree, NodeT>(*less, keys, INT_MIN, INT_MAX);
+        less->remove(at);
+        less->insert(make_pair(at, -at));
+        delete less;
+      } else {
+        tree.join(*less, make_pair(at, -at), greater);
+        delete less;
+        ok = ok && greater.empty() && holdsKeys<Tree, NodeT>(tree, keys, INT_MIN, INT_MAX);
+        tree.erase(tree.begin(), tree.find(at));
+      }
+      // a part that traded nodes still hands its slabs back when cleared
+      // (without the pool, nodes go back to the system one at a time)
+      greater.insert(make_pair(at, -at));
+      greater.clear();
+      ok = ok && (!NodePool::releasesInBulk || greater.poolBytes() == 0);
+    }
+    cout << name << (ok ? " splits and joins correctly" : " FAILED split/join checks") << endl;
+    return ok;
+}
+
+// Returns true if tree holds exactly the items of expected, with a valid
+// shape and a size() that agrees.
+template<typename Tree, typename NodeT>
+bool equalsMap(Inspected<Tree>& tree, const map<int, int>& expected)
+{
+    bool ok = true;
+    map<int, int>::const_iterator mit = expected.begin();
+    for (typename Tree::iterator it = tree.begin(); it != tree.end(); ++it, ++mit) {
+      ok = ok && mit != expected.end() && it->first == mit->first && it->second == mit->second;
+    }
+    ok = ok && mit == expected.end() && tree.size() == expected.size() && tree.isBalanced();
+    checkedHeight(static_cast<NodeT*>(tree.root()), ok);
+    return ok;
+}
+
+// Checks union, intersection and difference against std::map, summing
+// the values of colliding keys, on trees large enough for the recursion
+// to fork as well as on small and empty ones.
+template<typename Tree, typename NodeT>
+bool combinesSets(const char* name)
+{
+    bool ok = true;
+    srand(59);
+    const int sizes[][2] = { { 30000, 20000 }, { 20000, 50 }, { 50, 20000 }, { 0, 100 }, { 100, 0 }, { 300, 300 } };
+    for (int round = 0; round < 6; round++) {
+      for (int op = 0; op < 3; op++) {
+        Inspected<Tree> a, b;
+        map<int, int> ma, mb;
+        for (int i = 0; i < sizes[round][0]; i++) {
+          int key = rand() % 100000;
+          a.insert(make_pair(key, i));
+          ma[key] = i;
+        }
+        for (int i = 0; i < sizes[round][1]; i++) {
+          int key = rand() % 100000;
+          b.insert(make_pair(key, -i));
+          mb[key] = -i;
+        }
+        map<int, int> expected;
+        if (op == 0) {
+          a.unionWith(b, [](int ours, int theirs) { return ours + theirs; });
+          expected = ma;
+          for (map<int, int>::iterator it = mb.begin(); it != mb.end(); ++it) {
+            expected[it->first] += it->second;
+          }
+        } else if (op == 1) {
+          a.intersectWith(b, [](int ours, int theirs) { return ours + theirs; });
+          for (map<int, int>::iterator it = mb.begin(); it != mb.end(); ++it) {
+            if (ma.count(it->first)) expected[it->first] = ma[it->first] + it->second;
+          }
+        } else {
+          a.differenceWith(b);
+          expected = ma;
+          for (map<int, int>::iterator it = mb.begin(); it != mb.end(); ++it) {
+            expected.erase(it->first);
+          }
+        }
+        ok = ok && b.empty() && b.size() == 0 && equalsMap<Tree, NodeT>(a, expected);
+      }
+    }
+    Inspected<Tree> c;
+    map<int, int> mc;
+    for (int i = 0; i < 100; i++) {
+      c.insert(make_pair(i, i));
+      mc[i] = i;
+    }
+    c.unionWith(c);
+    c.intersectWith(c);
+    ok = ok && equalsMap<Tree, NodeT>(c, mc);
+    c.differenceWith(c);
+    ok = ok && c.empty();
+    cout << name << (ok ? " combines sets correctly" : " FAILED set operation checks") << endl;
+    return ok;
+}
+
+// Bulk loads unsorted items with many repeated keys, which must keep
+// their last value, and checks the tree against std::map before and
+// after some ordinary inserts and erases on top of it.
+template<typename Tree, typename NodeT>
+bool assignsUnsorted(const char* name)
+{
+    bool ok = true;
+    srand(61);
+    const int sizes[] = { 0, 1, 10, 5000, 100000 };
+    for (int round = 0; round < 5; round++) {
+      vector<pair<int, int> > items;
+      map<int, int> expected;
+      for (int i = 0; i < sizes[round]; i++) {
+        int key = rand() % (sizes[round] / 3 + 1);
+        items.push_back(make_pair(key, i));
+        expected[key] = i;
+      }
+      Inspected<Tree> tree;
+      tree.insert(make_pair(-1, -1));
+      tree.assignUnsorted(items);
+      ok = ok && equalsMap<Tree, NodeT>(tree, expected);
+      for (int i = 0; i < 200; i++) {
+        int key = rand() % (sizes[round] + 1);
+        if (i % 2) {
+          tree.insert(make_pair(key, i));
+          expected[key] = i;
+        } else {
+          tree.remove(key);
+          expected.erase(key);
+        }
+      }
+      ok = ok && equalsMap<Tree, NodeT>(tree, expected);
+    }
+    cout << name << (ok ? " bulk loads unsorted input" : " FAILED unsorted bulk load checks") << endl;
+    return ok;
+}
+
+// Value type that counts its live instances.
+struct Live
+{
+    static int live;
+    Live(int v = 0) : value(v) { ++live; }
+    Live(const Live& other) : value(other.value) { ++live; }
+    ~Live() { --live; }
+    Live& operator=(const Live& other) { value = other.value; return *this; }
+    int value;
+};
+int Live::live = 0;
+
+// Checks that snapshots of a PersistentAVLTree keep the items they were
+// taken with however the tree changes later, also while another thread
+// reads one, and that every node is freed once the last version is gone.
+bool persistentSnapshots()
+{
+    typedef PersistentAVLTree<int, Live> Tree;
+    bool ok = true;
+    {
+      Tree tree;
+      map<int, int> expected;
+      vector<pair<Tree::Snapshot, map<int, int> > > versions;
+      srand(18);
+      for (int i = 0; i < 6000; i++) {
+        int key = rand() % 700;
+        if (rand() % 3 == 0) {
+          tree.remove(key);
+          expected.erase(key);
+        } else {
+          tree.insert(make_pair(key, Live(i)));
+          expected[key] = i;
+        }
+        if (i % 500 == 0) {
+          versions.push_back(make_pair(tree.snapshot(), expected));
+        }
+      }
+      versions.push_back(make_pair(tree, expected));
+
+      // a reader sums the oldest large version while the tree keeps changing
+      const Tree::Snapshot& reading = versions[2].first;
+      long want = 0;
+      for (map<int, int>::const_iterator it = versions[2].second.begin(); it != versions[2].second.end(); ++it) {
+        want += it->second;
+      }
+      long sum = 0;
+      thread reader([&]() {
+        for (int round = 0; round < 20; round++) {
+          long s = 0;
+          for (Tree::Snapshot::iterator it = reading.begin(); it != reading.end(); ++it) {
+            s += it->second.value;
+          }
+          sum = round == 0 ? s : (s == sum ? sum : -1);
+        }
+      });
+      for (int i = 0; i < 4000; i++) {
+        tree.insert(make_pair(rand() % 700, Live(-1)));
+        tree.remove(rand() % 700);
+      }
+      reader.join();
+      ok = ok && sum == want;
+
+      for (size_t v = 0; v < versions.size(); v++) {
+        const Tree::Snapshot& snap = versions[v].first;
+        const map<int, int>& items = versions[v].second;
+        map<int, int>::const_iterator mit = items.begin();
+        for (Tree::Snapshot::iterator it = snap.begin(); it != snap.end(); ++it, ++mit) {
+          ok = ok && mit != items.end() && it->first == mit->first && it->second.value == mit->second;
+        }
+        ok = ok && mit == items.end() && snap.size() == items.size() && snap.isBalanced();
+        for (int key = 0; key < 700; key += 7) {
+          Tree::Snapshot::iterator it = snap.find(key);
+          ok = ok && (it == snap.end() ? items.count(key) == 0 : it->second.value == items.find(key)->second);
+        }
+      }
+      ok = ok && tree.isBalanced();
+
+      // dropping the old versions frees what only they needed
+      versions.clear();
+      ok = ok && Live::live == int(tree.size());
+      tree.clear();
+      ok = ok && tree.empty() && Live::live == 0;
+    }
+    ok = ok && Live::live == 0;
+    cout << "PersistentAVLTree" << (ok ? " keeps its snapshots intact" : " FAILED snapshot checks") << endl;
+    return ok;
+}
+
+// Lets writers churn odd keys of their own while readers look up keys
+// all over the tree. Even keys are never touched and must always be
+// found, and whatever is found must carry a value some writer stored.
+// Afterwards the tree must hold exactly what each writer left behind.
+bool concurrentReadersAndWriters()
+{
+    typedef ConcurrentAVLTree<int, int> Tree;
+    const int writers = 2;
+    const int readers = 4;
+    const int range = 4000;
+    Tree tree;
+    for (int key = 0; key < range; key += 2) {
+      tree.insert(make_pair(key, -key));
+    }
+
+    vector<map<int, int> > expected(writers);
+    atomic<bool> writing(true);
+    atomic<bool> ok(true);
+    vector<thread> threads;
+    for (int w = 0; w < writers; w++) {
+      threads.push_back(thread([&, w]() {
+        mt19937 rng(w);
+        for (int i = 0; i < 20000; i++) {
+          // writer w owns the odd keys k with k / 2 % writers == w
+          int key = (rng() % (range / 2 / writers) * writers + w) * 2 + 1;
+          if (rng() % 3 == 0) {
+            tree.remove(key);
+            expected[w].erase(key);
+          } else {
+            int value = rng() % 2 ? -key : 3 * key;
+            tree.insert(make_pair(key, value));
+            expected[w][key] = value;
+          }
+        }
+      }));
+    }
+    for (int r = 0; r < readers; r++) {
+      threads.push_back(thread([&, r]() {
+        mt19937 rng(100 + r);
+        while (writing.load()) {
+          int key = rng() % range;
+          int value = 0;
+          bool found = tree.find(key, value);
+          if (key % 2 == 0 ? !found || value != -key : found && value != -key && value != 3 * key) {
+            ok.store(false);
+          }
+        }
+      }));
+    }
+    for (int w = 0; w < writers; w++) {
+      threads[w].join();
+    }
+    writing.store(false);
+    for (int r = 0; r < readers; r++) {
+      threads[writers + r].join();
+    }
+
+    bool same = tree.isBalanced();
+    size_t count = range / 2;
+    for (int key = 1; key < range; key += 2) {
+      const map<int, int>& owned = expected[key / 2 % writers];
+      map<int, int>::const_iterator want = owned.find(key);
+      int value = 0;
+      bool found = tree.find(key, value);
+      same = same && found == (want != owned.end()) && (!found || value == want->second);
+      count += found ? 1 : 0;
+    }
+    same = same && tree.size() == count;
+    tree.clear();
+    same = same && tree.empty() && tree.size() == 0 && !tree.contains(0);
+
+    bool passed = ok.load() && same;
+    cout << "ConcurrentAVLTree" << (passed ? " stays consistent under concurrent readers and writers"
+                                           : " FAILED concurrent reader and writer checks") << endl;
+    return passed;
+}
+
+// Grows a sharded map far enough for shards to open and boundaries to
+// move, checking it against a std::map in key order, then has several
+// threads insert and remove their own keys in all shards at once.
+bool shardsByRange()
+{
+    typedef ShardedAVLTree<int, int> Tree;
+    Tree tree(8);
+    map<int, int> expected;
+    mt19937 rng(7);
+    for (int i = 0; i < 60000; i++) {
+      int key = rng() % 50000;
+      if (i % 5 == 0) {
+        tree.remove(key);
+        expected.erase(key);
+      } else {
+        pair<Tree::iterator, bool> result = tree.insert(make_pair(key, i));
+        bool added = expected.count(key) == 0;
+        expected[key] = i;
+        if (result.second != added || result.first == tree.end() || result.first->first != key) {
+          cout << "ShardedAVLTree FAILED insert results" << endl;
+          return false;
+        }
+      }
+    }
+    bool same = tree.isBalanced() && tree.shardsInUse() > 1 && tree.size() == expected.size()
+                && equal(tree.begin(), tree.end(), expected.begin());
+    int value = 0;
+    same = same && tree.find(expected.begin()->first, value) && value == expected.begin()->second
+           && !tree.find(-1, value) && tree.find(-1) == tree.end();
+    try {
+      tree[-1];
+      same = false;
+    } catch (const out_of_range&) {
+    }
+
+    // keys only ever go up, so the last shard keeps splitting off new ones
+    Tree ascending(4);
+    for (int key = 0; key < 40000; key++) {
+      ascending.insert(make_pair(key, key));
+    }
+    same = same && ascending.shardsInUse() == 4 && ascending.isBalanced() && ascending.size() == 40000
+           && ascending[39999] == 39999;
+
+    vector<int> bounds;
+    bounds.push_back(-1000);
+    bounds.push_back(0);
+    bounds.push_back(1000);
+    Tree fixed(bounds);
+    const int writers = 4;
+    vector<thread> threads;
+    for (int w = 0; w < writers; w++) {
+      threads.push_back(thread([&fixed, w]() {
+        for (int key = -3000 + w; key < 3000; key += writers) {
+          fixed.insert(make_pair(key, w));
+        }
+        for (int key = -3000 + w; key < 3000; key += 2 * writers) {
+          fixed.remove(key);
+        }
+      }));
+    }
+    for (int w = 0; w < writers; w++) {
+      threads[w].join();
+    }
+    same = same && fixed.isBalanced() && fixed.size() == 3000;
+    int previous = INT_MIN;
+    for (Tree::iterator it = fixed.begin(); it != fixed.end(); ++it) {
+      int key = it->first;
+      same = same && key > previous && it->second == (key + 3000) % writers && (key + 3000) % (2 * writers) >= writers;
+      previous = key;
+    }
+    fixed.clear();
+    same = same && fixed.empty() && fixed.begin() == fixed.end();
+
+    cout << "ShardedAVLTree" << (same ? " matches std::map across shards" : " FAILED sharded map checks") << endl;
+    return same;
+}
+
+// Grows B+-trees of small nodes (so that they get several levels deep)
+// and shrinks them back to nothing, checking their shape and contents
+// against std::map all the way, including string keys and backward
+// iteration.
+bool bPlusTrees()
+{
+    typedef BPlusTree<int, int, std::less<int>, 32> Small;
+    Small tree;
+    map<int, int> expected;
+    mt19937 rng(11);
+    bool ok = true;
+    for (int i = 0; i < 20000 && ok; i++) {
+      int key = rng() % 3000;
+      if (i >= 10000 ? rng() % 3 != 0 : rng() % 3 == 0) {
+        tree.remove(key);
+        expected.erase(key);
+      } else {
+        pair<Small::iterator, bool> result = tree.insert(make_pair(key, i));
+        ok = result.second == (expected.count(key) == 0) && result.first->first == key && result.first->second == i;
+        expected[key] = i;
+      }
+      if (i % 500 == 0) {
+        ok = ok && tree.isBalanced() && tree.size() == expected.size()
+             && equal(tree.begin(), tree.end(), expected.begin());
+      }
+      if (i == 9999) {
+        ok = ok && tree.height() >= 5;
+      }
+    }
+    for (map<int, int>::iterator it = expected.begin(); it != expected.end(); ++it) {
+      tree.remove(it->first);
+    }
+    ok = ok && tree.isBalanced() && tree.empty() && tree.height() == 0 && tree.begin() == tree.end();
+
+    BPlusTree<string, int, std::less<string>, 64> named;
+    map<string, int> names;
+    for (int i = 0; i < 2000; i++) {
+      string key = to_string(rng() % 1000);
+      if (i % 4 == 0) {
+        named.remove(key);
+        names.erase(key);
+      } else {
+        named.insert(make_pair(key, i));
+        names[key] = i;
+      }
+    }
+    ok = ok && named.isBalanced() && named.size() == names.size()
+         && equal(names.rbegin(), names.rend(), reverse_iterator<BPlusTree<string, int, std::less<string>, 64>::iterator>(named.end()))
+         && named[names.begin()->first] == names.begin()->second && named.find("x") == named.end();
+    try {
+      named["x"];
+      ok = false;
+    } catch (const out_of_range&) {
+    }
+    named.clear();
+    ok = ok && named.empty() && named.isBalanced();
+
+    cout << "BPlusTree" << (ok ? " keeps its shape through growing and shrinking" : " FAILED shape checks") << endl;
+    return ok;
+}
+
+// Comparator whose order is chosen at run time, so a default-constructed
+// one sorts differently from the one a tree was made with.
+struct Ordering
+{
+    Ordering(bool descending = false) : descending_(descending) { }
+    bool operator()(int a, int b) const { return descending_ ? b < a : a < b; }
+    bool descending_;
+};
+
+// Freezes trees of every size up to a few levels, plus a large one, and
+// checks every lookup against std::map, in and between the keys and
+// beyond both ends, along with the iteration order.
+bool frozenLookups()
+{
+    bool ok = true;
+    mt19937 rng(21);
+    for (int n = 0; n <= 70 && ok; n = n < 40 ? n + 1 : n + 30) {
+      AVLTree<int, int> tree;
+      map<int, int> expected;
+      while ((int)expected.size() < (n == 70 ? 5000 : n)) {
+        int key = rng() % 20000 * 2;
+        tree.insert(make_pair(key, -key));
+        expected[key] = -key;
+      }
+      FrozenMap<int, int> frozen(tree);
+      ok = frozen.size() == expected.size() && frozen.empty() == expected.empty();
+      map<int, int>::iterator mit = expected.begin();
+      for (FrozenMap<int, int>::iterator it = frozen.begin(); it != frozen.end() && ok; ++it, ++mit) {
+        ok = mit != expected.end() && it->first == mit->first && (*it).second == mit->second;
+      }
+      ok = ok && mit == expected.end();
+      for (int key = -1; key <= 40001 && ok; key += n == 70 ? 1 : 37) {
+        map<int, int>::iterator lower = expected.lower_bound(key);
+        map<int, int>::iterator upper = expected.upper_bound(key);
+        FrozenMap<int, int>::iterator flower = frozen.lower_bound(key);
+        FrozenMap<int, int>::iterator fupper = frozen.upper_bound(key);
+        ok = (lower == expected.end() ? flower == frozen.end() : flower != frozen.end() && flower->first == lower->first)
+             && (upper == expected.end() ? fupper == frozen.end() : fupper != frozen.end() && fupper->first == upper->first)
+             && frozen.contains(key) == (expected.count(key) == 1)
+             && (frozen.find(key) == frozen.end()) == (expected.count(key) == 0);
+      }
+    }
+
+    // the snapshot searches with the tree's own comparator
+    AVLTree<int, int, Ordering> descending(Ordering(true));
+    for (int key = 0; key < 100; key += 2) {
+      descending.insert(make_pair(key, -key));
+    }
+    FrozenMap<int, int, Ordering> frozenDescending(descending);
+    ok = ok && frozenDescending.begin()->first == 98 && frozenDescending.find(40)->second == -40
+         && frozenDescending.lower_bound(41)->first == 40 && frozenDescending.find(41) == frozenDescending.end();
+
+    map<string, int, std::greater<string> > names;
+    names["pear"] = 1;
+    names["apple"] = 2;
+    names["fig"] = 3;
+    FrozenMap<string, int, std::greater<string> > frozen(names.begin(), names.end());
+    ok = ok && frozen["fig"] == 3 && frozen.lower_bound("banana")->first == "apple"
+         && frozen.begin()->first == "pear" && frozen.upper_bound("apple") == frozen.end();
+    try {
+      frozen["kiwi"];
+      ok = false;
+    } catch (const out_of_range&) {
+    }
+
+    cout << "FrozenMap" << (ok ? " answers lookups like std::map" : " FAILED lookup checks") << endl;
+    return ok;
+}
+
+// Looks up batches of present and missing keys, shorter and longer
+// than the number of descents findBatch() interleaves, and checks each
+// result against find().
+template<typename Tree>
+bool findsInBatches(const char* name)
+{
+    Tree tree;
+    mt19937 rng(22);
+    for (int i = 0; i < 3000; i++) {
+      tree.insert(make_pair(int(rng() % 10000), i));
+    }
+    bool ok = true;
+    int lengths[] = { 0, 1, 5, 16, 17, 2000 };
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+      vector<int> keys;
+      for (int i = 0; i < lengths[l]; i++) {
+        keys.push_back(rng() % 10002 - 1);
+      }
+      vector<typename Tree::iterator> found(3);
+      tree.findBatch(keys, found);
+      ok = ok && found.size() == keys.size();
+      for (size_t i = 0; i < keys.size() && ok; i++) {
+        ok = found[i] == tree.find(keys[i]);
+      }
+    }
+    Tree empty;
+    vector<int> keys(20, 1);
+    vector<typename Tree::iterator> found;
+    empty.findBatch(keys, found);
+    ok = ok && found.size() == 20 && found[19] == empty.end();
+    cout << name << (ok ? " finds batches like find()" : " FAILED batched lookups") << endl;
+    return ok;
+}
+
+// Walks a tree both ways and compares it with a std::map. On a tree of
+// ThreadedAVLNode both walks follow only the in-order links.
+template<typename Tree>
+bool walksLike(const Tree& tree, const map<int, int>& expected)
+{
+    if (!tree.isBalanced() || tree.size() != expected.size()
+        || !equal(tree.begin(), tree.end(), expected.begin())) {
+      return false;
+    }
+    map<int, int>::const_reverse_iterator mit = expected.rbegin();
+    typename Tree::const_iterator it = tree.end();
+    while (it != tree.begin()) {
+      --it;
+      if (mit == expected.rend() || *it != *mit) {
+        return false;
+      }
+      ++mit;
+    }
+    return mit == expected.rend();
+}
+
+// Puts a tree with in-order links through every kind of update, from
+// single inserts and removes to bulk loads, splits, joins and set
+// operations, checking after each that the links still match the tree.
+bool threadsInOrder()
+{
+    typedef AVLTree<int, int, std::less<int>, ThreadedAVLNode<int, int> > Tree;
+    Tree tree;
+    map<int, int> expected;
+    mt19937 rng(23);
+    bool ok = true;
+    for (int i = 0; i < 6000 && ok; i++) {
+      int key = rng() % 1000;
+      if (rng() % 3 == 0) {
+        tree.remove(key);
+        expected.erase(key);
+      } else if (i % 7 == 0) {
+        tree.emplace_hint(tree.lower_bound(key), key, i);
+        expected[key] = i;
+      } else {
+        tree.insert(make_pair(key, i));
+        expected[key] = i;
+      }
+      if (i % 500 == 0) {
+        ok = walksLike(tree, expected);
+      }
+    }
+    ok = ok && walksLike(tree, expected);
+
+    tree.erase(tree.lower_bound(100), tree.lower_bound(300));
+    expected.erase(expected.lower_bound(100), expected.lower_bound(300));
+    tree.erase(tree.lower_bound(900), tree.end());
+    expected.erase(expected.lower_bound(900), expected.end());
+    ok = ok && walksLike(tree, expected);
+
+    Tree copy(tree);
+    ok = ok && walksLike(copy, expected);
+
+    Tree less, greater;
+    int pivot = expected.lower_bound(500)->first;
+    tree.split(pivot, less, greater);
+    map<int, int> below(expected.begin(), expected.lower_bound(pivot));
+    map<int, int> above(expected.upper_bound(pivot), expected.end());
+    ok = ok && walksLike(less, below) && walksLike(greater, above);
+    tree.join(less, make_pair(pivot, -1), greater);
+    expected[pivot] = -1;
+    ok = ok && walksLike(tree, expected);
+
+    vector<pair<int, int> > items;
+    map<int, int> others;
+    for (int i = 0; i < 3000; i++) {
+      int key = rng() % 2000;
+      items.push_back(make_pair(key, i));
+      others[key] = i;
+    }
+    Tree other;
+    other.assignUnsorted(items);
+    ok = ok && walksLike(other, others);
+    tree.unionWith(other);
+    for (map<int, int>::iterator it = others.begin(); it != others.end(); ++it) {
+      expected[it->first] = it->second;
+    }
+    ok = ok && walksLike(tree, expected);
+
+    Tree sorted(expected.begin(), expected.end());
+    ok = ok && walksLike(sorted, expected);
+    for (int key = 0; key < 2000; key += 3) {
+      sorted.remove(key);
+      expected.erase(key);
+    }
+    ok = ok && walksLike(sorted, expected);
+
+    cout << "AVLTree<ThreadedAVLNode>" << (ok ? " keeps its in-order links" : " FAILED in-order link checks") << endl;
+    return ok;
+}
+
+// Runs a balancing policy through every kind of update: a delete-heavy
+// churn, hinted inserts, range erases, bulk loads of sorted and unsorted
+// input with removals on top, and copies, checking the policy's rules
+// and walking the tree both ways after each.
+template<typename Tree>
+bool balancesByPolicy(const char* name)
+{
+    Tree tree;
+    map<int, int> expected;
+    mt19937 rng(37);
+    bool ok = true;
+    for (int i = 0; i < 20000 && ok; i++) {
+      int key = rng() % 2000;
+      // grow for a while, then mostly remove
+      if (i >= 12000 ? rng() % 4 != 0 : rng() % 3 == 0) {
+        tree.remove(key);
+        expected.erase(key);
+      } else if (i % 5 == 0) {
+        tree.emplace_hint(tree.lower_bound(key), key, i);
+        expected[key] = i;
+      } else {
+        tree.insert(make_pair(key, i));
+        expected[key] = i;
+      }
+      if (i % 500 == 0) {
+        ok = walksLike(tree, expected);
+      }
+    }
+    ok = ok && walksLike(tree, expected);
+
+    tree.erase(tree.lower_bound(300), tree.lower_bound(900));
+    expected.erase(expected.lower_bound(300), expected.lower_bound(900));
+    tree.erase(tree.begin(), tree.lower_bound(100));
+    expected.erase(expected.begin(), expected.lower_bound(100));
+    ok = ok && walksLike(tree, expected);
+
+    Tree copy(tree);
+    ok = ok && walksLike(copy, expected);
+
+    // every size up to a few levels, so that all bottom rows get built
+    for (int n = 0; n < 70 && ok; n++) {
+      map<int, int> items;
+      for (int i = 0; i < n; i++) {
+        items[2 * i] = i;
+      }
+      Tree sorted(items.begin(), items.end());
+      ok = walksLike(sorted, items);
+      for (int key = 0; key < 2 * n; key += 6) {
+        sorted.remove(key);
+        items.erase(key);
+      }
+      for (int key = 1; key < 2 * n; key += 4) {
+        sorted.insert(make_pair(key, key));
+        items[key] = key;
+      }
+      ok = ok && walksLike(sorted, items);
+    }
+
+    vector<pair<int, int> > unsorted;
+    map<int, int> others;
+    for (int i = 0; i < 50000; i++) {
+      int key = rng() % 30000;
+      unsorted.push_back(make_pair(key, i));
+      others[key] = i;
+    }
+    tree.assignUnsorted(unsorted);
+    ok = ok && walksLike(tree, others);
+    for (int key = 0; key < 30000; key += 2) {
+      tree.remove(key);
+      others.erase(key);
+    }
+    ok = ok && walksLike(tree, others);
+
+    cout << name << (ok ? " keeps its balancing rules" : " FAILED balancing rule checks") << endl;
+    return ok;
+}
+
+// Number of links between the root and key, -1 if key is missing.
+int depthOf(const Node<int, int>* root, int key)
+{
+    int depth = 0;
+    while (root != NULL && root->getKey() != key) {
+      root = key < root->getKey() ? root->getLeft() : root->getRight();
+      depth++;
+    }
+    return root == NULL ? -1 : depth;
+}
+
+// Checks that find() splays the key it finds to the root, or at least
+// lifts it when semi-splaying, that repeated finds bring a key to the
+// top either way, and that a tree that splays on every insert, find
+// and removal keeps matching std::map and its parent links.
+bool splaysHotKeys()
+{
+    typedef SplayTree<int, int> Tree;
+    bool ok = true;
+    for (int semi = 0; semi < 2; semi++) {
+      Inspected<Tree> tree;
+      tree.setSplayMode(semi ? Tree::kSemiSplay : Tree::kFullSplay);
+      map<int, int> expected;
+      mt19937 rng(41 + semi);
+      for (int i = 0; i < 20000 && ok; i++) {
+        int key = rng() % 2000;
+        int op = rng() % 5;
+        if (op == 0) {
+          tree.remove(key);
+          expected.erase(key);
+        } else if (op == 1) {
+          tree.insert(make_pair(key, i));
+          expected[key] = i;
+        } else if (op == 2) {
+          tree.emplace_hint(tree.lower_bound(key), key, i);
+          expected[key] = i;
+        } else {
+          int before = depthOf(tree.root(), key);
+          Tree::iterator it = tree.find(key);
+          ok = (it == tree.end()) == (before == -1) && (before == -1) == (expected.count(key) == 0);
+          if (before != -1) {
+            int after = depthOf(tree.root(), key);
+            ok = ok && it->second == expected[key]
+                 && (semi ? after < before || before == 0 : after == 0);
+          }
+        }
+        if (i % 1000 == 0) {
+          checkedHeight(tree.root(), ok);
+          ok = ok && tree.size() == expected.size() && equal(tree.begin(), tree.end(), expected.begin());
+        }
+      }
+      tree.erase(tree.lower_bound(500), tree.lower_bound(900));
+      expected.erase(expected.lower_bound(500), expected.lower_bound(900));
+      checkedHeight(tree.root(), ok);
+      ok = ok && tree.size() == expected.size() && equal(tree.begin(), tree.end(), expected.begin());
+
+      // a key used over and over climbs to the root in either mode
+      int hot = expected.rbegin()->first;
+      for (int i = 0; i < 1000; i++) {
+        tree[hot] += 1;
+      }
+      ok = ok && tree.root()->getKey() == hot && tree.find(hot)->second == expected[hot] + 1000;
+
+      // lookups on a const tree leave it as it is
+      const Tree& frozen = tree;
+      ok = ok && frozen.find(expected.begin()->first) != frozen.end() && tree.root()->getKey() == hot;
+    }
+
+    // ascending inserts splay each new key to the root, leaving a chain
+    Inspected<Tree> chain;
+    for (int i = 0; i < 100000; i++) {
+      chain.insert(make_pair(i, i));
+    }
+    ok = ok && chain.root()->getKey() == 99999 && chain.find(0)->first == 0 && chain.root()->getKey() == 0;
+    Inspected<Tree> copy(chain);
+    ok = ok && sameShape(chain.root(), copy.root());
+
+    cout << "SplayTree" << (ok ? " splays what it finds" : " FAILED splay checks") << endl;
+    return ok;
+}
 
 int main(int argc, char *argv[])
 {
@@ -44,5 +1615,112 @@ int main(int argc, char *argv[])
     cout << "Erasing b" << endl;
     at.remove('b');
 
-    return 0;
+    // Other AVL node layouts
+    cout << endl;
+    bool ok = true;
+    ok = matchesMap<AVLTree<int, int> >("AVLTree") && ok;
+    ok = matchesMap<AVLTree<int, int, std::less<int>, PackedAVLNode<int, int> > >("AVLTree<PackedAVLNode>") && ok;
+    ok = matchesMap<IndexedAVLTree<int, int> >("IndexedAVLTree") && ok;
+    ok = indexedInsertsThrowSafely() && ok;
+    ok = matchesMap<AVLTree<int, int, std::less<int>, SizedAVLNode<int, int> > >("AVLTree<SizedAVLNode>") && ok;
+    ok = matchesMap<AVLTree<int, int, std::less<int>, ThreadedAVLNode<int, int> > >("AVLTree<ThreadedAVLNode>") && ok;
+    ok = threadsInOrder() && ok;
+
+    // Balancing policies
+    ok = matchesMap<BalancedTree<int, int, std::less<int>, AVLBalance> >("BalancedTree<AVLBalance>") && ok;
+    ok = matchesMap<WAVLTree<int, int> >("WAVLTree") && ok;
+    ok = matchesMap<RedBlackTree<int, int> >("RedBlackTree") && ok;
+    ok = balancesByPolicy<BalancedTree<int, int, std::less<int>, AVLBalance> >("BalancedTree<AVLBalance>") && ok;
+    ok = balancesByPolicy<WAVLTree<int, int> >("WAVLTree") && ok;
+    ok = balancesByPolicy<RedBlackTree<int, int> >("RedBlackTree") && ok;
+
+    // Self-adjusting trees
+    ok = splaysHotKeys() && ok;
+    ok = bulkLoads<SplayTree<int, int> >("SplayTree", false) && ok;
+    ok = erasesRanges<SplayTree<int, int>, Node<int, int> >("SplayTree", false) && ok;
+    ok = insertsWithHints<SplayTree<int, int>, Node<int, int> >("SplayTree", false) && ok;
+    ok = copies<SplayTree<int, int> >("SplayTree") && ok;
+
+    // B+-tree backend
+    ok = matchesMap<BPlusTree<int, int> >("BPlusTree") && ok;
+    ok = matchesMap<BPlusTree<int, int, std::less<int>, 32> >("BPlusTree<32>") && ok;
+    ok = bPlusTrees() && ok;
+
+    // Batched lookups
+    ok = findsInBatches<BinarySearchTree<int, int> >("BinarySearchTree") && ok;
+    ok = findsInBatches<AVLTree<int, int> >("AVLTree") && ok;
+    ok = findsInBatches<AVLTree<int, int, std::greater<int> > >("AVLTree<greater>") && ok;
+
+    // Frozen snapshots
+    ok = frozenLookups() && ok;
+
+    // Bulk loading
+    ok = bulkLoads<BinarySearchTree<int, int> >("BinarySearchTree", false) && ok;
+    ok = bulkLoads<AVLTree<int, int> >("AVLTree", true) && ok;
+    ok = bulkLoads<AVLTree<int, int, std::less<int>, PackedAVLNode<int, int> > >("AVLTree<PackedAVLNode>", true) && ok;
+    ok = bulkLoadsThrowSafely<BinarySearchTree<int, Fragile> >("BinarySearchTree") && ok;
+    ok = bulkLoadsThrowSafely<AVLTree<int, Fragile> >("AVLTree") && ok;
+    ok = bulkLoadsThrowSafely<WAVLTree<int, Fragile> >("WAVLTree") && ok;
+    ok = assignsUnsorted<AVLTree<int, int>, AVLNode<int, int> >("AVLTree") && ok;
+    ok = assignsUnsorted<AVLTree<int, int, std::less<int>, PackedAVLNode<int, int> >, PackedAVLNode<int, int> >("AVLTree<PackedAVLNode>") && ok;
+    ok = assignsUnsorted<AVLTree<int, int, std::less<int>, SizedAVLNode<int, int> >, SizedAVLNode<int, int> >("AVLTree<SizedAVLNode>") && ok;
+
+    // Custom comparators
+    ok = comparators() && ok;
+
+    // Iterators
+    ok = iteratesBothWays<BinarySearchTree<int, int> >("BinarySearchTree") && ok;
+    ok = iteratesBothWays<AVLTree<int, int> >("AVLTree") && ok;
+
+    // Ordered searches
+    ok = boundsMatch<BinarySearchTree<int, int> >("BinarySearchTree") && ok;
+    ok = boundsMatch<AVLTree<int, int> >("AVLTree") && ok;
+
+    // Erasing by position
+    ok = erasesRanges<BinarySearchTree<int, int>, Node<int, int> >("BinarySearchTree", false) && ok;
+    ok = erasesRanges<AVLTree<int, int>, AVLNode<int, int> >("AVLTree", true) && ok;
+    ok = erasesRanges<AVLTree<int, int, std::less<int>, PackedAVLNode<int, int> >, PackedAVLNode<int, int> >("AVLTree<PackedAVLNode>", true) && ok;
+    ok = erasesRanges<AVLTree<int, int, std::less<int>, SizedAVLNode<int, int> >, SizedAVLNode<int, int> >("AVLTree<SizedAVLNode>", true) && ok;
+
+    // Hinted insertion
+    ok = insertsWithHints<BinarySearchTree<int, int>, Node<int, int> >("BinarySearchTree", false) && ok;
+    ok = insertsWithHints<AVLTree<int, int>, AVLNode<int, int> >("AVLTree", true) && ok;
+    ok = insertsWithHints<AVLTree<int, int, std::less<int>, SizedAVLNode<int, int> >, SizedAVLNode<int, int> >("AVLTree<SizedAVLNode>", true) && ok;
+
+    // Split and join
+    ok = splitsAndJoins<AVLTree<int, int>, AVLNode<int, int> >("AVLTree") && ok;
+    ok = splitsAndJoins<AVLTree<int, int, std::less<int>, PackedAVLNode<int, int> >, PackedAVLNode<int, int> >("AVLTree<PackedAVLNode>") && ok;
+    ok = splitsAndJoins<AVLTree<int, int, std::less<int>, SizedAVLNode<int, int> >, SizedAVLNode<int, int> >("AVLTree<SizedAVLNode>") && ok;
+
+    // Set operations
+    ok = combinesSets<AVLTree<int, int>, AVLNode<int, int> >("AVLTree") && ok;
+    ok = combinesSets<AVLTree<int, int, std::less<int>, SizedAVLNode<int, int> >, SizedAVLNode<int, int> >("AVLTree<SizedAVLNode>") && ok;
+
+    // Order statistics
+    ok = bulkLoads<AVLTree<int, int, std::less<int>, SizedAVLNode<int, int> > >("AVLTree<SizedAVLNode>", true) && ok;
+    ok = orderStatistics() && ok;
+
+    // Concurrent access
+    ok = concurrentReadersAndWriters() && ok;
+    ok = shardsByRange() && ok;
+
+    // Persistent versions
+    ok = persistentSnapshots() && ok;
+
+    // Copy, move and swap
+    ok = copies<BinarySearchTree<int, int> >("BinarySearchTree") && ok;
+    ok = copies<AVLTree<int, int> >("AVLTree") && ok;
+    ok = copies<AVLTree<int, int, std::less<int>, PackedAVLNode<int, int> > >("AVLTree<PackedAVLNode>") && ok;
+    ok = swapsOnlyItsOwnType() && ok;
+
+    // Move-aware insertion
+    ok = emplaces<AVLTree<int, Tracked> >("AVLTree") && ok;
+    ok = emplaces<AVLTree<int, Tracked, std::less<int>, PackedAVLNode<int, Tracked> > >("AVLTree<PackedAVLNode>") && ok;
+
+    // Stack safety on a degenerate tree
+    int chainLength = 10000000;
+    if (argc > 1) chainLength = atoi(argv[1]);
+    ok = deepChain(chainLength) && ok;
+
+    return ok ? 0 : 1;
 }
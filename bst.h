@@ -4,21 +4,42 @@
 #include <iostream>
 #include <exception>
 #include <cstdlib>
+#include <cstdint>
 #include <utility>
+#include <iterator>
+#include <functional>
+#include <type_traits>
+#include <new>
+#include <vector>
+#include "nodepool.h"
+#include "forkjoin.h"
+#include "keycompare.h"
 
 /**
  * A templated class for a Node in a search tree.
- * The getters for parent/left/right are virtual so
- * that they can be overridden for future kinds of
- * search trees, such as Red Black trees, Splay trees,
- * and AVL trees.
+ * The getters for parent/left/right are deliberately
+ * not virtual, so every step of a search compiles down
+ * to a plain load and nodes carry no vtable pointer.
+ * Nodes for other kinds of search trees, such as AVL
+ * trees, derive from this class and redeclare the
+ * getters to return their own type (a static_cast).
+ * Nodes are always destroyed through ~Node by the tree
+ * that owns them, so derived nodes must only add
+ * members that need no destructor.
+ *
+ * The parent link is stored as an integer so that the
+ * low bits, which are always zero in an aligned node
+ * address, can carry a small tag for derived nodes
+ * (PackedAVLNode keeps its balance there). getParent()
+ * masks the tag off, so plain nodes never notice it.
  */
 template <typename Key, typename Value>
 class Node
 {
 public:
     Node(const Key& key, const Value& value, Node<Key, Value>* parent);
-    virtual ~Node();
+    Node(Key&& key, Value&& value, Node<Key, Value>* parent);
+    ~Node();
 
     const std::pair<const Key, Value>& getItem() const;
     std::pair<const Key, Value>& getItem();
@@ -26,18 +47,25 @@ public:
     const Value& getValue() const;
     Value& getValue();
 
-    virtual Node<Key, Value>* getParent() const;
-    virtual Node<Key, Value>* getLeft() const;
-    virtual Node<Key, Value>* getRight() const;
+    Node<Key, Value>* getParent() const;
+    Node<Key, Value>* getLeft() const;
+    Node<Key, Value>* getRight() const;
 
     void setParent(Node<Key, Value>* parent);
     void setLeft(Node<Key, Value>* left);
     void setRight(Node<Key, Value>* right);
     void setValue(const Value &value);
+    void setValue(Value&& value);
 
 protected:
+    // Bits of the parent link that are free for a tag
+    static const std::uintptr_t kParentTagMask = alignof(void*) - 1;
+
+    std::uintptr_t getParentTag() const;
+    void setParentTag(std::uintptr_t tag);
+
     std::pair<const Key, Value> item_;
-    Node<Key, Value>* parent_;
+    std::uintptr_t parent_;
     Node<Key, Value>* left_;
     Node<Key, Value>* right_;
 };
@@ -54,7 +82,20 @@ protected:
 template<typename Key, typename Value>
 Node<Key, Value>::Node(const Key& key, const Value& value, Node<Key, Value>* parent) :
     item_(key, value),
-    parent_(parent),
+    parent_(reinterpret_cast<std::uintptr_t>(parent)),
+    left_(NULL),
+    right_(NULL)
+{
+
+}
+
+/**
+* Constructor that moves the key and value into the node.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>::Node(Key&& key, Value&& value, Node<Key, Value>* parent) :
+    item_(std::move(key), std::move(value)),
+    parent_(reinterpret_cast<std::uintptr_t>(parent)),
     left_(NULL),
     right_(NULL)
 {
@@ -118,16 +159,16 @@ Value& Node<Key, Value>::getValue()
 }
 
 /**
-* An implementation of the virtual function for retreiving the parent.
+* A getter for the parent.
 */
 template<typename Key, typename Value>
 Node<Key, Value>* Node<Key, Value>::getParent() const
 {
-    return parent_;
+    return reinterpret_cast<Node<Key, Value>*>(parent_ & ~kParentTagMask);
 }
 
 /**
-* An implementation of the virtual function for retreiving the left child.
+* A getter for the left child.
 */
 template<typename Key, typename Value>
 Node<Key, Value>* Node<Key, Value>::getLeft() const
@@ -136,7 +177,7 @@ Node<Key, Value>* Node<Key, Value>::getLeft() const
 }
 
 /**
-* An implementation of the virtual function for retreiving the right child.
+* A getter for the right child.
 */
 template<typename Key, typename Value>
 Node<Key, Value>* Node<Key, Value>::getRight() const
@@ -150,7 +191,8 @@ Node<Key, Value>* Node<Key, Value>::getRight() const
 template<typename Key, typename Value>
 void Node<Key, Value>::setParent(Node<Key, Value>* parent)
 {
-    parent_ = parent;
+    // keep whatever tag the node has, only the address changes
+    parent_ = reinterpret_cast<std::uintptr_t>(parent) | (parent_ & kParentTagMask);
 }
 
 /**
@@ -171,6 +213,25 @@ void Node<Key, Value>::setRight(Node<Key, Value>* right)
     right_ = right;
 }
 
+/**
+* A getter for the tag kept in the low bits of the parent link.
+*/
+template<typename Key, typename Value>
+std::uintptr_t Node<Key, Value>::getParentTag() const
+{
+    return parent_ & kParentTagMask;
+}
+
+/**
+* A setter for the tag kept in the low bits of the parent link.
+* The tag must fit in kParentTagMask.
+*/
+template<typename Key, typename Value>
+void Node<Key, Value>::setParentTag(std::uintptr_t tag)
+{
+    parent_ = (parent_ & ~kParentTagMask) | tag;
+}
+
 /**
 * A setter for the value of a node.
 */
@@ -180,6 +241,15 @@ void Node<Key, Value>::setValue(const Value& value)
     item_.second = value;
 }
 
+/**
+* A setter that moves the new value into the node.
+*/
+template<typename Key, typename Value>
+void Node<Key, Value>::setValue(Value&& value)
+{
+    item_.second = std::move(value);
+}
+
 /*
   ---------------------------------------
   End implementations for the Node class.
@@ -188,29 +258,53 @@ void Node<Key, Value>::setValue(const Value& value)
 
 /**
 * A templated unbalanced binary search tree.
+* Keys are ordered by Compare, which defaults to std::less<Key>. A
+* transparent comparator (e.g. std::less<>) also enables find() with
+* any type it can compare against Key. See keycompare.h for how each
+* level of a descent gets by with a single comparison.
 */
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Compare = std::less<Key> >
 class BinarySearchTree
 {
 public:
     BinarySearchTree(); //TODO
+    explicit BinarySearchTree(const Compare& comp);
+    template<typename ForwardIterator>
+    BinarySearchTree(ForwardIterator first, ForwardIterator last, const Compare& comp = Compare());
+    BinarySearchTree(const BinarySearchTree& other);
+    BinarySearchTree(BinarySearchTree&& other);
     virtual ~BinarySearchTree(); //TODO
-    virtual void insert(const std::pair<const Key, Value>& keyValuePair); //TODO
     virtual void remove(const Key& key); //TODO
     void clear(); //TODO
+    template<typename ForwardIterator>
+    void assign(ForwardIterator first, ForwardIterator last);
+    void assignUnsorted(std::vector<std::pair<Key, Value> > items);
     bool isBalanced() const; //TODO
     void print() const;
     bool empty() const;
+    std::size_t size() const;
+    Compare key_comp() const;
 
-    template<typename PPKey, typename PPValue>
-    friend void prettyPrintBST(BinarySearchTree<PPKey, PPValue> & tree);
+    template<typename PPKey, typename PPValue, typename PPCompare>
+    friend void prettyPrintBST(BinarySearchTree<PPKey, PPValue, PPCompare> & tree);
 public:
+    class const_iterator;
+
     /**
     * An internal iterator class for traversing the contents of the BST.
+    * It is a standard bidirectional iterator, so std:: algorithms work on
+    * the tree directly. end() can be decremented to reach the last item,
+    * which is why an iterator also remembers its tree.
     */
     class iterator  // TODO
     {
     public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef std::pair<const Key, Value> value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef std::pair<const Key, Value>* pointer;
+        typedef std::pair<const Key, Value>& reference;
+
         iterator();
 
         std::pair<const Key,Value>& operator*() const;
@@ -220,24 +314,156 @@ public:
         bool operator!=(const iterator& rhs) const;
 
         iterator& operator++();
+        iterator operator++(int);
+        iterator& operator--();
+        iterator operator--(int);
 
     protected:
-        friend class BinarySearchTree<Key, Value>;
-        iterator(Node<Key,Value>* ptr);
+        friend class BinarySearchTree<Key, Value, Compare>;
+        friend class const_iterator;
+        iterator(Node<Key,Value>* ptr, const BinarySearchTree<Key, Value, Compare>* tree);
         Node<Key, Value> *current_;
+        const BinarySearchTree<Key, Value, Compare>* tree_;
     };
 
+    /**
+    * The read-only counterpart of iterator, which every iterator
+    * converts to. The two can be compared with each other.
+    */
+    class const_iterator
+    {
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef std::pair<const Key, Value> value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const std::pair<const Key, Value>* pointer;
+        typedef const std::pair<const Key, Value>& reference;
+
+        const_iterator();
+        const_iterator(const iterator& it);
+
+        const std::pair<const Key,Value>& operator*() const;
+        const std::pair<const Key,Value>* operator->() const;
+
+        // non-members, so that an iterator converts on either side
+        friend bool operator==(const const_iterator& lhs, const const_iterator& rhs)
+        {
+            return lhs.current_ == rhs.current_;
+        }
+        friend bool operator!=(const const_iterator& lhs, const const_iterator& rhs)
+        {
+            return lhs.current_ != rhs.current_;
+        }
+
+        const_iterator& operator++();
+        const_iterator operator++(int);
+        const_iterator& operator--();
+        const_iterator operator--(int);
+
+    protected:
+        friend class BinarySearchTree<Key, Value, Compare>;
+        const_iterator(const Node<Key,Value>* ptr, const BinarySearchTree<Key, Value, Compare>* tree);
+        const Node<Key, Value> *current_;
+        const BinarySearchTree<Key, Value, Compare>* tree_;
+    };
+
+    typedef std::reverse_iterator<iterator> reverse_iterator;
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
 public:
-    iterator begin() const;
-    iterator end() const;
+    // Insertion. Like insert(), emplace() overwrites the value of an
+    // existing key, while try_emplace() leaves an existing item untouched
+    // and does not even construct the value. The bool is true if a new
+    // node was added.
+    virtual std::pair<iterator, bool> insert(const std::pair<const Key, Value>& keyValuePair); //TODO
+    std::pair<iterator, bool> insert(std::pair<const Key, Value>&& keyValuePair);
+    template<typename P, typename = typename std::enable_if<std::is_constructible<std::pair<Key, Value>, P&&>::value>::type>
+    std::pair<iterator, bool> insert(P&& keyValuePair);
+    template<typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args);
+    template<typename... Args>
+    std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args);
+    template<typename... Args>
+    std::pair<iterator, bool> try_emplace(Key&& key, Args&&... args);
+    template<typename M>
+    std::pair<iterator, bool> insert_or_assign(const Key& key, M&& value);
+    template<typename M>
+    std::pair<iterator, bool> insert_or_assign(Key&& key, M&& value);
+
+    // Hinted insertion, as in std::map: hint should be the item just
+    // after the new one (end() when appending). A good hint costs O(1)
+    // comparisons, a poor one only climbs as far as it has to.
+    iterator insert(const_iterator hint, const std::pair<const Key, Value>& keyValuePair);
+    iterator insert(const_iterator hint, std::pair<const Key, Value>&& keyValuePair);
+    template<typename... Args>
+    iterator emplace_hint(const_iterator hint, Args&&... args);
+
+    // Removal by position. erase(pos) returns the item after pos, and
+    // erase(first, last) removes [first, last) and returns last.
+    iterator erase(iterator pos);
+    iterator erase(iterator first, iterator last);
+
+    iterator begin();
+    const_iterator begin() const;
+    const_iterator cbegin() const;
+    iterator end();
+    const_iterator end() const;
+    const_iterator cend() const;
+    reverse_iterator rbegin();
+    const_reverse_iterator rbegin() const;
+    const_reverse_iterator crbegin() const;
+    reverse_iterator rend();
+    const_reverse_iterator rend() const;
+    const_reverse_iterator crend() const;
     iterator find(const Key& key) const;
+    template<typename K, typename C = Compare, typename = typename std::enable_if<IsTransparent<C>::value>::type>
+    iterator find(const K& key) const;
     Value& operator[](const Key& key);
     Value const & operator[](const Key& key) const;
 
+    // Batched lookup: out[i] becomes find(keys[i]), converted to the
+    // iterator type of out (e.g. AVLTree::iterator). The descents run
+    // interleaved, so the cache misses of several overlap.
+    template<typename RandomAccessIterator>
+    void findBatch(const Key* keys, std::size_t count, RandomAccessIterator out) const;
+    template<typename Iterator>
+    void findBatch(const std::vector<Key>& keys, std::vector<Iterator>& out) const;
+
+    // Ordered searches, named and behaving as in std::map
+    iterator lower_bound(const Key& key) const;
+    template<typename K, typename C = Compare, typename = typename std::enable_if<IsTransparent<C>::value>::type>
+    iterator lower_bound(const K& key) const;
+    iterator upper_bound(const Key& key) const;
+    template<typename K, typename C = Compare, typename = typename std::enable_if<IsTransparent<C>::value>::type>
+    iterator upper_bound(const K& key) const;
+    std::pair<iterator, iterator> equal_range(const Key& key) const;
+
+    /**
+    * The items with keys in [lo, hi), for use in a range-based for
+    * loop. Both ends are found up front in O(log n), after that the
+    * scan only visits the items inside the range.
+    */
+    class RangeView
+    {
+    public:
+        iterator begin() const;
+        iterator end() const;
+        bool empty() const;
+
+    protected:
+        friend class BinarySearchTree<Key, Value, Compare>;
+        RangeView(iterator first, iterator last);
+        iterator first_;
+        iterator last_;
+    };
+    RangeView range(const Key& lo, const Key& hi) const;
+
 protected:
     // Mandatory helper functions
-    Node<Key, Value>* internalFind(const Key& k) const; // TODO
+    template<typename K>
+    Node<Key, Value>* internalFind(const K& k) const; // TODO
     Node<Key, Value> *getSmallestNode() const;  // TODO
+    Node<Key, Value> *getLargestNode() const;
     static Node<Key, Value>* predecessor(Node<Key, Value>* current); // TODO
     // Note:  static means these functions don't have a "this" pointer
     //        and instead just use the input argument.
@@ -251,11 +477,83 @@ protected:
 
     // Add helper functions here
     void clearHelper(Node<Key, Value>* current);
+    template<typename K>
+    Node<Key, Value>* lowerBoundNode(const K& key) const;
+    template<typename K>
+    Node<Key, Value>* upperBoundNode(const K& key) const;
+    template<typename K>
+    Node<Key, Value>* findNode(const K& key, std::true_type threeWay) const;
+    template<typename K>
+    Node<Key, Value>* findNode(const K& key, std::false_type threeWay) const;
+    template<typename K>
+    Node<Key, Value>* findSlot(const K& key, Node<Key, Value>*& parent, bool& left) const;
+    template<typename K>
+    Node<Key, Value>* findSlot(Node<Key, Value>* top, const K& key, Node<Key, Value>*& parent, bool& left, std::true_type threeWay) const;
+    template<typename K>
+    Node<Key, Value>* findSlot(Node<Key, Value>* top, const K& key, Node<Key, Value>*& parent, bool& left, std::false_type threeWay) const;
+    Node<Key, Value>* findHintSlot(const Node<Key, Value>* hint, const Key& key, Node<Key, Value>*& parent, bool& left) const;
+    void resetEnds();
+    void forgetNodes();
+    void destroyNode(Node<Key, Value>* node);
+    void linkNode(Node<Key, Value>* node, Node<Key, Value>* parent, bool left);
+    void rotateUp(Node<Key, Value>* node);
+    virtual void eraseNode(Node<Key, Value>* node);
+    virtual void eraseRange(Node<Key, Value>* first, Node<Key, Value>* last);
+    void cloneFrom(const BinarySearchTree& other);
+    template<typename ForwardIterator>
+    Node<Key, Value>* buildBalanced(ForwardIterator& it, ForwardIterator last, std::size_t count, int& height);
+    Node<Key, Value>* buildBlock(std::pair<Key, Value>* items, const std::size_t* keep, std::size_t count,
+                                 char* slots, int& height, int depth);
+    // subtrees of fewer items than this are built on one thread
+    static const std::size_t kForkBuildSize = 16384;
+    // descents findBatch() keeps in flight at once
+    static const std::size_t kBatchLanes = 16;
+    static void prefetch(const void* address);
+
+    // Hooks that let a derived tree use its own node type and
+    // bookkeeping while reusing the shared BST code
+    virtual Node<Key, Value>* createNode(const Key& key, const Value& value, Node<Key, Value>* parent);
+    virtual Node<Key, Value>* createNode(Key&& key, Value&& value, Node<Key, Value>* parent);
+    virtual Node<Key, Value>* placeNode(void* slot, Key&& key, Value&& value);
+    template<typename NodeT, typename... Args>
+    NodeT* constructNode(Args&&... args);
+    virtual void insertFixup(Node<Key, Value>* node);
+    virtual Node<Key, Value>* cloneNode(const Node<Key, Value>* source, Node<Key, Value>* parent);
+    virtual void buildFixup(Node<Key, Value>* node, int leftHeight, int rightHeight);
+    virtual void rebuiltFixup();
+    // In-order steps for trees whose nodes link to their neighbours
+    // (threaded_), see AVLTree with ThreadedAVLNode
+    virtual Node<Key, Value>* nextNode(Node<Key, Value>* node) const;
+    virtual Node<Key, Value>* prevNode(Node<Key, Value>* node) const;
+
+    // Lets a derived tree size the node pool for its own node type
+    BinarySearchTree(std::size_t nodeSize, std::size_t nodeAlign, const Compare& comp = Compare());
+    // Only the trees themselves may assign or trade nodes, each with
+    // its own type, since two trees with different node types would swap
+    // pools with different slot sizes, and a copy would read balance
+    // data that the source's nodes don't have
+    BinarySearchTree& operator=(const BinarySearchTree& other);
+    BinarySearchTree& operator=(BinarySearchTree&& other);
+    void swap(BinarySearchTree& other);
 
 
 protected:
     Node<Key, Value>* root_;
-    // You should not need other data members
+    // Number of items, kept up to date so size() is O(1). A split
+    // can leave it unknown (see AVLTree::split()), then the next size()
+    // counts the items once.
+    mutable std::size_t size_;
+    mutable bool sizeKnown_;
+    // The first and last node, cached so begin() and appending through
+    // an end() hint don't have to walk down the tree
+    Node<Key, Value>* smallest_;
+    Node<Key, Value>* largest_;
+    // Set by a derived tree whose nodes carry in-order links, so that
+    // iterators step with nextNode()/prevNode() instead of climbing
+    bool threaded_;
+    // Every node of this tree lives in pool_
+    NodePool pool_;
+    Compare comp_;
 };
 
 /*
@@ -267,31 +565,33 @@ Begin implementations for the BinarySearchTree::iterator class.
 /**
 * Explicit constructor that initializes an iterator with a given node pointer.
 */
-template<class Key, class Value>
-BinarySearchTree<Key, Value>::iterator::iterator(Node<Key,Value> *ptr)
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::iterator::iterator(Node<Key,Value> *ptr, const BinarySearchTree<Key, Value, Compare>* tree)
 {
     // TODO
     current_ = ptr;
+    tree_ = tree;
 
 }
 
 /**
 * A default constructor that initializes the iterator to NULL.
 */
-template<class Key, class Value>
-BinarySearchTree<Key, Value>::iterator::iterator() 
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::iterator::iterator() 
 {
     // TODO
     current_ = NULL;
+    tree_ = NULL;
 
 }
 
 /**
 * Provides access to the item.
 */
-template<class Key, class Value>
+template<class Key, class Value, class Compare>
 std::pair<const Key,Value> &
-BinarySearchTree<Key, Value>::iterator::operator*() const
+BinarySearchTree<Key, Value, Compare>::iterator::operator*() const
 {
     return current_->getItem();
 }
@@ -299,9 +599,9 @@ BinarySearchTree<Key, Value>::iterator::operator*() const
 /**
 * Provides access to the address of the item.
 */
-template<class Key, class Value>
+template<class Key, class Value, class Compare>
 std::pair<const Key,Value> *
-BinarySearchTree<Key, Value>::iterator::operator->() const
+BinarySearchTree<Key, Value, Compare>::iterator::operator->() const
 {
     return &(current_->getItem());
 }
@@ -310,10 +610,10 @@ BinarySearchTree<Key, Value>::iterator::operator->() const
 * Checks if 'this' iterator's internals have the same value
 * as 'rhs'
 */
-template<class Key, class Value>
+template<class Key, class Value, class Compare>
 bool
-BinarySearchTree<Key, Value>::iterator::operator==(
-    const BinarySearchTree<Key, Value>::iterator& rhs) const
+BinarySearchTree<Key, Value, Compare>::iterator::operator==(
+    const BinarySearchTree<Key, Value, Compare>::iterator& rhs) const
 {
     // TODO
     return (current_ == rhs.current_);
@@ -324,10 +624,10 @@ BinarySearchTree<Key, Value>::iterator::operator==(
 * Checks if 'this' iterator's internals have a different value
 * as 'rhs'
 */
-template<class Key, class Value>
+template<class Key, class Value, class Compare>
 bool
-BinarySearchTree<Key, Value>::iterator::operator!=(
-    const BinarySearchTree<Key, Value>::iterator& rhs) const
+BinarySearchTree<Key, Value, Compare>::iterator::operator!=(
+    const BinarySearchTree<Key, Value, Compare>::iterator& rhs) const
 {
     // TODO
     return (current_ != rhs.current_);
@@ -338,15 +638,55 @@ BinarySearchTree<Key, Value>::iterator::operator!=(
 /**
 * Advances the iterator's location using an in-order sequencing
 */
-template<class Key, class Value>
-typename BinarySearchTree<Key, Value>::iterator&
-BinarySearchTree<Key, Value>::iterator::operator++()
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator&
+BinarySearchTree<Key, Value, Compare>::iterator::operator++()
 {
     // TODO
-    current_ = successor(current_);
+    current_ = tree_->threaded_ ? tree_->nextNode(current_) : successor(current_);
+    return *this;
+}
+
+/**
+* Post-increment, which returns the iterator as it was.
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::iterator::operator++(int)
+{
+    iterator old(*this);
+    ++*this;
+    return old;
+}
+
+/**
+* Moves the iterator back to the previous item. Decrementing end()
+* gives the last item.
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator&
+BinarySearchTree<Key, Value, Compare>::iterator::operator--()
+{
+    if (current_ == NULL) {
+      current_ = tree_->largest_;
+    } else {
+      current_ = tree_->threaded_ ? tree_->prevNode(current_) : predecessor(current_);
+    }
     return *this;
 }
 
+/**
+* Post-decrement, which returns the iterator as it was.
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::iterator::operator--(int)
+{
+    iterator old(*this);
+    --*this;
+    return old;
+}
+
 
 /*
 -------------------------------------------------------------
@@ -354,6 +694,175 @@ End implementations for the BinarySearchTree::iterator class.
 -------------------------------------------------------------
 */
 
+/*
+--------------------------------------------------------------------
+Begin implementations for the BinarySearchTree::const_iterator class.
+--------------------------------------------------------------------
+*/
+
+/**
+* Explicit constructor that initializes an iterator with a given node pointer.
+*/
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::const_iterator::const_iterator(const Node<Key,Value> *ptr, const BinarySearchTree<Key, Value, Compare>* tree) :
+    current_(ptr),
+    tree_(tree)
+{
+
+}
+
+/**
+* A default constructor that initializes the iterator to NULL.
+*/
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::const_iterator::const_iterator() :
+    current_(NULL),
+    tree_(NULL)
+{
+
+}
+
+/**
+* Converts a mutable iterator.
+*/
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::const_iterator::const_iterator(const iterator& it) :
+    current_(it.current_),
+    tree_(it.tree_)
+{
+
+}
+
+/**
+* Provides read-only access to the item.
+*/
+template<class Key, class Value, class Compare>
+const std::pair<const Key,Value> &
+BinarySearchTree<Key, Value, Compare>::const_iterator::operator*() const
+{
+    return current_->getItem();
+}
+
+/**
+* Provides the address of the item.
+*/
+template<class Key, class Value, class Compare>
+const std::pair<const Key,Value> *
+BinarySearchTree<Key, Value, Compare>::const_iterator::operator->() const
+{
+    return &(current_->getItem());
+}
+
+/**
+* Advances to the next item in order.
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::const_iterator&
+BinarySearchTree<Key, Value, Compare>::const_iterator::operator++()
+{
+    Node<Key, Value>* current = const_cast<Node<Key, Value>*>(current_);
+    current_ = tree_->threaded_ ? tree_->nextNode(current) : successor(current);
+    return *this;
+}
+
+/**
+* Post-increment, which returns the iterator as it was.
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::const_iterator
+BinarySearchTree<Key, Value, Compare>::const_iterator::operator++(int)
+{
+    const_iterator old(*this);
+    ++*this;
+    return old;
+}
+
+/**
+* Moves back to the previous item, see iterator::operator--().
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::const_iterator&
+BinarySearchTree<Key, Value, Compare>::const_iterator::operator--()
+{
+    if (current_ == NULL) {
+      current_ = tree_->largest_;
+    } else {
+      Node<Key, Value>* current = const_cast<Node<Key, Value>*>(current_);
+      current_ = tree_->threaded_ ? tree_->prevNode(current) : predecessor(current);
+    }
+    return *this;
+}
+
+/**
+* Post-decrement, which returns the iterator as it was.
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::const_iterator
+BinarySearchTree<Key, Value, Compare>::const_iterator::operator--(int)
+{
+    const_iterator old(*this);
+    --*this;
+    return old;
+}
+
+/*
+------------------------------------------------------------------
+End implementations for the BinarySearchTree::const_iterator class.
+------------------------------------------------------------------
+*/
+
+/*
+---------------------------------------------------------------
+Begin implementations for the BinarySearchTree::RangeView class.
+---------------------------------------------------------------
+*/
+
+/**
+* Constructor for the view of [first, last).
+*/
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::RangeView::RangeView(iterator first, iterator last) :
+    first_(first),
+    last_(last)
+{
+
+}
+
+/**
+* Returns an iterator to the first item in the range.
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::RangeView::begin() const
+{
+    return first_;
+}
+
+/**
+* Returns the iterator one past the last item in the range.
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::RangeView::end() const
+{
+    return last_;
+}
+
+/**
+* Returns true if no key falls in the range.
+*/
+template<class Key, class Value, class Compare>
+bool BinarySearchTree<Key, Value, Compare>::RangeView::empty() const
+{
+    return first_ == last_;
+}
+
+/*
+-------------------------------------------------------------
+End implementations for the BinarySearchTree::RangeView class.
+-------------------------------------------------------------
+*/
+
 /*
 -----------------------------------------------------
 Begin implementations for the BinarySearchTree class.
@@ -363,156 +872,844 @@ Begin implementations for the BinarySearchTree class.
 /**
 * Default constructor for a BinarySearchTree, which sets the root to NULL.
 */
-template<class Key, class Value>
-BinarySearchTree<Key, Value>::BinarySearchTree() 
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::BinarySearchTree() :
+    root_(NULL),
+    size_(0),
+    sizeKnown_(true),
+    smallest_(NULL),
+    largest_(NULL),
+    threaded_(false),
+    pool_(sizeof(Node<Key, Value>), alignof(Node<Key, Value>)),
+    comp_()
 {
-    // TODO
-    root_ = NULL;
+
 }
 
-template<typename Key, typename Value>
-BinarySearchTree<Key, Value>::~BinarySearchTree()
+/**
+* Constructor for an empty tree ordered by the given comparator.
+*/
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::BinarySearchTree(const Compare& comp) :
+    root_(NULL),
+    size_(0),
+    sizeKnown_(true),
+    smallest_(NULL),
+    largest_(NULL),
+    threaded_(false),
+    pool_(sizeof(Node<Key, Value>), alignof(Node<Key, Value>)),
+    comp_(comp)
 {
-    // TODO 
-    clear();
 
 }
 
+/**
+* Constructor for derived trees whose nodes are larger than Node,
+* so that the pool hands out slots big enough for them.
+*/
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::BinarySearchTree(std::size_t nodeSize, std::size_t nodeAlign, const Compare& comp) :
+    root_(NULL),
+    size_(0),
+    sizeKnown_(true),
+    smallest_(NULL),
+    largest_(NULL),
+    threaded_(false),
+    pool_(nodeSize, nodeAlign),
+    comp_(comp)
+{
 
+}
 
 /**
- * Returns true if tree is empty
+* Constructs a tree holding the items of a sorted range, see assign().
 */
-template<class Key, class Value>
-bool BinarySearchTree<Key, Value>::empty() const
+template<class Key, class Value, class Compare>
+template<typename ForwardIterator>
+BinarySearchTree<Key, Value, Compare>::BinarySearchTree(ForwardIterator first, ForwardIterator last, const Compare& comp) :
+    root_(NULL),
+    size_(0),
+    sizeKnown_(true),
+    smallest_(NULL),
+    largest_(NULL),
+    threaded_(false),
+    pool_(sizeof(Node<Key, Value>), alignof(Node<Key, Value>)),
+    comp_(comp)
 {
-    return root_ == NULL;
+    assign(first, last);
 }
 
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::print() const
+/**
+* Copy constructor. The copy has the same shape as other and is built
+* in one O(n) pass, see cloneFrom().
+*/
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::BinarySearchTree(const BinarySearchTree& other) :
+    root_(NULL),
+    size_(0),
+    sizeKnown_(true),
+    smallest_(NULL),
+    largest_(NULL),
+    threaded_(false),
+    pool_(sizeof(Node<Key, Value>), alignof(Node<Key, Value>)),
+    comp_(other.comp_)
 {
-    printRoot(root_);
-    std::cout << "\n";
+    cloneFrom(other);
 }
 
 /**
-* Returns an iterator to the "smallest" item in the tree
+* Move constructor, which takes over other's nodes in O(1) and
+* leaves other empty.
 */
-template<class Key, class Value>
-typename BinarySearchTree<Key, Value>::iterator
-BinarySearchTree<Key, Value>::begin() const
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::BinarySearchTree(BinarySearchTree&& other) :
+    root_(other.root_),
+    size_(other.size_),
+    sizeKnown_(other.sizeKnown_),
+    smallest_(other.smallest_),
+    largest_(other.largest_),
+    threaded_(other.threaded_),
+    pool_(std::move(other.pool_)),
+    comp_(other.comp_)
 {
-    BinarySearchTree<Key, Value>::iterator begin(getSmallestNode());
-    return begin;
+    other.root_ = NULL;
+    other.size_ = 0;
+    other.sizeKnown_ = true;
+    other.smallest_ = NULL;
+    other.largest_ = NULL;
+}
+
+template<typename Key, typename Value, typename Compare>
+BinarySearchTree<Key, Value, Compare>::~BinarySearchTree()
+{
+    // TODO 
+    clear();
+
 }
 
+
+
 /**
-* Returns an iterator whose value means INVALID
+* Copy assignment, which replaces the contents with a structural
+* copy of other.
 */
-template<class Key, class Value>
-typename BinarySearchTree<Key, Value>::iterator
-BinarySearchTree<Key, Value>::end() const
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>&
+BinarySearchTree<Key, Value, Compare>::operator=(const BinarySearchTree& other)
 {
-    BinarySearchTree<Key, Value>::iterator end(NULL);
-    return end;
+    if (this != &other) {
+      clear();
+      comp_ = other.comp_;
+      cloneFrom(other);
+    }
+    return *this;
 }
 
 /**
-* Returns an iterator to the item with the given key, k
-* or the end iterator if k does not exist in the tree
+* Move assignment. Our own items are destroyed, other's nodes are
+* taken over in O(1) and other is left empty.
 */
-template<class Key, class Value>
-typename BinarySearchTree<Key, Value>::iterator
-BinarySearchTree<Key, Value>::find(const Key & k) const
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>&
+BinarySearchTree<Key, Value, Compare>::operator=(BinarySearchTree&& other)
 {
-    Node<Key, Value> *curr = internalFind(k);
-    BinarySearchTree<Key, Value>::iterator it(curr);
-    return it;
+    if (this != &other) {
+      clear();
+      swap(other);
+    }
+    return *this;
 }
 
 /**
- * @precondition The key exists in the map
- * Returns the value associated with the key
- */
-template<class Key, class Value>
-Value& BinarySearchTree<Key, Value>::operator[](const Key& key)
+* Exchanges the contents of two trees in O(1). Iterators keep
+* pointing at the same items, which now belong to the other tree.
+*/
+template<class Key, class Value, class Compare>
+void BinarySearchTree<Key, Value, Compare>::swap(BinarySearchTree& other)
 {
-    Node<Key, Value> *curr = internalFind(key);
-    if(curr == NULL) throw std::out_of_range("Invalid key");
-    return curr->getValue();
+    std::swap(root_, other.root_);
+    std::swap(size_, other.size_);
+    std::swap(sizeKnown_, other.sizeKnown_);
+    std::swap(smallest_, other.smallest_);
+    std::swap(largest_, other.largest_);
+    std::swap(threaded_, other.threaded_);
+    pool_.swap(other.pool_);
+    std::swap(comp_, other.comp_);
 }
-template<class Key, class Value>
-Value const & BinarySearchTree<Key, Value>::operator[](const Key& key) const
+
+/**
+ * Returns true if tree is empty
+*/
+template<class Key, class Value, class Compare>
+bool BinarySearchTree<Key, Value, Compare>::empty() const
 {
-    Node<Key, Value> *curr = internalFind(key);
-    if(curr == NULL) throw std::out_of_range("Invalid key");
-    return curr->getValue();
+    return root_ == NULL;
 }
 
 /**
-* An insert method to insert into a Binary Search Tree.
-* The tree will not remain balanced when inserting.
-* Recall: If key is already in the tree, you should 
-* overwrite the current value with the updated value.
+* Returns the number of items in the tree, in O(1) except for the
+* first call after a split of a tree that doesn't keep subtree sizes.
 */
-template<class Key, class Value>
-void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &keyValuePair)
-{ 
-    // TODO
-    // start from parent and walk through, left if smaller
-    // go right if bigger 
-    Node<Key, Value>* child = root_;
-    // keep track of the child value and parent is the one previous so can change
-    // linkage when correct spot is found
-    Node<Key, Value>* parent = NULL;
-
-
-    // empty tree case
-    if (child == NULL) {
-      Node<Key, Value>* addednode = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, NULL);
-      root_ = addednode;
-      return;
-    }
-    while (child != NULL) {
-      if (keyValuePair.first < child->getKey()) {
-        // parent is now the old child, reassign child
-        parent = child;
-        child = child->getLeft();
-      } else if (keyValuePair.first > child->getKey()) {
-        parent = child;
-        child = child->getRight();
-      } else {
-        // key already exists
-        child->setValue(keyValuePair.second);
-        return;
+template<class Key, class Value, class Compare>
+std::size_t BinarySearchTree<Key, Value, Compare>::size() const
+{
+    if (!sizeKnown_) {
+      size_ = 0;
+      for (Node<Key, Value>* node = smallest_; node != NULL; node = successor(node)) {
+        size_++;
       }
+      sizeKnown_ = true;
     }
-    Node<Key, Value>* addednode = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, parent);
-    if (keyValuePair.first < parent->getKey()) {
-        parent->setLeft(addednode);
-      } else {
-        parent->setRight(addednode);
-      }
-   
+    return size_;
+}
 
-    
+/**
+* Returns a copy of the comparator that orders the keys.
+*/
+template<class Key, class Value, class Compare>
+Compare BinarySearchTree<Key, Value, Compare>::key_comp() const
+{
+    return comp_;
 }
 
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::print() const
+{
+    printRoot(root_);
+    std::cout << "\n";
+}
 
 /**
-* A remove method to remove a specific key from a Binary Search Tree.
-* Recall: The writeup specifies that if a node has 2 children you
-* should swap with the predecessor and then remove.
+* Returns an iterator to the "smallest" item in the tree
 */
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::remove(const Key& key)
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::begin()
 {
-    // TODO
-    // use swapNode()helper function
-  
+    BinarySearchTree<Key, Value, Compare>::iterator begin(smallest_, this);
+    return begin;
+}
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::const_iterator
+BinarySearchTree<Key, Value, Compare>::begin() const
+{
+    return const_iterator(smallest_, this);
+}
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::const_iterator
+BinarySearchTree<Key, Value, Compare>::cbegin() const
+{
+    return begin();
+}
+
+/**
+* Returns an iterator whose value means INVALID
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::end()
+{
+    BinarySearchTree<Key, Value, Compare>::iterator end(NULL, this);
+    return end;
+}
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::const_iterator
+BinarySearchTree<Key, Value, Compare>::end() const
+{
+    return const_iterator(NULL, this);
+}
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::const_iterator
+BinarySearchTree<Key, Value, Compare>::cend() const
+{
+    return end();
+}
+
+/**
+* Returns a reverse iterator to the "largest" item in the tree
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::reverse_iterator
+BinarySearchTree<Key, Value, Compare>::rbegin()
+{
+    return reverse_iterator(end());
+}
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::const_reverse_iterator
+BinarySearchTree<Key, Value, Compare>::rbegin() const
+{
+    return const_reverse_iterator(end());
+}
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::const_reverse_iterator
+BinarySearchTree<Key, Value, Compare>::crbegin() const
+{
+    return rbegin();
+}
+
+/**
+* Returns the reverse iterator past the "smallest" item
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::reverse_iterator
+BinarySearchTree<Key, Value, Compare>::rend()
+{
+    return reverse_iterator(begin());
+}
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::const_reverse_iterator
+BinarySearchTree<Key, Value, Compare>::rend() const
+{
+    return const_reverse_iterator(begin());
+}
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::const_reverse_iterator
+BinarySearchTree<Key, Value, Compare>::crend() const
+{
+    return rend();
+}
+
+/**
+* Returns an iterator to the item with the given key, k
+* or the end iterator if k does not exist in the tree
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::find(const Key & k) const
+{
+    Node<Key, Value> *curr = internalFind(k);
+    BinarySearchTree<Key, Value, Compare>::iterator it(curr, this);
+    return it;
+}
+
+/**
+* Heterogeneous version of find(), only available with a transparent
+* comparator. The key is compared against stored keys as is, so e.g. a
+* std::string_view can be looked up in a tree of std::string without
+* building a temporary string.
+*/
+template<class Key, class Value, class Compare>
+template<typename K, typename C, typename>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::find(const K & k) const
+{
+    return iterator(internalFind(k), this);
+}
+
+/**
+* Looks up count keys at once, storing find(keys[i]) in out[i]. Up to
+* kBatchLanes descents are in flight: each round moves every one of
+* them down a level and prefetches the node it lands on, which is only
+* visited again after the others have had their turn. A lane whose
+* descent is done takes on the next key. The descent is the one of
+* findNode() with comp_ alone, the same number of steps for a key
+* whether it is there or not.
+*/
+template<class Key, class Value, class Compare>
+template<typename RandomAccessIterator>
+void BinarySearchTree<Key, Value, Compare>::findBatch(const Key* keys, std::size_t count, RandomAccessIterator out) const
+{
+    struct Lane
+    {
+        Node<Key, Value>* current;
+        Node<Key, Value>* candidate;
+        std::size_t index;
+    };
+    Lane lanes[kBatchLanes];
+    std::size_t active = 0;
+    std::size_t next = 0;
+    while (active < kBatchLanes && next < count) {
+      Lane lane = { root_, NULL, next++ };
+      lanes[active++] = lane;
+    }
+    while (active > 0) {
+      std::size_t i = 0;
+      while (i < active) {
+        Lane& lane = lanes[i];
+        Node<Key, Value>* current = lane.current;
+        if (current != NULL) {
+          if (comp_(current->getKey(), keys[lane.index])) {
+            current = current->getRight();
+          } else {
+            lane.candidate = current;
+            current = current->getLeft();
+          }
+          prefetch(current);
+          lane.current = current;
+          i++;
+          continue;
+        }
+        Node<Key, Value>* found = lane.candidate;
+        if (found != NULL && comp_(keys[lane.index], found->getKey())) {
+          found = NULL;
+        }
+        out[lane.index] = iterator(found, this);
+        if (next < count) {
+          Lane fresh = { root_, NULL, next++ };
+          lane = fresh;
+          i++;
+        } else {
+          // the last lane takes this one's place and its turn
+          lane = lanes[--active];
+        }
+      }
+    }
+}
+
+/**
+* findBatch() for a whole vector of keys; out is resized to match.
+*/
+template<class Key, class Value, class Compare>
+template<typename Iterator>
+void BinarySearchTree<Key, Value, Compare>::findBatch(const std::vector<Key>& keys, std::vector<Iterator>& out) const
+{
+    out.resize(keys.size());
+    findBatch(keys.data(), keys.size(), out.begin());
+}
+
+/**
+* Hints that the memory at address is about to be read. A no-op where
+* the compiler has no prefetch builtin, and harmless for NULL.
+*/
+template<class Key, class Value, class Compare>
+void BinarySearchTree<Key, Value, Compare>::prefetch(const void* address)
+{
+#if defined(__GNUC__)
+    __builtin_prefetch(address);
+#else
+    (void)address;
+#endif
+}
+
+/**
+* Returns an iterator to the first item whose key is not before key,
+* or end() if there is none.
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::lower_bound(const Key& key) const
+{
+    return iterator(lowerBoundNode(key), this);
+}
+
+/**
+* Heterogeneous version of lower_bound(), see find().
+*/
+template<class Key, class Value, class Compare>
+template<typename K, typename C, typename>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::lower_bound(const K& key) const
+{
+    return iterator(lowerBoundNode(key), this);
+}
+
+/**
+* Returns an iterator to the first item whose key comes after key,
+* or end() if there is none.
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::upper_bound(const Key& key) const
+{
+    return iterator(upperBoundNode(key), this);
+}
+
+/**
+* Heterogeneous version of upper_bound(), see find().
+*/
+template<class Key, class Value, class Compare>
+template<typename K, typename C, typename>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::upper_bound(const K& key) const
+{
+    return iterator(upperBoundNode(key), this);
+}
+
+/**
+* Returns the range of items with the given key, which holds one item
+* if the key is present and none otherwise. Takes a single descent.
+*/
+template<class Key, class Value, class Compare>
+std::pair<typename BinarySearchTree<Key, Value, Compare>::iterator, typename BinarySearchTree<Key, Value, Compare>::iterator>
+BinarySearchTree<Key, Value, Compare>::equal_range(const Key& key) const
+{
+    Node<Key, Value>* first = lowerBoundNode(key);
+    if (first != NULL && !comp_(key, first->getKey())) {
+      return std::make_pair(iterator(first, this), iterator(successor(first), this));
+    }
+    return std::make_pair(iterator(first, this), iterator(first, this));
+}
+
+/**
+* Returns a view of the items with keys in [lo, hi). The view is empty
+* if hi does not come after lo. Like any iterator, it is invalidated
+* by removing the items it refers to.
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::RangeView
+BinarySearchTree<Key, Value, Compare>::range(const Key& lo, const Key& hi) const
+{
+    iterator first(lowerBoundNode(lo), this);
+    if (!comp_(lo, hi)) {
+      return RangeView(first, first);
+    }
+    return RangeView(first, iterator(lowerBoundNode(hi), this));
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value, class Compare>
+Value& BinarySearchTree<Key, Value, Compare>::operator[](const Key& key)
+{
+    Node<Key, Value> *curr = internalFind(key);
+    if(curr == NULL) throw std::out_of_range("Invalid key");
+    return curr->getValue();
+}
+template<class Key, class Value, class Compare>
+Value const & BinarySearchTree<Key, Value, Compare>::operator[](const Key& key) const
+{
+    Node<Key, Value> *curr = internalFind(key);
+    if(curr == NULL) throw std::out_of_range("Invalid key");
+    return curr->getValue();
+}
+
+/**
+* An insert method to insert into a Binary Search Tree.
+* The tree will not remain balanced when inserting.
+* Recall: If key is already in the tree, you should 
+* overwrite the current value with the updated value.
+*/
+template<class Key, class Value, class Compare>
+std::pair<typename BinarySearchTree<Key, Value, Compare>::iterator, bool>
+BinarySearchTree<Key, Value, Compare>::insert(const std::pair<const Key, Value> &keyValuePair)
+{ 
+    // TODO
+    // start from parent and walk through, left if smaller
+    // go right if bigger 
+    // keep track of the child value and parent is the one previous so can change
+    // linkage when correct spot is found
+    Node<Key, Value>* parent = NULL;
+    bool left = false;
+    Node<Key, Value>* existing = findSlot(keyValuePair.first, parent, left);
+    if (existing != NULL) {
+      // key already exists
+      existing->setValue(keyValuePair.second);
+      return std::make_pair(iterator(existing, this), false);
+    }
+
+    Node<Key, Value>* addednode = createNode(keyValuePair.first, keyValuePair.second, parent);
+    linkNode(addednode, parent, left);
+    return std::make_pair(iterator(addednode, this), true);
+}
+
+/**
+* Inserts a temporary item, moving its value into the tree. The key
+* is const inside the pair, so it still has to be copied.
+*/
+template<class Key, class Value, class Compare>
+std::pair<typename BinarySearchTree<Key, Value, Compare>::iterator, bool>
+BinarySearchTree<Key, Value, Compare>::insert(std::pair<const Key, Value>&& keyValuePair)
+{
+    Node<Key, Value>* parent = NULL;
+    bool left = false;
+    Node<Key, Value>* existing = findSlot(keyValuePair.first, parent, left);
+    if (existing != NULL) {
+      existing->setValue(std::move(keyValuePair.second));
+      return std::make_pair(iterator(existing, this), false);
+    }
+    Node<Key, Value>* addednode = createNode(Key(keyValuePair.first), std::move(keyValuePair.second), parent);
+    linkNode(addednode, parent, left);
+    return std::make_pair(iterator(addednode, this), true);
+}
+
+/**
+* Inserts anything a std::pair<Key, Value> can be built from, such as
+* the result of std::make_pair(), moving both halves into the tree.
+*/
+template<class Key, class Value, class Compare>
+template<typename P, typename>
+std::pair<typename BinarySearchTree<Key, Value, Compare>::iterator, bool>
+BinarySearchTree<Key, Value, Compare>::insert(P&& keyValuePair)
+{
+    return emplace(std::forward<P>(keyValuePair));
+}
+
+/**
+* Builds a key/value pair from args and inserts it, overwriting the
+* value if the key is already present (the same rule as insert()).
+* Both the key and the value are moved into the node.
+*/
+template<class Key, class Value, class Compare>
+template<typename... Args>
+std::pair<typename BinarySearchTree<Key, Value, Compare>::iterator, bool>
+BinarySearchTree<Key, Value, Compare>::emplace(Args&&... args)
+{
+    std::pair<Key, Value> item(std::forward<Args>(args)...);
+    Node<Key, Value>* parent = NULL;
+    bool left = false;
+    Node<Key, Value>* existing = findSlot(item.first, parent, left);
+    if (existing != NULL) {
+      existing->setValue(std::move(item.second));
+      return std::make_pair(iterator(existing, this), false);
+    }
+    Node<Key, Value>* addednode = createNode(std::move(item.first), std::move(item.second), parent);
+    linkNode(addednode, parent, left);
+    return std::make_pair(iterator(addednode, this), true);
+}
+
+/**
+* Inserts key with a value built from args, unless the key is already
+* present. In that case nothing is constructed or changed and the
+* iterator points at the existing item.
+*/
+template<class Key, class Value, class Compare>
+template<typename... Args>
+std::pair<typename BinarySearchTree<Key, Value, Compare>::iterator, bool>
+BinarySearchTree<Key, Value, Compare>::try_emplace(const Key& key, Args&&... args)
+{
+    Node<Key, Value>* parent = NULL;
+    bool left = false;
+    Node<Key, Value>* existing = findSlot(key, parent, left);
+    if (existing != NULL) {
+      return std::make_pair(iterator(existing, this), false);
+    }
+    Node<Key, Value>* addednode = createNode(Key(key), Value(std::forward<Args>(args)...), parent);
+    linkNode(addednode, parent, left);
+    return std::make_pair(iterator(addednode, this), true);
+}
+
+/**
+* Same as above, moving the key into the new node.
+*/
+template<class Key, class Value, class Compare>
+template<typename... Args>
+std::pair<typename BinarySearchTree<Key, Value, Compare>::iterator, bool>
+BinarySearchTree<Key, Value, Compare>::try_emplace(Key&& key, Args&&... args)
+{
+    Node<Key, Value>* parent = NULL;
+    bool left = false;
+    Node<Key, Value>* existing = findSlot(key, parent, left);
+    if (existing != NULL) {
+      return std::make_pair(iterator(existing, this), false);
+    }
+    Node<Key, Value>* addednode = createNode(std::move(key), Value(std::forward<Args>(args)...), parent);
+    linkNode(addednode, parent, left);
+    return std::make_pair(iterator(addednode, this), true);
+}
+
+/**
+* Assigns value to key if it is present, otherwise inserts it. The
+* bool is true if a new node was added.
+*/
+template<class Key, class Value, class Compare>
+template<typename M>
+std::pair<typename BinarySearchTree<Key, Value, Compare>::iterator, bool>
+BinarySearchTree<Key, Value, Compare>::insert_or_assign(const Key& key, M&& value)
+{
+    Node<Key, Value>* parent = NULL;
+    bool left = false;
+    Node<Key, Value>* existing = findSlot(key, parent, left);
+    if (existing != NULL) {
+      existing->getValue() = std::forward<M>(value);
+      return std::make_pair(iterator(existing, this), false);
+    }
+    Node<Key, Value>* addednode = createNode(Key(key), Value(std::forward<M>(value)), parent);
+    linkNode(addednode, parent, left);
+    return std::make_pair(iterator(addednode, this), true);
+}
+
+/**
+* Same as above, moving the key into the new node.
+*/
+template<class Key, class Value, class Compare>
+template<typename M>
+std::pair<typename BinarySearchTree<Key, Value, Compare>::iterator, bool>
+BinarySearchTree<Key, Value, Compare>::insert_or_assign(Key&& key, M&& value)
+{
+    Node<Key, Value>* parent = NULL;
+    bool left = false;
+    Node<Key, Value>* existing = findSlot(key, parent, left);
+    if (existing != NULL) {
+      existing->getValue() = std::forward<M>(value);
+      return std::make_pair(iterator(existing, this), false);
+    }
+    Node<Key, Value>* addednode = createNode(std::move(key), Value(std::forward<M>(value)), parent);
+    linkNode(addednode, parent, left);
+    return std::make_pair(iterator(addednode, this), true);
+}
+
+/**
+* Inserts an item, starting the search at hint instead of the root.
+* With a correct hint (the item that will follow the new one, or end())
+* this takes O(1) comparisons, so ascending keys fed in with end() as
+* the hint cost nothing but the rebalancing. Like insert(), an existing
+* key gets its value overwritten.
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::insert(const_iterator hint, const std::pair<const Key, Value>& keyValuePair)
+{
+    Node<Key, Value>* parent = NULL;
+    bool left = false;
+    Node<Key, Value>* existing = findHintSlot(hint.current_, keyValuePair.first, parent, left);
+    if (existing != NULL) {
+      existing->setValue(keyValuePair.second);
+      return iterator(existing, this);
+    }
+    Node<Key, Value>* addednode = createNode(keyValuePair.first, keyValuePair.second, parent);
+    linkNode(addednode, parent, left);
+    return iterator(addednode, this);
+}
+
+/**
+* Same as above, moving the value into the tree.
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::insert(const_iterator hint, std::pair<const Key, Value>&& keyValuePair)
+{
+    Node<Key, Value>* parent = NULL;
+    bool left = false;
+    Node<Key, Value>* existing = findHintSlot(hint.current_, keyValuePair.first, parent, left);
+    if (existing != NULL) {
+      existing->setValue(std::move(keyValuePair.second));
+      return iterator(existing, this);
+    }
+    Node<Key, Value>* addednode = createNode(Key(keyValuePair.first), std::move(keyValuePair.second), parent);
+    linkNode(addednode, parent, left);
+    return iterator(addednode, this);
+}
+
+/**
+* emplace() with a hint, see the hinted insert().
+*/
+template<class Key, class Value, class Compare>
+template<typename... Args>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::emplace_hint(const_iterator hint, Args&&... args)
+{
+    std::pair<Key, Value> item(std::forward<Args>(args)...);
+    Node<Key, Value>* parent = NULL;
+    bool left = false;
+    Node<Key, Value>* existing = findHintSlot(hint.current_, item.first, parent, left);
+    if (existing != NULL) {
+      existing->setValue(std::move(item.second));
+      return iterator(existing, this);
+    }
+    Node<Key, Value>* addednode = createNode(std::move(item.first), std::move(item.second), parent);
+    linkNode(addednode, parent, left);
+    return iterator(addednode, this);
+}
+
+/**
+* Hangs a new node off the slot that findSlot() returned and lets the
+* derived tree rebalance from there.
+*/
+template<class Key, class Value, class Compare>
+void BinarySearchTree<Key, Value, Compare>::linkNode(Node<Key, Value>* node, Node<Key, Value>* parent, bool left)
+{
+    // empty tree case
+    if (parent == NULL) {
+      root_ = node;
+      smallest_ = node;
+      largest_ = node;
+    } else if (left) {
+      parent->setLeft(node);
+      if (parent == smallest_) {
+        smallest_ = node;
+      }
+    } else {
+      parent->setRight(node);
+      if (parent == largest_) {
+        largest_ = node;
+      }
+    }
+    size_++;
+    insertFixup(node);
+}
+
+
+/**
+* A remove method to remove a specific key from a Binary Search Tree.
+* Recall: The writeup specifies that if a node has 2 children you
+* should swap with the predecessor and then remove.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::remove(const Key& key)
+{
+    // TODO
     // check if is in tree
     Node<Key, Value>* removednode = internalFind(key);
+    if (removednode != NULL) {
+      erase(iterator(removednode, this));
+    }
+}
+
+/**
+* Removes the item an iterator points to, without searching for it
+* again, and returns an iterator to the item after it.
+*/
+template<typename Key, typename Value, typename Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::erase(iterator pos)
+{
+    // nodes are relinked rather than moved, so the successor stays valid
+    Node<Key, Value>* next = successor(pos.current_);
+    if (pos.current_ == smallest_) {
+      smallest_ = next;
+    }
+    if (pos.current_ == largest_) {
+      largest_ = predecessor(pos.current_);
+    }
+    eraseNode(pos.current_);
+    return iterator(next, this);
+}
+
+/**
+* Removes the items in [first, last) and returns last.
+*/
+template<typename Key, typename Value, typename Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::erase(iterator first, iterator last)
+{
+    if (first != last) {
+      Node<Key, Value>* before = predecessor(first.current_);
+      eraseRange(first.current_, last.current_);
+      if (before == NULL) {
+        smallest_ = last.current_;
+      }
+      if (last.current_ == NULL) {
+        largest_ = before;
+      }
+    }
+    return iterator(last.current_, this);
+}
+
+/**
+* Removes the nodes from first up to, not including, last (NULL for
+* the end of the tree) one at a time. AVLTree overrides this to cut
+* the whole range out at once.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::eraseRange(Node<Key, Value>* first, Node<Key, Value>* last)
+{
+    while (first != last) {
+      Node<Key, Value>* next = successor(first);
+      eraseNode(first);
+      first = next;
+    }
+}
+
+/**
+* Unlinks a node from the tree and destroys it. A node with two
+* children first trades places with its predecessor.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::eraseNode(Node<Key, Value>* removednode)
+{
+    // use swapNode()helper function
     if (removednode == NULL) {
       return;
     } else {
@@ -523,16 +1720,16 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
         // check if root node
         if (removednode->getParent() == NULL) {
           root_ = NULL;
-          delete removednode;
+          destroyNode(removednode);
           return;
         }
         // check whether to unlink left or right side
-        if (removednode->getKey() < removednode->getParent()->getKey()) {
+        if (removednode->getParent()->getLeft() == removednode) {
           removednode->getParent()->setLeft(NULL);
-          delete removednode;
+          destroyNode(removednode);
         } else {
           removednode->getParent()->setRight(NULL);
-          delete removednode;
+          destroyNode(removednode);
         }
       } 
       // node has 1 child, needs to link parent to the nodes child
@@ -548,7 +1745,7 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
             root_ = removednode->getRight();
             root_->setParent(NULL);
           }
-          delete removednode;
+          destroyNode(removednode);
           return;
         }
         // only left child exists
@@ -557,20 +1754,20 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
           // check which side removednode is on
           if (removednode->getParent()->getLeft() == removednode) {
             removednode->getParent()->setLeft(removednode->getLeft());
-            delete removednode;
+            destroyNode(removednode);
           } else {
             removednode->getParent()->setRight(removednode->getLeft());
-            delete removednode;
+            destroyNode(removednode);
           }
         } else {
           removednode->getRight()->setParent(removednode->getParent());
           // check which side removednode is on:
           if (removednode->getParent()->getLeft() == removednode) {
             removednode->getParent()->setLeft(removednode->getRight());
-            delete removednode;
+            destroyNode(removednode);
           } else {
             removednode->getParent()->setRight(removednode->getRight());
-            delete removednode;
+            destroyNode(removednode);
           }
         }
       } 
@@ -589,125 +1786,550 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
         // check whether to unlink left or right side
         if (removednode->getParent()->getLeft() == removednode) {
           removednode->getParent()->setLeft(NULL);
-          delete removednode;
+          destroyNode(removednode);
         } else {
           removednode->getParent()->setRight(NULL);
-          delete removednode;
+          destroyNode(removednode);
+        }
+      } 
+      // has 1 child
+      else {
+        if (removednode->getLeft() != NULL) {
+          removednode->getLeft()->setParent(removednode->getParent());
+          // check which side removednode is on
+          if (removednode->getParent()->getLeft() == removednode) {
+            removednode->getParent()->setLeft(removednode->getLeft());
+            destroyNode(removednode);
+          } else {
+            removednode->getParent()->setRight(removednode->getLeft());
+            destroyNode(removednode);
+          }
+        } else {
+          removednode->getRight()->setParent(removednode->getParent());
+          // check which side removednode is on:
+          if (removednode->getParent()->getLeft() == removednode) {
+            removednode->getParent()->setLeft(removednode->getRight());
+            destroyNode(removednode);
+          } else {
+            removednode->getParent()->setRight(removednode->getRight());
+            destroyNode(removednode);
+          }
+        }
+      }
+
+
+    }
+    }
+}
+
+
+
+template<class Key, class Value, class Compare>
+Node<Key, Value>*
+BinarySearchTree<Key, Value, Compare>::predecessor(Node<Key, Value>* current)
+{
+    // TODO
+
+    // case 1: has left child
+    if (current->getLeft() != NULL) {
+      Node<Key, Value>* predec = current->getLeft();
+        // all values to the right are bigger so go right until null
+        while (predec->getRight() != NULL) {
+          predec = predec->getRight();
+        }
+      return predec;
+    }
+    // case 2: has no left child
+    while (current->getParent() != NULL && current == current->getParent()->getLeft()) {
+      current = current->getParent();
+    }
+    return current->getParent();
+}
+
+template<class Key, class Value, class Compare>
+Node<Key, Value>*
+BinarySearchTree<Key, Value, Compare>::successor(Node<Key, Value>* current)
+{
+    // TODO
+    // if right child go right once then as far left
+    Node<Key, Value>* succ = current;
+    if (succ->getRight() != NULL) {
+      succ = succ->getRight();
+      while (succ->getLeft() != NULL) {
+        succ = succ->getLeft();
+      }
+    } else {
+      while (succ->getParent() != NULL && succ->getParent()->getRight() == succ) {
+        succ = succ->getParent();
+      }
+      // CALL ONE MROE TIME
+      succ = succ->getParent();
+    }
+  current = succ;
+  return succ;
+}
+
+
+/**
+* A method to remove all contents of the tree and
+* reset the values in the tree for use again.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::clear()
+{
+    // TODO
+    // deletion strategy: post order traversal
+    /* visit left subtree, then right subtree, then delete current node.
+    aka delete the children before the parent. can implement recursively*/
+    // when the items have no destructors to run, the slabs can simply be
+    // dropped without visiting a single node
+    if (pool_.shared()) {
+      // our nodes may sit in other trees' slabs, so they have to be
+      // destroyed one by one. Dropping our slabs afterwards is safe:
+      // every tree we gave nodes to holds its own reference to them
+      // (see NodePool::share()), and they are freed with the last one
+      clearHelper(root_);
+    } else if (!NodePool::releasesInBulk || !std::is_trivially_destructible<std::pair<const Key, Value> >::value) {
+      clearHelper(root_);
+    }
+    pool_.release();
+    // deletes all memory that root_ points to but now needs to set root_ to NULL
+    root_ = NULL;
+    size_ = 0;
+    sizeKnown_ = true;
+    smallest_ = NULL;
+    largest_ = NULL;
+}
+
+// helper function for clear()
+// destroys the subtree under current bottom up, without recursion so a
+// degenerate tree of any height can be torn down. A node is only
+// destroyed once it has no children left, and it is unhooked from its
+// parent first, so walking back up from it finds the next node to visit.
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::clearHelper(Node<Key, Value>* current) {
+  while (current != NULL) {
+    if (current->getLeft() != NULL) {
+      current = current->getLeft();
+    } else if (current->getRight() != NULL) {
+      current = current->getRight();
+    } else {
+      // leaf: unlink it and continue from the parent
+      Node<Key, Value>* parent = current->getParent();
+      if (parent != NULL) {
+        if (parent->getLeft() == current) {
+          parent->setLeft(NULL);
+        } else {
+          parent->setRight(NULL);
+        }
+      }
+      destroyNode(current);
+      current = parent;
+    }
+  }
+}
+
+/**
+* Fills an empty tree with a copy of other that has exactly the same
+* shape, in O(n) with no comparisons or rotations. The source is walked
+* in preorder through the parent links while the copy is grown along the
+* same path, so no stack is needed however deep the tree is. If copying
+* an item throws, the partial copy is cleared again.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::cloneFrom(const BinarySearchTree& other)
+{
+    const Node<Key, Value>* source = other.root_;
+    if (source == NULL) {
+      return;
+    }
+    try {
+      root_ = cloneNode(source, NULL);
+      Node<Key, Value>* copy = root_;
+      while (copy != NULL) {
+        if (source->getLeft() != NULL && copy->getLeft() == NULL) {
+          source = source->getLeft();
+          copy->setLeft(cloneNode(source, copy));
+          copy = copy->getLeft();
+        } else if (source->getRight() != NULL && copy->getRight() == NULL) {
+          source = source->getRight();
+          copy->setRight(cloneNode(source, copy));
+          copy = copy->getRight();
+        } else {
+          // both subtrees are done, back up one level
+          source = source->getParent();
+          copy = copy->getParent();
+        }
+      }
+      size_ = other.size();
+      resetEnds();
+      rebuiltFixup();
+    } catch (...) {
+      clear();
+      throw;
+    }
+}
+
+/**
+* Destroys a node and hands its slot back to the pool.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::destroyNode(Node<Key, Value>* node)
+{
+    node->~Node();
+    pool_.deallocate(node);
+    size_--;
+}
+
+
+/**
+* Rotates node above its parent, keeping the order of the items: a
+* left child takes a right rotation and vice versa. Every rotation of
+* BalancedTree and SplayTree is one or two of these.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::rotateUp(Node<Key, Value>* node)
+{
+    Node<Key, Value>* parent = node->getParent();
+    Node<Key, Value>* grand = parent->getParent();
+    if (parent->getLeft() == node) {
+      Node<Key, Value>* inner = node->getRight();
+      parent->setLeft(inner);
+      if (inner != NULL) {
+        inner->setParent(parent);
+      }
+      node->setRight(parent);
+    } else {
+      Node<Key, Value>* inner = node->getLeft();
+      parent->setRight(inner);
+      if (inner != NULL) {
+        inner->setParent(parent);
+      }
+      node->setLeft(parent);
+    }
+    parent->setParent(node);
+    node->setParent(grand);
+    if (grand == NULL) {
+      root_ = node;
+    } else if (grand->getLeft() == parent) {
+      grand->setLeft(node);
+    } else {
+      grand->setRight(node);
+    }
+}
+
+/**
+* Replaces the contents of the tree with the items in [first, last).
+* If the keys are in ascending order the tree is built directly as a
+* perfectly balanced tree in O(n), without any searching or rotations.
+* Runs of equal keys are allowed, the last item of a run wins just as
+* with repeated insert() calls. If the range turns out not to be sorted
+* the items are simply inserted one by one. If copying an item throws,
+* the tree is left empty.
+*/
+template<typename Key, typename Value, typename Compare>
+template<typename ForwardIterator>
+void BinarySearchTree<Key, Value, Compare>::assign(ForwardIterator first, ForwardIterator last)
+{
+    clear();
+    // one pass to check the order and count distinct keys
+    std::size_t count = 0;
+    bool sorted = true;
+    for (ForwardIterator prev = first, it = first; it != last; prev = it, ++it) {
+      if (it == first || comp_(prev->first, it->first)) {
+        count++;
+      } else if (comp_(it->first, prev->first)) {
+        sorted = false;
+        break;
+      }
+    }
+    if (!sorted) {
+      for (; first != last; ++first) {
+        insert(*first);
+      }
+      return;
+    }
+    int height;
+    try {
+      root_ = buildBalanced(first, last, count, height);
+    } catch (...) {
+      // the build has destroyed its nodes already
+      clear();
+      throw;
+    }
+    size_ = count;
+    resetEnds();
+    rebuiltFixup();
+}
+
+/**
+* Replaces the contents of the tree with items, which may be in any
+* order. A key given more than once keeps its last value, just as with
+* repeated insert() calls. The items are sorted with a parallel merge
+* sort, and the balanced tree is built straight from the sorted run
+* with its subtrees built concurrently into one block of node slots.
+* That is O(n log n) work spread over every hardware thread, with no
+* searching or rotations. Moving a Key or Value must not throw.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::assignUnsorted(std::vector<std::pair<Key, Value> > items)
+{
+    clear();
+    if (items.empty()) {
+      return;
+    }
+    int depth = forkDepth();
+    const Compare& comp = comp_;
+    std::pair<Key, Value>* first = items.data();
+    std::size_t n = items.size();
+    parallelStableSort(first, first + n, [&comp](const std::pair<Key, Value>& a, const std::pair<Key, Value>& b) {
+      return comp(a.first, b.first);
+    }, depth);
+
+    // equal keys now sit next to each other in their original order and
+    // the last of each run is the one to keep. Each chunk counts its own
+    // run ends, which tells every chunk where its share of keep starts.
+    const std::size_t chunkSize = 65536;
+    std::size_t chunks = (n + chunkSize - 1) / chunkSize;
+    std::vector<std::size_t> starts(chunks + 1, 0);
+    parallelFor(0, chunks, 1, depth, [&](std::size_t lo, std::size_t hi) {
+      for (std::size_t c = lo; c < hi; c++) {
+        std::size_t end = std::min(n, (c + 1) * chunkSize);
+        for (std::size_t i = c * chunkSize; i < end; i++) {
+          starts[c + 1] += (i + 1 == n || comp(first[i].first, first[i + 1].first));
         }
-      } 
-      // has 1 child
-      else {
-        if (removednode->getLeft() != NULL) {
-          removednode->getLeft()->setParent(removednode->getParent());
-          // check which side removednode is on
-          if (removednode->getParent()->getLeft() == removednode) {
-            removednode->getParent()->setLeft(removednode->getLeft());
-            delete removednode;
-          } else {
-            removednode->getParent()->setRight(removednode->getLeft());
-            delete removednode;
-          }
-        } else {
-          removednode->getRight()->setParent(removednode->getParent());
-          // check which side removednode is on:
-          if (removednode->getParent()->getLeft() == removednode) {
-            removednode->getParent()->setLeft(removednode->getRight());
-            delete removednode;
-          } else {
-            removednode->getParent()->setRight(removednode->getRight());
-            delete removednode;
+      }
+    });
+    for (std::size_t c = 0; c < chunks; c++) {
+      starts[c + 1] += starts[c];
+    }
+    std::vector<std::size_t> keep(starts[chunks]);
+    parallelFor(0, chunks, 1, depth, [&](std::size_t lo, std::size_t hi) {
+      for (std::size_t c = lo; c < hi; c++) {
+        std::size_t out = starts[c];
+        std::size_t end = std::min(n, (c + 1) * chunkSize);
+        for (std::size_t i = c * chunkSize; i < end; i++) {
+          if (i + 1 == n || comp(first[i].first, first[i + 1].first)) {
+            keep[out++] = i;
           }
         }
       }
+    });
 
+    char* slots = static_cast<char*>(pool_.allocateBlock(keep.size()));
+    if (slots == NULL) {
+      // without the node pool nodes can only be made one at a time
+      assign(items.begin(), items.end());
+      return;
+    }
+    int height;
+    root_ = buildBlock(first, keep.data(), keep.size(), slots, height, depth);
+    size_ = keep.size();
+    resetEnds();
+    rebuiltFixup();
+}
 
+/**
+* Builds a balanced subtree out of the items at the count positions in
+* keep, which are in key order, placing the i-th one in the i-th slot
+* from slots. The two subtrees under each node are independent, so
+* large ones are built in parallel.
+*/
+template<typename Key, typename Value, typename Compare>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::buildBlock(std::pair<Key, Value>* items, const std::size_t* keep, std::size_t count,
+                                                                    char* slots, int& height, int depth)
+{
+    if (count == 0) {
+      height = 0;
+      return NULL;
+    }
+    std::size_t mid = count / 2;
+    std::size_t slotSize = pool_.slotSize();
+    Node<Key, Value>* left;
+    Node<Key, Value>* right;
+    int leftheight, rightheight;
+    forkJoin(count >= kForkBuildSize ? depth : 0,
+      [&]() { left = buildBlock(items, keep, mid, slots, leftheight, depth - 1); },
+      [&]() { right = buildBlock(items, keep + mid + 1, count - mid - 1, slots + (mid + 1) * slotSize, rightheight, depth - 1); });
+
+    std::pair<Key, Value>& item = items[keep[mid]];
+    Node<Key, Value>* node = placeNode(slots + mid * slotSize, std::move(item.first), std::move(item.second));
+    node->setLeft(left);
+    if (left != NULL) {
+      left->setParent(node);
     }
+    node->setRight(right);
+    if (right != NULL) {
+      right->setParent(node);
     }
+    buildFixup(node, leftheight, rightheight);
+    height = 1 + (leftheight > rightheight ? leftheight : rightheight);
+    return node;
 }
 
-
-
-template<class Key, class Value>
-Node<Key, Value>*
-BinarySearchTree<Key, Value>::predecessor(Node<Key, Value>* current)
+/**
+* Builds a balanced subtree out of the next count distinct keys of the
+* range, in order, and returns its root. it is left just past the items
+* used, and height is set to the height of the subtree. If making a node
+* throws, the nodes built so far are destroyed before it rethrows.
+*/
+template<typename Key, typename Value, typename Compare>
+template<typename ForwardIterator>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::buildBalanced(ForwardIterator& it, ForwardIterator last, std::size_t count, int& height)
 {
-    // TODO
+    if (count == 0) {
+      height = 0;
+      return NULL;
+    }
+    int leftheight, rightheight;
+    Node<Key, Value>* left = buildBalanced(it, last, count / 2, leftheight);
 
-    // case 1: has left child
-    if (current->getLeft() != NULL) {
-      Node<Key, Value>* predec = current->getLeft();
-        // all values to the right are bigger so go right until null
-        while (predec->getRight() != NULL) {
-          predec = predec->getRight();
-        }
-      return predec;
+    // skip to the last item with this key
+    ForwardIterator item = it;
+    for (++it; it != last && !comp_(item->first, it->first); ++it) {
+      item = it;
     }
-    // case 2: has no left child
-    while (current->getParent() != NULL && current == current->getParent()->getLeft()) {
-      current = current->getParent();
+    Node<Key, Value>* node;
+    try {
+      node = createNode(item->first, item->second, NULL);
+    } catch (...) {
+      // nothing links to the part built so far, so destroy it here
+      clearHelper(left);
+      throw;
     }
-    return current->getParent();
+    node->setLeft(left);
+    if (left != NULL) {
+      left->setParent(node);
+    }
+    Node<Key, Value>* right;
+    try {
+      right = buildBalanced(it, last, count - count / 2 - 1, rightheight);
+    } catch (...) {
+      clearHelper(node);
+      throw;
+    }
+    node->setRight(right);
+    if (right != NULL) {
+      right->setParent(node);
+    }
+    buildFixup(node, leftheight, rightheight);
+    height = 1 + (leftheight > rightheight ? leftheight : rightheight);
+    return node;
 }
 
-template<class Key, class Value>
-Node<Key, Value>*
-BinarySearchTree<Key, Value>::successor(Node<Key, Value>* current)
+/**
+* Allocates a node for this tree from the pool. Derived trees
+* override this to create their own node type.
+*/
+template<typename Key, typename Value, typename Compare>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::createNode(const Key& key, const Value& value, Node<Key, Value>* parent)
 {
-    // TODO
-    // if right child go right once then as far left
-    Node<Key, Value>* succ = current;
-    if (succ->getRight() != NULL) {
-      succ = succ->getRight();
-      while (succ->getLeft() != NULL) {
-        succ = succ->getLeft();
-      }
-    } else {
-      while (succ->getParent() != NULL && succ->getParent()->getRight() == succ) {
-        succ = succ->getParent();
-      }
-      // CALL ONE MROE TIME
-      succ = succ->getParent();
+    return constructNode<Node<Key, Value> >(key, value, parent);
+}
+
+/**
+* Same as above, moving the key and value into the node.
+*/
+template<typename Key, typename Value, typename Compare>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::createNode(Key&& key, Value&& value, Node<Key, Value>* parent)
+{
+    return constructNode<Node<Key, Value> >(std::move(key), std::move(value), parent);
+}
+
+/**
+* Builds a node of type NodeT in a slot from the pool, handing the slot
+* back if the node's constructor throws. Every createNode() ends here.
+*/
+template<typename Key, typename Value, typename Compare>
+template<typename NodeT, typename... Args>
+NodeT* BinarySearchTree<Key, Value, Compare>::constructNode(Args&&... args)
+{
+    void* slot = pool_.allocate();
+    try {
+      return new (slot) NodeT(std::forward<Args>(args)...);
+    } catch (...) {
+      pool_.deallocate(slot);
+      throw;
     }
-  current = succ;
-  return succ;
 }
 
+/**
+* Builds a node without a parent in a slot that was already taken from
+* the pool, see assignUnsorted().
+*/
+template<typename Key, typename Value, typename Compare>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::placeNode(void* slot, Key&& key, Value&& value)
+{
+    return new (slot) Node<Key, Value>(std::move(key), std::move(value), NULL);
+}
+
+/**
+* Creates a copy of source for cloneFrom(), with no children yet.
+* Derived trees override this to carry over their balance data.
+*/
+template<typename Key, typename Value, typename Compare>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::cloneNode(const Node<Key, Value>* source, Node<Key, Value>* parent)
+{
+    return createNode(source->getKey(), source->getValue(), parent);
+}
 
 /**
-* A method to remove all contents of the tree and
-* reset the values in the tree for use again.
+* Called by linkNode() once a new node is in place, so derived trees
+* can restore their balance. A plain BST has nothing to do.
 */
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::clear()
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::insertFixup(Node<Key, Value>*)
 {
-    // TODO
-    // deletion strategy: post order traversal
-    /* visit left subtree, then right subtree, then delete current node.
-    aka delete the children before the parent. can implement recursively*/
-    clearHelper(root_);
-    // deletes all memory that root_ points to but now needs to set root_ to NULL
-    root_ = NULL;
+
 }
 
-// helper function for clear()
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::clearHelper(Node<Key, Value>* current) {
-  // will pass in root through main
-  if (current == NULL) {
-    return;
-  }
-  clearHelper(current->getLeft());
-  clearHelper(current->getRight());
-  delete current;
+/**
+* Called by buildBalanced() once a node has both of its subtrees, with
+* their heights, so derived trees can set up their balance data. A plain
+* BST keeps none.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::buildFixup(Node<Key, Value>*, int, int)
+{
+
+}
+
+/**
+* Called once the whole tree was built or copied in bulk (assign(),
+* assignUnsorted(), copies), for bookkeeping that spans nodes. A plain
+* BST keeps none.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::rebuiltFixup()
+{
+
+}
+
+/**
+* The node after node in key order. Only called on trees that set
+* threaded_, which must override this and prevNode().
+*/
+template<typename Key, typename Value, typename Compare>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::nextNode(Node<Key, Value>* node) const
+{
+    return successor(node);
 }
 
+/**
+* The node before node in key order, see nextNode().
+*/
+template<typename Key, typename Value, typename Compare>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::prevNode(Node<Key, Value>* node) const
+{
+    return predecessor(node);
+}
 
 /**
 * A helper function to find the smallest node in the tree.
 */
-template<typename Key, typename Value>
+template<typename Key, typename Value, typename Compare>
 Node<Key, Value>*
-BinarySearchTree<Key, Value>::getSmallestNode() const
+BinarySearchTree<Key, Value, Compare>::getSmallestNode() const
 {
     // TODO
     // left is alwauys smaller, so keep going left until null
@@ -721,20 +2343,91 @@ BinarySearchTree<Key, Value>::getSmallestNode() const
     return curr;
 }
 
+/**
+* Returns the node with the largest key, or NULL for an empty tree.
+*/
+template<typename Key, typename Value, typename Compare>
+Node<Key, Value>*
+BinarySearchTree<Key, Value, Compare>::getLargestNode() const
+{
+    if (root_ == NULL) {
+      return NULL;
+    }
+    Node<Key, Value>* curr = root_;
+    while (curr->getRight() != NULL) {
+      curr = curr->getRight();
+    }
+    return curr;
+}
+
 /**
 * Helper function to find a node with given key, k and
 * return a pointer to it or NULL if no item with that key
 * exists
 */
-template<typename Key, typename Value>
-Node<Key, Value>* BinarySearchTree<Key, Value>::internalFind(const Key& key) const
+template<typename Key, typename Value, typename Compare>
+template<typename K>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::internalFind(const K& key) const
 {
     // TODO
+    return findNode(key, typename ThreeWayCompare<Compare, K, Key>::Available());
+}
+
+/**
+* Finds the first node whose key is not before key, or NULL. Each
+* level takes a single comparison.
+*/
+template<typename Key, typename Value, typename Compare>
+template<typename K>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::lowerBoundNode(const K& key) const
+{
+    Node<Key, Value>* bound = NULL;
+    Node<Key, Value>* curr = root_;
+    while (curr != NULL) {
+      if (comp_(curr->getKey(), key)) {
+        curr = curr->getRight();
+      } else {
+        bound = curr;
+        curr = curr->getLeft();
+      }
+    }
+    return bound;
+}
+
+/**
+* Finds the first node whose key comes after key, or NULL.
+*/
+template<typename Key, typename Value, typename Compare>
+template<typename K>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::upperBoundNode(const K& key) const
+{
+    Node<Key, Value>* bound = NULL;
+    Node<Key, Value>* curr = root_;
+    while (curr != NULL) {
+      if (comp_(key, curr->getKey())) {
+        bound = curr;
+        curr = curr->getLeft();
+      } else {
+        curr = curr->getRight();
+      }
+    }
+    return bound;
+}
+
+/**
+* internalFind() for keys with a three-way comparison: one call per
+* level, stopping as soon as the key is found.
+*/
+template<typename Key, typename Value, typename Compare>
+template<typename K>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::findNode(const K& key, std::true_type) const
+{
     Node<Key, Value>* current = root_;
     while (current != NULL) {
-      if (key < current->getKey()) {
+      int cmp = ThreeWayCompare<Compare, K, Key>::compare(comp_, key, current->getKey());
+      if (cmp < 0) {
         current = current->getLeft();
-      } else if (key > current->getKey()) {
+      } else if (cmp > 0) {
         current = current->getRight();
       } else {
         return current;
@@ -742,14 +2435,184 @@ Node<Key, Value>* BinarySearchTree<Key, Value>::internalFind(const Key& key) con
     }
     // made out of loop and current is null then not in tree
     return NULL;
-    
+}
+
+/**
+* internalFind() using only comp_: each level asks whether the node is
+* before the key, remembering the last node that was not. That node is
+* the only one that can equal the key, which takes one more comparison.
+*/
+template<typename Key, typename Value, typename Compare>
+template<typename K>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::findNode(const K& key, std::false_type) const
+{
+    Node<Key, Value>* current = root_;
+    Node<Key, Value>* candidate = NULL;
+    while (current != NULL) {
+      if (comp_(current->getKey(), key)) {
+        current = current->getRight();
+      } else {
+        candidate = current;
+        current = current->getLeft();
+      }
+    }
+    if (candidate != NULL && !comp_(key, candidate->getKey())) {
+      return candidate;
+    }
+    return NULL;
+}
+
+/**
+* Finds where key belongs. Returns the node already holding key, or
+* NULL with parent set to the node a new leaf would hang off (NULL for
+* an empty tree) and left telling which side.
+*/
+template<typename Key, typename Value, typename Compare>
+template<typename K>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::findSlot(const K& key, Node<Key, Value>*& parent, bool& left) const
+{
+    return findSlot(root_, key, parent, left, typename ThreeWayCompare<Compare, K, Key>::Available());
+}
+
+/**
+* The descents behind findSlot(), which start at top. The key must
+* belong somewhere under top, which is the case for the root.
+*/
+template<typename Key, typename Value, typename Compare>
+template<typename K>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::findSlot(Node<Key, Value>* top, const K& key, Node<Key, Value>*& parent, bool& left, std::true_type) const
+{
+    Node<Key, Value>* child = top;
+    parent = NULL;
+    left = false;
+    while (child != NULL) {
+      int cmp = ThreeWayCompare<Compare, K, Key>::compare(comp_, key, child->getKey());
+      if (cmp == 0) {
+        return child;
+      }
+      parent = child;
+      left = cmp < 0;
+      child = left ? child->getLeft() : child->getRight();
+    }
+    return NULL;
+}
+
+/**
+* findSlot() using only comp_. Going right means the node is not after
+* the key, so the last node we went right at is the only possible match.
+*/
+template<typename Key, typename Value, typename Compare>
+template<typename K>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::findSlot(Node<Key, Value>* top, const K& key, Node<Key, Value>*& parent, bool& left, std::false_type) const
+{
+    Node<Key, Value>* child = top;
+    Node<Key, Value>* candidate = NULL;
+    parent = NULL;
+    left = false;
+    while (child != NULL) {
+      parent = child;
+      left = comp_(key, child->getKey());
+      if (left) {
+        child = child->getLeft();
+      } else {
+        candidate = child;
+        child = child->getRight();
+      }
+    }
+    if (candidate != NULL && !comp_(candidate->getKey(), key)) {
+      return candidate;
+    }
+    return NULL;
+}
+
+/**
+* findSlot() for a key that should go just before hint (NULL for the
+* end). If the hint is right, two comparisons with hint and its
+* neighbour place the key. Otherwise we climb from hint only until the
+* subtree we are in must hold the key, and search down from there.
+*/
+template<typename Key, typename Value, typename Compare>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::findHintSlot(const Node<Key, Value>* hint, const Key& key, Node<Key, Value>*& parent, bool& left) const
+{
+    if (hint == NULL) {
+      if (largest_ == NULL) {
+        parent = NULL;
+        left = false;
+        return NULL;
+      }
+      // appending: compare against the cached last node
+      hint = largest_;
+    }
+    // the hint came from a const_iterator, but it is one of our nodes
+    Node<Key, Value>* top = const_cast<Node<Key, Value>*>(hint);
+    if (comp_(key, top->getKey())) {
+      Node<Key, Value>* before = (top == smallest_) ? NULL : predecessor(top);
+      if (before == NULL || comp_(before->getKey(), key)) {
+        // the key goes between the two, and one of them has a free slot
+        left = top->getLeft() == NULL;
+        parent = left ? top : before;
+        return NULL;
+      }
+      // everything above a left link is after the key as well, so stop
+      // at the first right link whose parent is before it
+      while (top->getParent() != NULL) {
+        Node<Key, Value>* up = top->getParent();
+        if (up->getRight() == top && comp_(up->getKey(), key)) {
+          break;
+        }
+        top = up;
+      }
+    } else if (comp_(top->getKey(), key)) {
+      Node<Key, Value>* after = (top == largest_) ? NULL : successor(top);
+      if (after == NULL || comp_(key, after->getKey())) {
+        left = top->getRight() != NULL;
+        parent = left ? after : top;
+        return NULL;
+      }
+      // mirror image of the climb above
+      while (top->getParent() != NULL) {
+        Node<Key, Value>* up = top->getParent();
+        if (up->getLeft() == top && comp_(key, up->getKey())) {
+          break;
+        }
+        top = up;
+      }
+    } else {
+      return top;
+    }
+    return findSlot(top, key, parent, left, typename ThreeWayCompare<Compare, Key, Key>::Available());
+}
+
+/**
+* Refreshes the cached first and last node after the tree was built
+* in some other way than linking nodes one by one.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::resetEnds()
+{
+    smallest_ = getSmallestNode();
+    largest_ = getLargestNode();
+}
+
+/**
+* Empties the tree without destroying anything, for when its nodes
+* have been handed to another tree.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::forgetNodes()
+{
+    root_ = NULL;
+    size_ = 0;
+    sizeKnown_ = true;
+    smallest_ = NULL;
+    largest_ = NULL;
 }
 
 /**
  * Return true iff the BST is balanced.
  */
-template<typename Key, typename Value>
-bool BinarySearchTree<Key, Value>::isBalanced() const
+template<typename Key, typename Value, typename Compare>
+bool BinarySearchTree<Key, Value, Compare>::isBalanced() const
 {
     // TODO
     // use post order traversal - visit child before the parent - can track heights
@@ -768,50 +2631,75 @@ bool BinarySearchTree<Key, Value>::isBalanced() const
 }
 
 // will return the height of the function or -1 if unbalanced
-template<typename Key, typename Value>
-int BinarySearchTree<Key, Value>::balancedHeight(Node<Key, Value>* curr) const {
-
-  if (curr == NULL) {
-    // reached end
-    return 0;
-  }
-  // find heights of subtrees
-  int leftheight = balancedHeight(curr->getLeft());
-  int rightheight = balancedHeight(curr->getRight());
-
-  if (leftheight == -1) {
-    return -1;
-  }
-
-  if (rightheight == -1) {
-    return -1;
-  }
-
-  int heightdiff = leftheight - rightheight;
-  if (heightdiff < 0) {
-    // make a positive value
-    heightdiff *= -1;
-  }
+// post order walk that follows parent pointers instead of recursing, so it
+// is safe on a tree of any height. The height of each finished left subtree
+// is parked in leftheights[depth] until its sibling is done. A balanced
+// tree with fewer than 2^64 nodes is at most 92 levels deep, so running
+// out of slots already means the tree is unbalanced.
+template<typename Key, typename Value, typename Compare>
+int BinarySearchTree<Key, Value, Compare>::balancedHeight(Node<Key, Value>* curr) const {
+
+  const int maxdepth = 96;
+  int leftheights[maxdepth];
+  int depth = 0;
+  // height of the subtree that was finished last
+  int finished = 0;
+  Node<Key, Value>* top = (curr == NULL) ? NULL : curr->getParent();
+  Node<Key, Value>* prev = top;
+
+  while (curr != top) {
+    int rightheight;
+    if (prev == curr->getParent()) {
+      // first visit, go down the left side
+      if (depth == maxdepth) {
+        return -1;
+      }
+      if (curr->getLeft() != NULL) {
+        prev = curr;
+        curr = curr->getLeft();
+        depth++;
+        continue;
+      }
+      leftheights[depth] = 0;
+      if (curr->getRight() != NULL) {
+        prev = curr;
+        curr = curr->getRight();
+        depth++;
+        continue;
+      }
+      rightheight = 0;
+    } else if (prev == curr->getLeft()) {
+      // back from the left subtree
+      leftheights[depth] = finished;
+      if (curr->getRight() != NULL) {
+        prev = curr;
+        curr = curr->getRight();
+        depth++;
+        continue;
+      }
+      rightheight = 0;
+    } else {
+      // back from the right subtree
+      rightheight = finished;
+    }
 
-  if (heightdiff > 1) {
-    return -1;
-  }
-  
-  int totalheight;
-  // find max of leftheight and rightheight
-  if (leftheight > rightheight) {
-    totalheight = leftheight;
-  } else {
-    totalheight = rightheight;
+    // both subtrees are done
+    int heightdiff = leftheights[depth] - rightheight;
+    if (heightdiff < -1 || heightdiff > 1) {
+      return -1;
+    }
+    finished = 1 + (leftheights[depth] > rightheight ? leftheights[depth] : rightheight);
+    prev = curr;
+    curr = curr->getParent();
+    depth--;
   }
-  totalheight++;
-  return totalheight;
+  return finished;
 }
 
 
 
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value>* n2)
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value>* n2)
 {
     if((n1 == n2) || (n1 == NULL) || (n2 == NULL) ) {
         return;
@@ -0,0 +1,86 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <thread>
+#include <cstdint>
+#include <cstdlib>
+#include "bst.h"
+#include "avlbst.h"
+#include "btree.h"
+
+using namespace std;
+
+// Compares AVLTree and BPlusTree on random lookups of present keys and
+// on full in-order scans, for each tree size given on the command line
+// (1M, 4M and 16M by default; 100M needs about 10 GB for the AVLTree).
+
+typedef chrono::steady_clock Clock;
+
+static double msSince(Clock::time_point start)
+{
+    return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+template<typename Tree>
+void run(const char* name, const vector<uint64_t>& keys, const vector<uint64_t>& probes)
+{
+    Tree tree;
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < keys.size(); i++) {
+      tree.insert(make_pair(keys[i], i));
+    }
+    double buildMs = msSince(start);
+
+    uint64_t checksum = 0;
+    start = Clock::now();
+    for (size_t i = 0; i < probes.size(); i++) {
+      checksum += tree.find(probes[i])->second;
+    }
+    double findMs = msSince(start);
+
+    start = Clock::now();
+    for (typename Tree::iterator it = tree.begin(); it != tree.end(); ++it) {
+      checksum += it->second;
+    }
+    double scanMs = msSince(start);
+
+    cout << setw(12) << name << setw(12) << keys.size() << fixed << setprecision(1)
+         << setw(12) << buildMs << setw(14) << probes.size() / findMs / 1000.0
+         << setw(14) << keys.size() / scanMs / 1000.0 << "   (checksum " << checksum << ")" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    vector<size_t> sizes;
+    for (int i = 1; i < argc; i++) {
+      sizes.push_back(strtoul(argv[i], NULL, 10));
+    }
+    if (sizes.empty()) {
+      sizes.push_back(1000000);
+      sizes.push_back(4000000);
+      sizes.push_back(16000000);
+    }
+
+    cout << "hardware threads: " << thread::hardware_concurrency() << endl;
+    cout << setw(12) << "tree" << setw(12) << "n" << setw(12) << "build ms"
+         << setw(14) << "Mfinds/s" << setw(14) << "Mscanned/s" << endl;
+    for (size_t s = 0; s < sizes.size(); s++) {
+      size_t n = sizes[s];
+      mt19937_64 rng(104);
+      vector<uint64_t> keys(n);
+      for (size_t i = 0; i < n; i++) {
+        keys[i] = i * 2654435761u;
+      }
+      shuffle(keys.begin(), keys.end(), rng);
+      vector<uint64_t> probes(2000000);
+      for (size_t i = 0; i < probes.size(); i++) {
+        probes[i] = keys[rng() % n];
+      }
+      run<AVLTree<uint64_t, uint64_t> >("AVLTree", keys, probes);
+      run<BPlusTree<uint64_t, uint64_t> >("BPlusTree", keys, probes);
+    }
+    return 0;
+}
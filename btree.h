@@ -0,0 +1,834 @@
+#ifndef BTREE_H
+#define BTREE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+/**
+* A B+-tree with the interface of BinarySearchTree, for large maps where
+* lookups are dominated by cache misses. Nodes are about NodeBytes large
+* (a few cache lines), so a lookup follows one pointer per B levels
+* rather than one per binary level: with the defaults a tree of 100M
+* int keys is 6 levels deep instead of about 27.
+*
+* Inner nodes hold a sorted array of separator keys next to their child
+* pointers, separator i being a lower bound on the keys under child
+* i + 1. All items live in the leaves, sorted, as the pairs the iterators
+* hand out, and the leaves are linked in key order so that iteration
+* walks arrays rather than climbing the tree.
+*
+* Items move within and between leaves as the tree changes, so, unlike
+* with BinarySearchTree, any insert() or remove() invalidates all
+* iterators and references.
+*/
+template <typename Key, typename Value, typename Compare = std::less<Key>, std::size_t NodeBytes = 256>
+class BPlusTree
+{
+public:
+    typedef std::pair<const Key, Value> Item;
+    // items per leaf and keys per inner node, at least 4 each
+    static const std::size_t kLeafSlots = NodeBytes / sizeof(Item) < 4 ? 4 : NodeBytes / sizeof(Item);
+    static const std::size_t kInnerSlots = (NodeBytes - sizeof(void*)) / (sizeof(Key) + sizeof(void*)) < 4 ? 4
+                                           : (NodeBytes - sizeof(void*)) / (sizeof(Key) + sizeof(void*));
+
+    BPlusTree();
+    explicit BPlusTree(const Compare& comp);
+    ~BPlusTree();
+
+protected:
+    struct Node
+    {
+        // items in a leaf, keys in an inner node
+        std::uint16_t count;
+        bool leaf;
+    };
+    struct Leaf : Node
+    {
+        Item& item(std::size_t i) { return reinterpret_cast<Item*>(slots)[i]; }
+        Leaf* prev;
+        Leaf* next;
+        typename std::aligned_storage<sizeof(Item), alignof(Item)>::type slots[kLeafSlots];
+    };
+    struct Inner : Node
+    {
+        Key& key(std::size_t i) { return reinterpret_cast<Key*>(keySlots)[i]; }
+        typename std::aligned_storage<sizeof(Key), alignof(Key)>::type keySlots[kInnerSlots];
+        Node* children[kInnerSlots + 1];
+    };
+
+public:
+    /**
+    * A bidirectional iterator over the items in key order, comparable to
+    * BinarySearchTree::iterator.
+    */
+    class iterator
+    {
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef Item value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef Item* pointer;
+        typedef Item& reference;
+
+        iterator();
+
+        Item& operator*() const;
+        Item* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+        iterator operator++(int);
+        iterator& operator--();
+        iterator operator--(int);
+
+    protected:
+        friend class BPlusTree<Key, Value, Compare, NodeBytes>;
+        iterator(const BPlusTree<Key, Value, Compare, NodeBytes>* tree, Leaf* leaf, std::size_t index);
+        const BPlusTree<Key, Value, Compare, NodeBytes>* tree_;
+        Leaf* leaf_;
+        std::size_t index_;
+    };
+
+    std::pair<iterator, bool> insert(const Item& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    iterator find(const Key& key) const;
+    iterator begin() const;
+    iterator end() const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+    bool isBalanced() const;
+    bool empty() const;
+    std::size_t size() const;
+    int height() const;
+
+protected:
+    static const std::size_t kMinLeaf = kLeafSlots / 2;
+    // an inner node split in two may leave one key fewer on one side
+    static const std::size_t kMinInner = (kInnerSlots - 1) / 2;
+
+    template <typename T>
+    static void insertAt(T* slots, std::size_t count, std::size_t pos, T&& value);
+    template <typename T>
+    static void eraseAt(T* slots, std::size_t count, std::size_t pos);
+    template <typename T>
+    static void moveTo(T* from, T* to, std::size_t count);
+    static void replaceKey(Key& slot, const Key& key);
+
+    static Key* keys(Inner* inner);
+    static Item* items(Leaf* leaf);
+    std::size_t childIndex(Inner* inner, const Key& key) const;
+    std::size_t itemIndex(Leaf* leaf, const Key& key) const;
+    bool isFull(Node* n) const;
+    void splitChild(Inner* parent, std::size_t i);
+    bool removeFrom(Node* n, const Key& key);
+    void fixUnderflow(Inner* parent, std::size_t i);
+    void merge(Inner* parent, std::size_t i);
+    Leaf* lastLeaf() const;
+    void destroy(Node* n);
+    bool checkNode(Node* n, const Key* lower, const Key* upper, int depth, int& leafDepth, std::size_t& items) const;
+
+    Node* root_;
+    Leaf* first_;
+    std::size_t size_;
+    int height_;
+    Compare comp_;
+
+private:
+    BPlusTree(const BPlusTree&);
+    BPlusTree& operator=(const BPlusTree&);
+};
+
+template <typename Key, typename Value, typename Compare, std::size_t NodeBytes>
+const std::size_t BPlusTree<Key, Value, Compare, NodeBytes>::kLeafSlots;
+template <typename Key, typename Value, typename Compare, std::size_t NodeBytes>
+const std::size_t BPlusTree<Key, Value, Compare, NodeBytes>::kInnerSlots;
+template <typename Key, typename Value, typename Compare, std::size_t NodeBytes>
+const std::size_t BPlusTree<Key, Value, Compare, NodeBytes>::kMinLeaf;
+template <typename Key, typename Value, typename Compare, std::size_t NodeBytes>
+const std::size_t BPlusTree<Key, Value, Compare, NodeBytes>::kMinInner;
+
+/*
+--------------------------------------------------------
+Begin implementations for the BPlusTree::iterator class.
+--------------------------------------------------------
+*/
+
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+BPlusTree<Key, Value, Compare, NodeBytes>::iterator::iterator() :
+    tree_(NULL), leaf_(NULL), index_(0)
+{
+
+}
+
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+BPlusTree<Key, Value, Compare, NodeBytes>::iterator::iterator(const BPlusTree<Key, Value, Compare, NodeBytes>* tree,
+                                                              Leaf* leaf, std::size_t index) :
+    tree_(tree), leaf_(leaf), index_(index)
+{
+
+}
+
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+std::pair<const Key,Value> &
+BPlusTree<Key, Value, Compare, NodeBytes>::iterator::operator*() const
+{
+    return leaf_->item(index_);
+}
+
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+std::pair<const Key,Value> *
+BPlusTree<Key, Value, Compare, NodeBytes>::iterator::operator->() const
+{
+    return &leaf_->item(index_);
+}
+
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+bool BPlusTree<Key, Value, Compare, NodeBytes>::iterator::operator==(const iterator& rhs) const
+{
+    return leaf_ == rhs.leaf_ && index_ == rhs.index_;
+}
+
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+bool BPlusTree<Key, Value, Compare, NodeBytes>::iterator::operator!=(const iterator& rhs) const
+{
+    return !(*this == rhs);
+}
+
+/**
+* Steps to the next item of the leaf, or to the first of the next leaf.
+*/
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+typename BPlusTree<Key, Value, Compare, NodeBytes>::iterator&
+BPlusTree<Key, Value, Compare, NodeBytes>::iterator::operator++()
+{
+    if (++index_ == leaf_->count) {
+      leaf_ = leaf_->next;
+      index_ = 0;
+    }
+    return *this;
+}
+
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+typename BPlusTree<Key, Value, Compare, NodeBytes>::iterator
+BPlusTree<Key, Value, Compare, NodeBytes>::iterator::operator++(int)
+{
+    iterator before(*this);
+    ++(*this);
+    return before;
+}
+
+/**
+* Steps back one item; from end() that is the last item of the tree.
+*/
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+typename BPlusTree<Key, Value, Compare, NodeBytes>::iterator&
+BPlusTree<Key, Value, Compare, NodeBytes>::iterator::operator--()
+{
+    if (leaf_ == NULL) {
+      leaf_ = tree_->lastLeaf();
+      index_ = leaf_->count;
+    }
+    else if (index_ == 0) {
+      leaf_ = leaf_->prev;
+      index_ = leaf_->count;
+    }
+    index_--;
+    return *this;
+}
+
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+typename BPlusTree<Key, Value, Compare, NodeBytes>::iterator
+BPlusTree<Key, Value, Compare, NodeBytes>::iterator::operator--(int)
+{
+    iterator before(*this);
+    --(*this);
+    return before;
+}
+
+/*
+------------------------------------------------------
+End implementations for the BPlusTree::iterator class.
+------------------------------------------------------
+*/
+
+/*
+----------------------------------------------
+Begin implementations for the BPlusTree class.
+----------------------------------------------
+*/
+
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+BPlusTree<Key, Value, Compare, NodeBytes>::BPlusTree() :
+    root_(NULL), first_(NULL), size_(0), height_(0), comp_()
+{
+
+}
+
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+BPlusTree<Key, Value, Compare, NodeBytes>::BPlusTree(const Compare& comp) :
+    root_(NULL), first_(NULL), size_(0), height_(0), comp_(comp)
+{
+
+}
+
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+BPlusTree<Key, Value, Compare, NodeBytes>::~BPlusTree()
+{
+    clear();
+}
+
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+std::size_t BPlusTree<Key, Value, Compare, NodeBytes>::size() const
+{
+    return size_;
+}
+
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+bool BPlusTree<Key, Value, Compare, NodeBytes>::empty() const
+{
+    return size_ == 0;
+}
+
+/**
+* Returns the number of levels, leaves included; 0 for an empty tree.
+*/
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+int BPlusTree<Key, Value, Compare, NodeBytes>::height() const
+{
+    return height_;
+}
+
+/**
+* Moves value into slot pos of the count constructed slots, shifting
+* the ones from pos on up by one. slots must have room for count + 1.
+*/
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+template <typename T>
+void BPlusTree<Key, Value, Compare, NodeBytes>::insertAt(T* slots, std::size_t count, std::size_t pos, T&& value)
+{
+    for (std::size_t i = count; i > pos; i--) {
+      new (&slots[i]) T(std::move(slots[i - 1]));
+      slots[i - 1].~T();
+    }
+    new (&slots[pos]) T(std::move(value));
+}
+
+/**
+* Destroys slot pos of the count constructed slots, shifting the ones
+* after it down by one.
+*/
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+template <typename T>
+void BPlusTree<Key, Value, Compare, NodeBytes>::eraseAt(T* slots, std::size_t count, std::size_t pos)
+{
+    slots[pos].~T();
+    for (std::size_t i = pos + 1; i < count; i++) {
+      new (&slots[i - 1]) T(std::move(slots[i]));
+      slots[i].~T();
+    }
+}
+
+/**
+* Moves count constructed slots into as many raw ones elsewhere.
+*/
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+template <typename T>
+void BPlusTree<Key, Value, Compare, NodeBytes>::moveTo(T* from, T* to, std::size_t count)
+{
+    for (std::size_t i = 0; i < count; i++) {
+      new (&to[i]) T(std::move(from[i]));
+      from[i].~T();
+    }
+}
+
+/**
+* Keys need not be assignable, so a separator is replaced by
+* constructing the new one in place of the old.
+*/
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+void BPlusTree<Key, Value, Compare, NodeBytes>::replaceKey(Key& slot, const Key& key)
+{
+    slot.~Key();
+    new (&slot) Key(key);
+}
+
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+Key* BPlusTree<Key, Value, Compare, NodeBytes>::keys(Inner* inner)
+{
+    return &inner->key(0);
+}
+
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+typename BPlusTree<Key, Value, Compare, NodeBytes>::Item*
+BPlusTree<Key, Value, Compare, NodeBytes>::items(Leaf* leaf)
+{
+    return &leaf->item(0);
+}
+
+/**
+* The child of inner that key belongs under: the one after the last
+* separator that is not after key.
+*/
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+std::size_t BPlusTree<Key, Value, Compare, NodeBytes>::childIndex(Inner* inner, const Key& key) const
+{
+    Key* first = keys(inner);
+    return std::upper_bound(first, first + inner->count, key, comp_) - first;
+}
+
+/**
+* The index of the first item of leaf that is not before key.
+*/
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+std::size_t BPlusTree<Key, Value, Compare, NodeBytes>::itemIndex(Leaf* leaf, const Key& key) const
+{
+    std::size_t lo = 0;
+    std::size_t hi = leaf->count;
+    while (lo < hi) {
+      std::size_t mid = (lo + hi) / 2;
+      if (comp_(leaf->item(mid).first, key)) {
+        lo = mid + 1;
+      }
+      else {
+        hi = mid;
+      }
+    }
+    return lo;
+}
+
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+bool BPlusTree<Key, Value, Compare, NodeBytes>::isFull(Node* n) const
+{
+    return n->count == (n->leaf ? kLeafSlots : kInnerSlots);
+}
+
+/**
+* Splits the full child i of parent (which is not full) in two halves,
+* adding the separator between them to parent. A leaf passes up a copy
+* of the first key of its right half, an inner node its middle key.
+*/
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+void BPlusTree<Key, Value, Compare, NodeBytes>::splitChild(Inner* parent, std::size_t i)
+{
+    Node* child = parent->children[i];
+    Node* right;
+    if (child->leaf) {
+      Leaf* left = static_cast<Leaf*>(child);
+      Leaf* sibling = new Leaf;
+      sibling->leaf = true;
+      std::size_t half = left->count / 2;
+      sibling->count = left->count - half;
+      moveTo(items(left) + half, items(sibling), sibling->count);
+      left->count = half;
+      sibling->prev = left;
+      sibling->next = left->next;
+      if (left->next != NULL) {
+        left->next->prev = sibling;
+      }
+      left->next = sibling;
+      insertAt(keys(parent), parent->count, i, Key(sibling->item(0).first));
+      right = sibling;
+    }
+    else {
+      Inner* left = static_cast<Inner*>(child);
+      Inner* sibling = new Inner;
+      sibling->leaf = false;
+      std::size_t mid = left->count / 2;
+      sibling->count = left->count - mid - 1;
+      moveTo(keys(left) + mid + 1, keys(sibling), sibling->count);
+      std::copy(left->children + mid + 1, left->children + left->count + 1, sibling->children);
+      insertAt(keys(parent), parent->count, i, std::move(left->key(mid)));
+      left->key(mid).~Key();
+      left->count = mid;
+      right = sibling;
+    }
+    std::copy_backward(parent->children + i + 1, parent->children + parent->count + 1,
+                       parent->children + parent->count + 2);
+    parent->children[i + 1] = right;
+    parent->count++;
+}
+
+/**
+* Adds an item, or overwrites the value if the key is already there.
+* Full nodes are split on the way down, so there is always room for
+* the separator a split passes up.
+*/
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+std::pair<typename BPlusTree<Key, Value, Compare, NodeBytes>::iterator, bool>
+BPlusTree<Key, Value, Compare, NodeBytes>::insert(const Item& keyValuePair)
+{
+    const Key& key = keyValuePair.first;
+    if (root_ == NULL) {
+      Leaf* leaf = new Leaf;
+      leaf->leaf = true;
+      leaf->count = 0;
+      leaf->prev = leaf->next = NULL;
+      root_ = first_ = leaf;
+      height_ = 1;
+    }
+    if (isFull(root_)) {
+      Inner* root = new Inner;
+      root->leaf = false;
+      root->count = 0;
+      root->children[0] = root_;
+      splitChild(root, 0);
+      root_ = root;
+      height_++;
+    }
+    Node* n = root_;
+    while (!n->leaf) {
+      Inner* inner = static_cast<Inner*>(n);
+      std::size_t i = childIndex(inner, key);
+      if (isFull(inner->children[i])) {
+        splitChild(inner, i);
+        if (!comp_(key, inner->key(i))) {
+          i++;
+        }
+      }
+      n = inner->children[i];
+    }
+    Leaf* leaf = static_cast<Leaf*>(n);
+    std::size_t pos = itemIndex(leaf, key);
+    if (pos < leaf->count && !comp_(key, leaf->item(pos).first)) {
+      leaf->item(pos).second = keyValuePair.second;
+      return std::make_pair(iterator(this, leaf, pos), false);
+    }
+    insertAt(items(leaf), leaf->count, pos, Item(keyValuePair));
+    leaf->count++;
+    size_++;
+    return std::make_pair(iterator(this, leaf, pos), true);
+}
+
+/**
+* Removes key if it is there. Nodes that drop below half full on the
+* way back up borrow from a sibling or merge with it, and a root left
+* with a single child is replaced by that child.
+*/
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+void BPlusTree<Key, Value, Compare, NodeBytes>::remove(const Key& key)
+{
+    if (root_ == NULL || !removeFrom(root_, key)) {
+      return;
+    }
+    size_--;
+    if (root_->count == 0) {
+      Node* old = root_;
+      if (root_->leaf) {
+        root_ = first_ = NULL;
+      }
+      else {
+        root_ = static_cast<Inner*>(old)->children[0];
+      }
+      height_--;
+      if (old->leaf) {
+        delete static_cast<Leaf*>(old);
+      }
+      else {
+        delete static_cast<Inner*>(old);
+      }
+    }
+}
+
+/**
+* Removes key from the subtree of n and returns whether it was there.
+* Separators are left alone: one that no longer matches an item still
+* divides the keys correctly.
+*/
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+bool BPlusTree<Key, Value, Compare, NodeBytes>::removeFrom(Node* n, const Key& key)
+{
+    if (n->leaf) {
+      Leaf* leaf = static_cast<Leaf*>(n);
+      std::size_t pos = itemIndex(leaf, key);
+      if (pos == leaf->count || comp_(key, leaf->item(pos).first)) {
+        return false;
+      }
+      eraseAt(items(leaf), leaf->count, pos);
+      leaf->count--;
+      return true;
+    }
+    Inner* inner = static_cast<Inner*>(n);
+    std::size_t i = childIndex(inner, key);
+    if (!removeFrom(inner->children[i], key)) {
+      return false;
+    }
+    Node* child = inner->children[i];
+    if (child->count < (child->leaf ? kMinLeaf : kMinInner)) {
+      fixUnderflow(inner, i);
+    }
+    return true;
+}
+
+/**
+* Tops child i of parent up by one from a sibling that can spare it,
+* or otherwise merges it with a sibling.
+*/
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+void BPlusTree<Key, Value, Compare, NodeBytes>::fixUnderflow(Inner* parent, std::size_t i)
+{
+    Node* child = parent->children[i];
+    std::size_t minimum = child->leaf ? kMinLeaf : kMinInner;
+    Node* left = i > 0 ? parent->children[i - 1] : NULL;
+    Node* right = i < parent->count ? parent->children[i + 1] : NULL;
+    if (left != NULL && left->count > minimum) {
+      if (child->leaf) {
+        Leaf* to = static_cast<Leaf*>(child);
+        Leaf* from = static_cast<Leaf*>(left);
+        insertAt(items(to), to->count, 0, std::move(from->item(from->count - 1)));
+        from->item(from->count - 1).~Item();
+        replaceKey(parent->key(i - 1), to->item(0).first);
+      }
+      else {
+        Inner* to = static_cast<Inner*>(child);
+        Inner* from = static_cast<Inner*>(left);
+        insertAt(keys(to), to->count, 0, std::move(parent->key(i - 1)));
+        std::copy_backward(to->children, to->children + to->count + 1, to->children + to->count + 2);
+        to->children[0] = from->children[from->count];
+        replaceKey(parent->key(i - 1), from->key(from->count - 1));
+        from->key(from->count - 1).~Key();
+      }
+      left->count--;
+      child->count++;
+    }
+    else if (right != NULL && right->count > minimum) {
+      if (child->leaf) {
+        Leaf* to = static_cast<Leaf*>(child);
+        Leaf* from = static_cast<Leaf*>(right);
+        new (&to->item(to->count)) Item(std::move(from->item(0)));
+        eraseAt(items(from), from->count, 0);
+        replaceKey(parent->key(i), from->item(0).first);
+      }
+      else {
+        Inner* to = static_cast<Inner*>(child);
+        Inner* from = static_cast<Inner*>(right);
+        new (&to->key(to->count)) Key(std::move(parent->key(i)));
+        to->children[to->count + 1] = from->children[0];
+        replaceKey(parent->key(i), from->key(0));
+        eraseAt(keys(from), from->count, 0);
+        std::copy(from->children + 1, from->children + from->count + 1, from->children);
+      }
+      right->count--;
+      child->count++;
+    }
+    else {
+      merge(parent, left != NULL ? i - 1 : i);
+    }
+}
+
+/**
+* Merges child i + 1 of parent into child i, pulling down the separator
+* between them if they are inner nodes, and drops it from parent.
+*/
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+void BPlusTree<Key, Value, Compare, NodeBytes>::merge(Inner* parent, std::size_t i)
+{
+    Node* left = parent->children[i];
+    Node* right = parent->children[i + 1];
+    if (left->leaf) {
+      Leaf* to = static_cast<Leaf*>(left);
+      Leaf* from = static_cast<Leaf*>(right);
+      moveTo(items(from), items(to) + to->count, from->count);
+      to->count += from->count;
+      to->next = from->next;
+      if (from->next != NULL) {
+        from->next->prev = to;
+      }
+      delete from;
+    }
+    else {
+      Inner* to = static_cast<Inner*>(left);
+      Inner* from = static_cast<Inner*>(right);
+      new (&to->key(to->count)) Key(std::move(parent->key(i)));
+      moveTo(keys(from), keys(to) + to->count + 1, from->count);
+      std::copy(from->children, from->children + from->count + 1, to->children + to->count + 1);
+      to->count += from->count + 1;
+      delete from;
+    }
+    eraseAt(keys(parent), parent->count, i);
+    std::copy(parent->children + i + 2, parent->children + parent->count + 1, parent->children + i + 1);
+    parent->count--;
+}
+
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+void BPlusTree<Key, Value, Compare, NodeBytes>::clear()
+{
+    if (root_ != NULL) {
+      destroy(root_);
+    }
+    root_ = first_ = NULL;
+    size_ = 0;
+    height_ = 0;
+}
+
+/**
+* Frees the subtree of n. The recursion is only as deep as the tree.
+*/
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+void BPlusTree<Key, Value, Compare, NodeBytes>::destroy(Node* n)
+{
+    if (n->leaf) {
+      Leaf* leaf = static_cast<Leaf*>(n);
+      for (std::size_t i = 0; i < leaf->count; i++) {
+        leaf->item(i).~Item();
+      }
+      delete leaf;
+      return;
+    }
+    Inner* inner = static_cast<Inner*>(n);
+    for (std::size_t i = 0; i <= inner->count; i++) {
+      destroy(inner->children[i]);
+    }
+    for (std::size_t i = 0; i < inner->count; i++) {
+      inner->key(i).~Key();
+    }
+    delete inner;
+}
+
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+typename BPlusTree<Key, Value, Compare, NodeBytes>::iterator
+BPlusTree<Key, Value, Compare, NodeBytes>::find(const Key& key) const
+{
+    Node* n = root_;
+    if (n == NULL) {
+      return end();
+    }
+    while (!n->leaf) {
+      Inner* inner = static_cast<Inner*>(n);
+      n = inner->children[childIndex(inner, key)];
+    }
+    Leaf* leaf = static_cast<Leaf*>(n);
+    std::size_t pos = itemIndex(leaf, key);
+    if (pos == leaf->count || comp_(key, leaf->item(pos).first)) {
+      return end();
+    }
+    return iterator(this, leaf, pos);
+}
+
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+typename BPlusTree<Key, Value, Compare, NodeBytes>::iterator
+BPlusTree<Key, Value, Compare, NodeBytes>::begin() const
+{
+    return iterator(this, size_ == 0 ? NULL : first_, 0);
+}
+
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+typename BPlusTree<Key, Value, Compare, NodeBytes>::iterator
+BPlusTree<Key, Value, Compare, NodeBytes>::end() const
+{
+    return iterator(this, NULL, 0);
+}
+
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+typename BPlusTree<Key, Value, Compare, NodeBytes>::Leaf*
+BPlusTree<Key, Value, Compare, NodeBytes>::lastLeaf() const
+{
+    Node* n = root_;
+    while (!n->leaf) {
+      Inner* inner = static_cast<Inner*>(n);
+      n = inner->children[inner->count];
+    }
+    return static_cast<Leaf*>(n);
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+Value& BPlusTree<Key, Value, Compare, NodeBytes>::operator[](const Key& key)
+{
+    iterator it = find(key);
+    if(it == end()) throw std::out_of_range("Invalid key");
+    return it->second;
+}
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+Value const & BPlusTree<Key, Value, Compare, NodeBytes>::operator[](const Key& key) const
+{
+    iterator it = find(key);
+    if(it == end()) throw std::out_of_range("Invalid key");
+    return it->second;
+}
+
+/**
+* Returns true iff all leaves are at the same depth, every node but the
+* root is at least half full, keys are in order within the separators
+* above them, and the leaf list holds exactly the items of the tree.
+*/
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+bool BPlusTree<Key, Value, Compare, NodeBytes>::isBalanced() const
+{
+    if (root_ == NULL) {
+      return size_ == 0 && first_ == NULL && height_ == 0;
+    }
+    int leafDepth = -1;
+    std::size_t count = 0;
+    if (!checkNode(root_, NULL, NULL, 1, leafDepth, count) || count != size_ || leafDepth != height_) {
+      return false;
+    }
+    std::size_t listed = 0;
+    Leaf* prev = NULL;
+    for (Leaf* leaf = first_; leaf != NULL; leaf = leaf->next) {
+      if (leaf->prev != prev) {
+        return false;
+      }
+      listed += leaf->count;
+      prev = leaf;
+    }
+    return listed == size_ && prev == lastLeaf();
+}
+
+template<class Key, class Value, class Compare, std::size_t NodeBytes>
+bool BPlusTree<Key, Value, Compare, NodeBytes>::checkNode(Node* n, const Key* lower, const Key* upper, int depth,
+                                                          int& leafDepth, std::size_t& items) const
+{
+    bool isRoot = n == root_;
+    if (n->leaf) {
+      Leaf* leaf = static_cast<Leaf*>(n);
+      if ((!isRoot && leaf->count < kMinLeaf) || leaf->count == 0 || (leafDepth != -1 && leafDepth != depth)) {
+        return false;
+      }
+      leafDepth = depth;
+      for (std::size_t i = 0; i < leaf->count; i++) {
+        const Key& key = leaf->item(i).first;
+        if ((i > 0 && !comp_(leaf->item(i - 1).first, key)) || (lower != NULL && comp_(key, *lower))
+            || (upper != NULL && !comp_(key, *upper))) {
+          return false;
+        }
+      }
+      items += leaf->count;
+      return true;
+    }
+    Inner* inner = static_cast<Inner*>(n);
+    if ((!isRoot && inner->count < kMinInner) || inner->count == 0) {
+      return false;
+    }
+    for (std::size_t i = 0; i <= inner->count; i++) {
+      const Key* below = i == 0 ? lower : &inner->key(i - 1);
+      const Key* above = i == inner->count ? upper : &inner->key(i);
+      if (below != NULL && above != NULL && !comp_(*below, *above)) {
+        return false;
+      }
+      if (!checkNode(inner->children[i], below, above, depth + 1, leafDepth, items)) {
+        return false;
+      }
+    }
+    return true;
+}
+
+/*
+--------------------------------------------
+End implementations for the BPlusTree class.
+--------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,64 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <thread>
+#include <cstdint>
+#include <cstdlib>
+#include "bst.h"
+#include "avlbst.h"
+
+using namespace std;
+
+// Builds an AVL tree from unsorted pairs (about one key in ten repeated)
+// with an insert() loop and with the parallel assignUnsorted(). The
+// latter forks across hardware threads, so run this on a multi-core
+// machine to see it scale.
+
+typedef chrono::steady_clock Clock;
+typedef AVLTree<uint64_t, uint64_t> Tree;
+
+static double msSince(Clock::time_point start)
+{
+    return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n = 5000000;
+    if (argc > 1) n = strtoul(argv[1], NULL, 10);
+
+    mt19937_64 rng(104);
+    vector<pair<uint64_t, uint64_t> > items(n);
+    for (size_t i = 0; i < n; i++) {
+      items[i] = make_pair(rng() % (n - n / 10), i);
+    }
+
+    cout << "hardware threads: " << thread::hardware_concurrency() << endl;
+    cout << setw(16) << "build" << setw(12) << "n" << setw(12) << "ms" << setw(12) << "items" << endl;
+    {
+      Tree tree;
+      Clock::time_point start = Clock::now();
+      for (size_t i = 0; i < n; i++) {
+        tree.insert(items[i]);
+      }
+      double ms = msSince(start);
+      cout << setw(16) << "insert loop" << setw(12) << n << setw(12) << fixed << setprecision(1) << ms
+           << setw(12) << tree.size() << endl;
+    }
+    {
+      Tree tree;
+      Clock::time_point start = Clock::now();
+      tree.assignUnsorted(items);
+      double ms = msSince(start);
+      if (!tree.isBalanced()) {
+        cout << "assignUnsorted built an unbalanced tree!" << endl;
+        return 1;
+      }
+      cout << setw(16) << "assignUnsorted" << setw(12) << n << setw(12) << ms
+           << setw(12) << tree.size() << endl;
+    }
+    return 0;
+}
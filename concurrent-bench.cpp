@@ -0,0 +1,153 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include "bst.h"
+#include "avlbst.h"
+#include "concurrentavl.h"
+
+using namespace std;
+
+// Throughput of a ConcurrentAVLTree against an AVLTree behind one mutex,
+// for 1 to 64 threads running a read-heavy mix (95% lookups) and a mixed
+// one (50% lookups, 25% inserts, 25% removes) on uniformly random keys.
+// Half of the key range is present at any time. Lookups only scale with
+// real cores, so run this on a multi-core machine.
+
+typedef chrono::steady_clock Clock;
+
+// the baseline: every operation takes the same lock
+class LockedAVLTree
+{
+public:
+    void insert(const pair<const uint64_t, uint64_t>& item)
+    {
+      lock_guard<mutex> lock(lock_);
+      tree_.insert(item);
+    }
+    void remove(uint64_t key)
+    {
+      lock_guard<mutex> lock(lock_);
+      tree_.remove(key);
+    }
+    bool find(uint64_t key, uint64_t& value)
+    {
+      lock_guard<mutex> lock(lock_);
+      AVLTree<uint64_t, uint64_t>::iterator it = tree_.find(key);
+      if (it == tree_.end()) return false;
+      value = it->second;
+      return true;
+    }
+
+private:
+    mutex lock_;
+    AVLTree<uint64_t, uint64_t> tree_;
+};
+
+// Runs threads workers for about ms milliseconds and returns the
+// operations per microsecond. readPercent of the operations are
+// lookups, the rest alternate between inserts and removes. The number
+// of successful lookups is added to hits.
+template<typename Tree>
+double run(Tree& tree, uint64_t range, int threads, int readPercent, int ms, uint64_t& hits)
+{
+    atomic<bool> go(false), stop(false);
+    // padded so that the counters of different threads do not share a cache line
+    vector<uint64_t> done(threads * 8, 0), found(threads * 8, 0);
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++) {
+      workers.push_back(thread([&, t]() {
+        mt19937_64 rng(t + 1);
+        uint64_t ops = 0, hit = 0, value = 0;
+        while (!go.load()) { }
+        while (!stop.load(memory_order_relaxed)) {
+          for (int i = 0; i < 64; i++) {
+            uint64_t key = rng() % range;
+            int dice = int(rng() % 100);
+            if (dice < readPercent) {
+              hit += tree.find(key, value) ? 1 : 0;
+            } else if (dice % 2) {
+              tree.insert(make_pair(key, key));
+            } else {
+              tree.remove(key);
+            }
+          }
+          ops += 64;
+        }
+        done[t * 8] = ops;
+        found[t * 8] = hit;
+      }));
+    }
+    Clock::time_point start = Clock::now();
+    go.store(true);
+    this_thread::sleep_for(chrono::milliseconds(ms));
+    stop.store(true);
+    for (int t = 0; t < threads; t++) {
+      workers[t].join();
+    }
+    double us = chrono::duration<double, micro>(Clock::now() - start).count();
+    uint64_t total = 0;
+    for (int t = 0; t < threads; t++) {
+      total += done[t * 8];
+      hits += found[t * 8];
+    }
+    return total / us;
+}
+
+template<typename Tree>
+void fill(Tree& tree, uint64_t range)
+{
+    mt19937_64 rng(104);
+    for (uint64_t i = 0; i < range / 2; i++) {
+      uint64_t key = rng() % range;
+      tree.insert(make_pair(key, key));
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    uint64_t n = 1000000;
+    int ms = 200;
+    if (argc > 1) n = strtoul(argv[1], NULL, 10);
+    if (argc > 2) ms = atoi(argv[2]);
+    uint64_t range = 2 * n;
+
+    const int threadCounts[] = { 1, 2, 4, 8, 16, 32, 64 };
+    const int mixes[] = { 95, 50 };
+    const char* mixNames[] = { "read-heavy", "mixed" };
+
+    uint64_t hits = 0;
+    cout << "hardware threads: " << thread::hardware_concurrency() << endl;
+    cout << setw(12) << "workload" << setw(9) << "threads" << setw(16) << "locked Mops/s"
+         << setw(20) << "concurrent Mops/s" << setw(10) << "speedup" << endl;
+    for (int m = 0; m < 2; m++) {
+      for (int c = 0; c < 7; c++) {
+        int threads = threadCounts[c];
+        double locked, concurrent;
+        {
+          LockedAVLTree tree;
+          fill(tree, range);
+          locked = run(tree, range, threads, mixes[m], ms, hits);
+        }
+        {
+          ConcurrentAVLTree<uint64_t, uint64_t> tree;
+          fill(tree, range);
+          concurrent = run(tree, range, threads, mixes[m], ms, hits);
+          if (!tree.isBalanced()) {
+            cout << "ConcurrentAVLTree is not balanced!" << endl;
+            return 1;
+          }
+        }
+        cout << setw(12) << mixNames[m] << setw(9) << threads << setw(16) << fixed << setprecision(2) << locked
+             << setw(20) << concurrent << setw(10) << concurrent / locked << endl;
+      }
+    }
+    cout << "(checksum " << hits << ")" << endl;
+    return 0;
+}
@@ -0,0 +1,780 @@
+#ifndef CONCURRENTAVL_H
+#define CONCURRENTAVL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+#include "nodepool.h"
+#include "keycompare.h"
+#include "graceperiod.h"
+
+/**
+* An AVL tree that any number of threads may use at once. Lookups take
+* no locks: they walk down optimistically and check a version number on
+* each node they pass, so they run in parallel with each other and with
+* updates to other parts of the tree, and only start over when a writer
+* changed a node on their own path while they were on it.
+*
+* Updates are serialized by a mutex and do the same insertion, removal
+* and rotations as AVLTree. Every node whose links an update changes, or
+* whose subtree loses a key, has its version made odd for the duration
+* and raised past the old value afterwards, the way a seqlock guards its
+* data. An item never changes once its node is linked in; overwriting a
+* value links a fresh node in its place instead.
+*
+* A node that was unlinked may still be under a lookup, so it is only
+* handed back to the pool after a grace period, once every lookup that
+* started before the unlink has finished. Unlinked nodes are collected
+* and reclaimed kRetireBatch at a time to keep grace periods rare (see
+* GracePeriod).
+*
+* There are no iterators, since nothing would keep their nodes alive.
+*/
+template <typename Key, typename Value, typename Compare = std::less<Key> >
+class ConcurrentAVLTree
+{
+public:
+    ConcurrentAVLTree();
+    explicit ConcurrentAVLTree(const Compare& comp);
+    ~ConcurrentAVLTree();
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    bool find(const Key& key, Value& value) const;
+    bool contains(const Key& key) const;
+    bool isBalanced() const;
+    bool empty() const;
+    std::size_t size() const;
+
+protected:
+    struct ConcurrentNode;
+
+    /**
+    * The part of a node that lookups follow. The root hangs off the right
+    * link of holder_, which has no item, so replacing the root is guarded
+    * like any other change of a link.
+    */
+    struct Links
+    {
+        Links() : left(NULL), right(NULL), version(0) { }
+        std::atomic<ConcurrentNode*> left;
+        std::atomic<ConcurrentNode*> right;
+        // odd while a writer is changing the node
+        std::atomic<unsigned> version;
+    };
+
+    struct ConcurrentNode : Links
+    {
+        ConcurrentNode(const std::pair<const Key, Value>& keyValuePair, ConcurrentNode* parent) :
+            item(keyValuePair), parent(parent), balance(0) { }
+        const std::pair<const Key, Value> item;
+        // only writers use these, under writeLock_
+        ConcurrentNode* parent;
+        int8_t balance;
+    };
+
+    // unlinked nodes wait for a grace period until this many have piled up
+    static const std::size_t kRetireBatch = 256;
+
+    enum FindResult { kFound, kMissing, kRetry };
+
+    FindResult tryFind(const Key& key, Value* value) const;
+    int compareKeys(const Key& a, const Key& b) const;
+    int compareKeys(const Key& a, const Key& b, std::true_type threeWay) const;
+    int compareKeys(const Key& a, const Key& b, std::false_type threeWay) const;
+
+    static ConcurrentNode* leftOf(const Links* n);
+    static ConcurrentNode* rightOf(const Links* n);
+    static void beginChange(Links* n);
+    static void endChange(Links* n);
+    Links* linksOf(ConcurrentNode* parent);
+    void replaceChild(ConcurrentNode* parent, ConcurrentNode* old, ConcurrentNode* now);
+
+    ConcurrentNode* findNode(const Key& key) const;
+    ConcurrentNode* createNode(const std::pair<const Key, Value>& keyValuePair, ConcurrentNode* parent);
+    void destroyNode(ConcurrentNode* n);
+    void destroySubtree(ConcurrentNode* n);
+    void retire(ConcurrentNode* n);
+    void retireSubtree(ConcurrentNode* n);
+    void reclaim();
+    void replaceNode(ConcurrentNode* old, const std::pair<const Key, Value>& keyValuePair);
+    void rotateLeft(ConcurrentNode* n);
+    void rotateRight(ConcurrentNode* n);
+    void addUpdate(ConcurrentNode* parent, ConcurrentNode* n);
+    void removeUpdate(ConcurrentNode* parent, int diff);
+    int balancedHeight(const ConcurrentNode* n) const;
+
+    Links holder_;
+    std::atomic<std::size_t> size_;
+    mutable GracePeriod readers_;
+    mutable std::mutex writeLock_;
+    // unlinked nodes waiting for a grace period
+    std::vector<ConcurrentNode*> retired_;
+    // scratch for remove(), the path that a predecessor is taken from
+    std::vector<ConcurrentNode*> changing_;
+    NodePool pool_;
+    Compare comp_;
+
+private:
+    ConcurrentAVLTree(const ConcurrentAVLTree&);
+    ConcurrentAVLTree& operator=(const ConcurrentAVLTree&);
+};
+
+/*
+------------------------------------------------------
+Begin implementations for the ConcurrentAVLTree class.
+------------------------------------------------------
+*/
+
+template<class Key, class Value, class Compare>
+ConcurrentAVLTree<Key, Value, Compare>::ConcurrentAVLTree() :
+    size_(0), pool_(sizeof(ConcurrentNode), alignof(ConcurrentNode)), comp_()
+{
+
+}
+
+template<class Key, class Value, class Compare>
+ConcurrentAVLTree<Key, Value, Compare>::ConcurrentAVLTree(const Compare& comp) :
+    size_(0), pool_(sizeof(ConcurrentNode), alignof(ConcurrentNode)), comp_(comp)
+{
+
+}
+
+/**
+* No other thread may be using the tree any more.
+*/
+template<class Key, class Value, class Compare>
+ConcurrentAVLTree<Key, Value, Compare>::~ConcurrentAVLTree()
+{
+    destroySubtree(rightOf(&holder_));
+    for (std::size_t i = 0; i < retired_.size(); i++) {
+      destroyNode(retired_[i]);
+    }
+}
+
+template<class Key, class Value, class Compare>
+bool ConcurrentAVLTree<Key, Value, Compare>::empty() const
+{
+    return holder_.right.load(std::memory_order_acquire) == NULL;
+}
+
+template<class Key, class Value, class Compare>
+std::size_t ConcurrentAVLTree<Key, Value, Compare>::size() const
+{
+    return size_.load(std::memory_order_relaxed);
+}
+
+/**
+* Looks key up and copies its value into value. Safe to call at any
+* time from any thread.
+*/
+template<class Key, class Value, class Compare>
+bool ConcurrentAVLTree<Key, Value, Compare>::find(const Key& key, Value& value) const
+{
+    GracePeriod::Reader reading(readers_);
+    FindResult result;
+    do {
+      result = tryFind(key, &value);
+    } while (result == kRetry);
+    return result == kFound;
+}
+
+template<class Key, class Value, class Compare>
+bool ConcurrentAVLTree<Key, Value, Compare>::contains(const Key& key) const
+{
+    GracePeriod::Reader reading(readers_);
+    FindResult result;
+    do {
+      result = tryFind(key, NULL);
+    } while (result == kRetry);
+    return result == kFound;
+}
+
+/**
+* One optimistic descent from the root. Before moving to a child the
+* child's version is read and the current node's version checked again:
+* if it is unchanged, the child was linked below a node whose subtree
+* still held the key (if present) when the version was read. Rotations
+* only ever move keys out of the subtree of a node they change, so the
+* same then holds for the child. Any doubt returns kRetry.
+*/
+template<class Key, class Value, class Compare>
+typename ConcurrentAVLTree<Key, Value, Compare>::FindResult
+ConcurrentAVLTree<Key, Value, Compare>::tryFind(const Key& key, Value* value) const
+{
+    const Links* at = &holder_;
+    unsigned version = holder_.version.load(std::memory_order_acquire);
+    if (version & 1) {
+      return kRetry;
+    }
+    ConcurrentNode* next = holder_.right.load(std::memory_order_acquire);
+    while (true) {
+      if (next == NULL) {
+        return at->version.load(std::memory_order_acquire) == version ? kMissing : kRetry;
+      }
+      unsigned nextVersion = next->version.load(std::memory_order_acquire);
+      if ((nextVersion & 1) || at->version.load(std::memory_order_acquire) != version) {
+        return kRetry;
+      }
+      int cmp = compareKeys(key, next->item.first);
+      if (cmp == 0) {
+        if (value != NULL) {
+          *value = next->item.second;
+        }
+        return kFound;
+      }
+      at = next;
+      version = nextVersion;
+      next = cmp < 0 ? next->left.load(std::memory_order_acquire) : next->right.load(std::memory_order_acquire);
+    }
+}
+
+template<class Key, class Value, class Compare>
+int ConcurrentAVLTree<Key, Value, Compare>::compareKeys(const Key& a, const Key& b) const
+{
+    return compareKeys(a, b, typename ThreeWayCompare<Compare, Key, Key>::Available());
+}
+
+template<class Key, class Value, class Compare>
+int ConcurrentAVLTree<Key, Value, Compare>::compareKeys(const Key& a, const Key& b, std::true_type) const
+{
+    return ThreeWayCompare<Compare, Key, Key>::compare(comp_, a, b);
+}
+
+/**
+* Without a three-way comparison this takes two comp_ calls when a is
+* not less than b. The candidate trick of BinarySearchTree::findNode does
+* not fit a descent that has to know where the key is at every step.
+*/
+template<class Key, class Value, class Compare>
+int ConcurrentAVLTree<Key, Value, Compare>::compareKeys(const Key& a, const Key& b, std::false_type) const
+{
+    if (comp_(a, b)) {
+      return -1;
+    }
+    return comp_(b, a) ? 1 : 0;
+}
+
+/**
+* Plain loads of the links, for writers (which hold writeLock_).
+*/
+template<class Key, class Value, class Compare>
+typename ConcurrentAVLTree<Key, Value, Compare>::ConcurrentNode*
+ConcurrentAVLTree<Key, Value, Compare>::leftOf(const Links* n)
+{
+    return n->left.load(std::memory_order_relaxed);
+}
+
+template<class Key, class Value, class Compare>
+typename ConcurrentAVLTree<Key, Value, Compare>::ConcurrentNode*
+ConcurrentAVLTree<Key, Value, Compare>::rightOf(const Links* n)
+{
+    return n->right.load(std::memory_order_relaxed);
+}
+
+/**
+* Makes n's version odd before its links are changed. Links are only
+* ever stored with release order, so a lookup that sees a new link also
+* sees the odd version (or a later one).
+*/
+template<class Key, class Value, class Compare>
+void ConcurrentAVLTree<Key, Value, Compare>::beginChange(Links* n)
+{
+    n->version.store(n->version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+template<class Key, class Value, class Compare>
+void ConcurrentAVLTree<Key, Value, Compare>::endChange(Links* n)
+{
+    n->version.store(n->version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+/**
+* Returns the links that parent's children hang off, which for the root
+* are those of holder_.
+*/
+template<class Key, class Value, class Compare>
+typename ConcurrentAVLTree<Key, Value, Compare>::Links*
+ConcurrentAVLTree<Key, Value, Compare>::linksOf(ConcurrentNode* parent)
+{
+    if (parent == NULL) {
+      return &holder_;
+    }
+    return parent;
+}
+
+/**
+* Points the link of parent that leads to old at now instead. The caller
+* has begun a change of linksOf(parent).
+*/
+template<class Key, class Value, class Compare>
+void ConcurrentAVLTree<Key, Value, Compare>::replaceChild(ConcurrentNode* parent, ConcurrentNode* old, ConcurrentNode* now)
+{
+    Links* above = linksOf(parent);
+    if (parent != NULL && leftOf(parent) == old) {
+      above->left.store(now, std::memory_order_release);
+    } else {
+      above->right.store(now, std::memory_order_release);
+    }
+}
+
+template<class Key, class Value, class Compare>
+typename ConcurrentAVLTree<Key, Value, Compare>::ConcurrentNode*
+ConcurrentAVLTree<Key, Value, Compare>::findNode(const Key& key) const
+{
+    ConcurrentNode* current = rightOf(&holder_);
+    while (current != NULL) {
+      int cmp = compareKeys(key, current->item.first);
+      if (cmp == 0) {
+        return current;
+      }
+      current = cmp < 0 ? leftOf(current) : rightOf(current);
+    }
+    return NULL;
+}
+
+template<class Key, class Value, class Compare>
+typename ConcurrentAVLTree<Key, Value, Compare>::ConcurrentNode*
+ConcurrentAVLTree<Key, Value, Compare>::createNode(const std::pair<const Key, Value>& keyValuePair, ConcurrentNode* parent)
+{
+    void* slot = pool_.allocate();
+    try {
+      return new (slot) ConcurrentNode(keyValuePair, parent);
+    } catch (...) {
+      pool_.deallocate(slot);
+      throw;
+    }
+}
+
+template<class Key, class Value, class Compare>
+void ConcurrentAVLTree<Key, Value, Compare>::destroyNode(ConcurrentNode* n)
+{
+    n->~ConcurrentNode();
+    pool_.deallocate(n);
+}
+
+template<class Key, class Value, class Compare>
+void ConcurrentAVLTree<Key, Value, Compare>::destroySubtree(ConcurrentNode* n)
+{
+    if (n == NULL) {
+      return;
+    }
+    destroySubtree(leftOf(n));
+    destroySubtree(rightOf(n));
+    destroyNode(n);
+}
+
+/**
+* Hands an unlinked node over for reclaiming after a grace period.
+*/
+template<class Key, class Value, class Compare>
+void ConcurrentAVLTree<Key, Value, Compare>::retire(ConcurrentNode* n)
+{
+    retired_.push_back(n);
+    if (retired_.size() >= kRetireBatch) {
+      reclaim();
+    }
+}
+
+template<class Key, class Value, class Compare>
+void ConcurrentAVLTree<Key, Value, Compare>::retireSubtree(ConcurrentNode* n)
+{
+    if (n == NULL) {
+      return;
+    }
+    retireSubtree(leftOf(n));
+    retireSubtree(rightOf(n));
+    retired_.push_back(n);
+}
+
+/**
+* Frees every retired node once no lookup can be looking at it.
+*/
+template<class Key, class Value, class Compare>
+void ConcurrentAVLTree<Key, Value, Compare>::reclaim()
+{
+    readers_.synchronize();
+    for (std::size_t i = 0; i < retired_.size(); i++) {
+      destroyNode(retired_[i]);
+    }
+    retired_.clear();
+}
+
+/**
+* Removes everything. Lookups running meanwhile see either the old tree
+* or an empty one.
+*/
+template<class Key, class Value, class Compare>
+void ConcurrentAVLTree<Key, Value, Compare>::clear()
+{
+    std::lock_guard<std::mutex> lock(writeLock_);
+    ConcurrentNode* root = rightOf(&holder_);
+    beginChange(&holder_);
+    holder_.right.store(NULL, std::memory_order_release);
+    endChange(&holder_);
+    size_.store(0, std::memory_order_relaxed);
+    retireSubtree(root);
+    reclaim();
+}
+
+/**
+* Same as AVLTree::insert: walk down, link a new leaf, then retrace.
+* An existing key gets a new node with the new value in its place.
+*/
+template<class Key, class Value, class Compare>
+void ConcurrentAVLTree<Key, Value, Compare>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    std::lock_guard<std::mutex> lock(writeLock_);
+    ConcurrentNode* parent = NULL;
+    ConcurrentNode* child = rightOf(&holder_);
+    bool left = false;
+    while (child != NULL) {
+      int cmp = compareKeys(keyValuePair.first, child->item.first);
+      if (cmp == 0) {
+        replaceNode(child, keyValuePair);
+        return;
+      }
+      parent = child;
+      left = cmp < 0;
+      child = left ? leftOf(child) : rightOf(child);
+    }
+    ConcurrentNode* added = createNode(keyValuePair, parent);
+    Links* above = linksOf(parent);
+    beginChange(above);
+    if (left) {
+      above->left.store(added, std::memory_order_release);
+    } else {
+      above->right.store(added, std::memory_order_release);
+    }
+    endChange(above);
+    size_.store(size_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (parent != NULL) {
+      addUpdate(parent, added);
+    }
+}
+
+/**
+* Links a copy of old with a new item in place of old.
+*/
+template<class Key, class Value, class Compare>
+void ConcurrentAVLTree<Key, Value, Compare>::replaceNode(ConcurrentNode* old, const std::pair<const Key, Value>& keyValuePair)
+{
+    ConcurrentNode* fresh = createNode(keyValuePair, old->parent);
+    ConcurrentNode* left = leftOf(old);
+    ConcurrentNode* right = rightOf(old);
+    // published by the release store in replaceChild()
+    fresh->left.store(left, std::memory_order_relaxed);
+    fresh->right.store(right, std::memory_order_relaxed);
+    fresh->balance = old->balance;
+
+    Links* above = linksOf(old->parent);
+    beginChange(above);
+    beginChange(old);
+    replaceChild(old->parent, old, fresh);
+    endChange(old);
+    endChange(above);
+    if (left != NULL) {
+      left->parent = fresh;
+    }
+    if (right != NULL) {
+      right->parent = fresh;
+    }
+    retire(old);
+}
+
+/**
+* Same as AVLTree::remove, except that a node with two children is not
+* swapped with its predecessor but replaced by it, since keys cannot
+* change. The predecessor's key leaves the subtree of every node on the
+* way down to it, so all of those count as changed too.
+*/
+template<class Key, class Value, class Compare>
+void ConcurrentAVLTree<Key, Value, Compare>::remove(const Key& key)
+{
+    std::lock_guard<std::mutex> lock(writeLock_);
+    ConcurrentNode* removed = findNode(key);
+    if (removed == NULL) {
+      return;
+    }
+    ConcurrentNode* parent = removed->parent;
+    ConcurrentNode* left = leftOf(removed);
+    ConcurrentNode* right = rightOf(removed);
+    Links* above = linksOf(parent);
+    ConcurrentNode* retraceFrom;
+    int diff;
+
+    beginChange(above);
+    beginChange(removed);
+    if (left != NULL && right != NULL) {
+      changing_.clear();
+      ConcurrentNode* predec = left;
+      beginChange(predec);
+      changing_.push_back(predec);
+      while (rightOf(predec) != NULL) {
+        predec = rightOf(predec);
+        beginChange(predec);
+        changing_.push_back(predec);
+      }
+      ConcurrentNode* predecParent = predec->parent;
+      ConcurrentNode* predecLeft = leftOf(predec);
+      if (predecParent == removed) {
+        retraceFrom = predec;
+        diff = -1;
+      } else {
+        predecParent->right.store(predecLeft, std::memory_order_release);
+        predec->left.store(left, std::memory_order_release);
+        retraceFrom = predecParent;
+        diff = 1;
+      }
+      predec->right.store(right, std::memory_order_release);
+      replaceChild(parent, removed, predec);
+      for (std::size_t i = changing_.size(); i-- > 0; ) {
+        endChange(changing_[i]);
+      }
+      endChange(removed);
+      endChange(above);
+
+      if (predecParent != removed) {
+        if (predecLeft != NULL) {
+          predecLeft->parent = predecParent;
+        }
+        left->parent = predec;
+      }
+      right->parent = predec;
+      predec->parent = parent;
+      predec->balance = removed->balance;
+    } else {
+      ConcurrentNode* child = left != NULL ? left : right;
+      diff = 0;
+      if (parent != NULL) {
+        diff = leftOf(parent) == removed ? -1 : 1;
+      }
+      replaceChild(parent, removed, child);
+      endChange(removed);
+      endChange(above);
+      if (child != NULL) {
+        child->parent = parent;
+      }
+      retraceFrom = parent;
+    }
+    size_.store(size_.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+    retire(removed);
+    if (retraceFrom != NULL) {
+      removeUpdate(retraceFrom, diff);
+    }
+}
+
+/**
+* AVLTree::rotateLeft with every node whose links change versioned.
+* n loses keys to newhead, the others only get a new child.
+*/
+template<class Key, class Value, class Compare>
+void ConcurrentAVLTree<Key, Value, Compare>::rotateLeft(ConcurrentNode* n)
+{
+    ConcurrentNode* newhead = rightOf(n);
+    ConcurrentNode* initialSubtree = leftOf(newhead);
+    ConcurrentNode* parent = n->parent;
+    Links* above = linksOf(parent);
+
+    beginChange(above);
+    beginChange(n);
+    beginChange(newhead);
+    replaceChild(parent, n, newhead);
+    newhead->left.store(n, std::memory_order_release);
+    n->right.store(initialSubtree, std::memory_order_release);
+    endChange(newhead);
+    endChange(n);
+    endChange(above);
+
+    newhead->parent = parent;
+    n->parent = newhead;
+    if (initialSubtree != NULL) {
+      initialSubtree->parent = n;
+    }
+}
+
+template<class Key, class Value, class Compare>
+void ConcurrentAVLTree<Key, Value, Compare>::rotateRight(ConcurrentNode* n)
+{
+    ConcurrentNode* newhead = leftOf(n);
+    ConcurrentNode* initialSubtree = rightOf(newhead);
+    ConcurrentNode* parent = n->parent;
+    Links* above = linksOf(parent);
+
+    beginChange(above);
+    beginChange(n);
+    beginChange(newhead);
+    replaceChild(parent, n, newhead);
+    newhead->right.store(n, std::memory_order_release);
+    n->left.store(initialSubtree, std::memory_order_release);
+    endChange(newhead);
+    endChange(n);
+    endChange(above);
+
+    newhead->parent = parent;
+    n->parent = newhead;
+    if (initialSubtree != NULL) {
+      initialSubtree->parent = n;
+    }
+}
+
+/**
+* Retraces after inserting n below parent; see AVLTree::addUpdate.
+*/
+template<class Key, class Value, class Compare>
+void ConcurrentAVLTree<Key, Value, Compare>::addUpdate(ConcurrentNode* parent, ConcurrentNode* n)
+{
+    while (parent != NULL) {
+      parent->balance += (leftOf(parent) == n) ? 1 : -1;
+      if (parent->balance == 0) {
+        return;
+      }
+      if (parent->balance == 1 || parent->balance == -1) {
+        n = parent;
+        parent = parent->parent;
+        continue;
+      }
+      if (parent->balance == 2 && n->balance == -1) {
+        // left right
+        ConcurrentNode* gchild = rightOf(n);
+        int gchildbf = gchild->balance;
+        rotateLeft(n);
+        rotateRight(parent);
+        n->balance = gchildbf == -1 ? 1 : 0;
+        parent->balance = gchildbf == 1 ? -1 : 0;
+        gchild->balance = 0;
+      } else if (parent->balance == -2 && n->balance == 1) {
+        // right left
+        ConcurrentNode* gchild = leftOf(n);
+        int gchildbf = gchild->balance;
+        rotateRight(n);
+        rotateLeft(parent);
+        n->balance = gchildbf == 1 ? -1 : 0;
+        parent->balance = gchildbf == -1 ? 1 : 0;
+        gchild->balance = 0;
+      } else if (parent->balance == 2) {
+        // left left
+        rotateRight(parent);
+        parent->balance = 0;
+        n->balance = 0;
+      } else {
+        // right right
+        rotateLeft(parent);
+        parent->balance = 0;
+        n->balance = 0;
+      }
+      return;
+    }
+}
+
+/**
+* Retraces after a removal; diff is -1 if parent lost height on the
+* left and 1 if on the right. See AVLTree::removeUpdate.
+*/
+template<class Key, class Value, class Compare>
+void ConcurrentAVLTree<Key, Value, Compare>::removeUpdate(ConcurrentNode* parent, int diff)
+{
+    while (parent != NULL) {
+      parent->balance += diff;
+
+      ConcurrentNode* gparent = parent->parent;
+      int ndiff = 0;
+      if (gparent != NULL) {
+        ndiff = rightOf(gparent) == parent ? 1 : -1;
+      }
+
+      if (parent->balance == 1 || parent->balance == -1) {
+        return;
+      }
+      if (parent->balance == 2) {
+        ConcurrentNode* child = leftOf(parent);
+        int childBalance = child->balance;
+        if (childBalance == -1) {
+          // left right
+          ConcurrentNode* gchild = rightOf(child);
+          int gchildbf = gchild->balance;
+          rotateLeft(child);
+          rotateRight(parent);
+          child->balance = gchildbf == -1 ? 1 : 0;
+          parent->balance = gchildbf == 1 ? -1 : 0;
+          gchild->balance = 0;
+        } else {
+          // left left
+          rotateRight(parent);
+          if (childBalance == 0) {
+            parent->balance = 1;
+            child->balance = -1;
+            return;
+          }
+          parent->balance = 0;
+          child->balance = 0;
+        }
+      } else if (parent->balance == -2) {
+        ConcurrentNode* child = rightOf(parent);
+        int childBalance = child->balance;
+        if (childBalance == 1) {
+          // right left
+          ConcurrentNode* gchild = leftOf(child);
+          int gchildbf = gchild->balance;
+          rotateRight(child);
+          rotateLeft(parent);
+          child->balance = gchildbf == 1 ? -1 : 0;
+          parent->balance = gchildbf == -1 ? 1 : 0;
+          gchild->balance = 0;
+        } else {
+          // right right
+          rotateLeft(parent);
+          if (childBalance == 0) {
+            parent->balance = -1;
+            child->balance = 1;
+            return;
+          }
+          parent->balance = 0;
+          child->balance = 0;
+        }
+      }
+      // the subtree got shorter, keep going up
+      parent = gparent;
+      diff = ndiff;
+    }
+}
+
+/**
+ * Return true iff the tree is balanced.
+ */
+template<class Key, class Value, class Compare>
+bool ConcurrentAVLTree<Key, Value, Compare>::isBalanced() const
+{
+    std::lock_guard<std::mutex> lock(writeLock_);
+    return balancedHeight(rightOf(&holder_)) != -1;
+}
+
+template<class Key, class Value, class Compare>
+int ConcurrentAVLTree<Key, Value, Compare>::balancedHeight(const ConcurrentNode* n) const
+{
+    if (n == NULL) {
+      return 0;
+    }
+    int leftheight = balancedHeight(leftOf(n));
+    int rightheight = balancedHeight(rightOf(n));
+    if (leftheight == -1 || rightheight == -1) {
+      return -1;
+    }
+    if (leftheight - rightheight > 1 || rightheight - leftheight > 1) {
+      return -1;
+    }
+    return 1 + (leftheight > rightheight ? leftheight : rightheight);
+}
+
+/*
+----------------------------------------------------
+End implementations for the ConcurrentAVLTree class.
+----------------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef FORKJOIN_H
+#define FORKJOIN_H
+
+#include <algorithm>
+#include <cstddef>
+#include <future>
+#include <new>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+/*
+  Fork-join helpers for the parallel divide and conquer algorithms of
+  the trees (AVLTree::unionWith() and friends), along with a parallel
+  loop and stable sort built on them for bulk loading.
+
+  A recursion forks for its first few levels only, which gives a few
+  times more tasks than there are hardware threads so that uneven
+  halves still keep every core busy. Below that, and for subtrees too
+  small to be worth a thread, it simply carries on sequentially.
+*/
+
+/**
+* The number of recursion levels that should fork: one more than it
+* takes to have a task per hardware thread.
+*/
+inline int forkDepth()
+{
+    unsigned threads = std::thread::hardware_concurrency();
+    int depth = 1;
+    while (threads > 1) {
+      threads = (threads + 1) / 2;
+      depth++;
+    }
+    return depth;
+}
+
+/**
+* Runs left() and right() and returns once both are done. If depth is
+* above zero, left() runs on a thread of its own meanwhile. Should no
+* thread be available, both simply run here.
+*/
+template<typename Left, typename Right>
+void forkJoin(int depth, Left left, Right right)
+{
+    if (depth <= 0) {
+      left();
+      right();
+      return;
+    }
+    std::future<void> forked;
+    try {
+      forked = std::async(std::launch::async, left);
+    } catch (const std::system_error&) {
+      left();
+      right();
+      return;
+    }
+    right();
+    forked.get();
+}
+
+/**
+* Calls body(lo, hi) on pieces of [first, last) that together cover it,
+* forking the first depth levels of halving, but never into pieces of
+* fewer than grain indices.
+*/
+template<typename Body>
+void parallelFor(std::size_t first, std::size_t last, std::size_t grain, int depth, const Body& body)
+{
+    if (depth <= 0 || last - first <= grain) {
+      body(first, last);
+      return;
+    }
+    std::size_t mid = first + (last - first) / 2;
+    forkJoin(depth,
+      [&]() { parallelFor(first, mid, grain, depth - 1, body); },
+      [&]() { parallelFor(mid, last, grain, depth - 1, body); });
+}
+
+// ranges shorter than this are sorted or merged on one thread
+static const std::size_t kSerialSortSize = 8192;
+
+/**
+* Merges the sorted ranges [a, aEnd) and [b, bEnd) into raw storage at
+* out, move-constructing every item there. Items of a come first among
+* equal ones. A large merge is split at the middle of the longer range
+* and a binary search in the other, and the two halves run in parallel.
+*/
+template<typename T, typename Less>
+void mergeMoving(T* a, T* aEnd, T* b, T* bEnd, T* out, const Less& less, int depth)
+{
+    if (depth <= 0 || (aEnd - a) + (bEnd - b) <= static_cast<std::ptrdiff_t>(kSerialSortSize)) {
+      while (a != aEnd && b != bEnd) {
+        if (less(*b, *a)) {
+          new (out++) T(std::move(*b++));
+        } else {
+          new (out++) T(std::move(*a++));
+        }
+      }
+      for (; a != aEnd; ++a) {
+        new (out++) T(std::move(*a));
+      }
+      for (; b != bEnd; ++b) {
+        new (out++) T(std::move(*b));
+      }
+      return;
+    }
+    T* aMid;
+    T* bMid;
+    if (aEnd - a >= bEnd - b) {
+      aMid = a + (aEnd - a) / 2;
+      bMid = std::lower_bound(b, bEnd, *aMid, less);
+    } else {
+      bMid = b + (bEnd - b) / 2;
+      aMid = std::upper_bound(a, aEnd, *bMid, less);
+    }
+    T* outMid = out + (aMid - a) + (bMid - b);
+    forkJoin(depth,
+      [&]() { mergeMoving(a, aMid, b, bMid, out, less, depth - 1); },
+      [&]() { mergeMoving(aMid, aEnd, bMid, bEnd, outMid, less, depth - 1); });
+}
+
+/**
+* Merge sort of [first, last) that uses scratch, raw storage for as many
+* items, to merge the sorted halves into before moving them back.
+*/
+template<typename T, typename Less>
+void mergeSortRange(T* first, T* last, T* scratch, const Less& less, int depth)
+{
+    std::size_t n = last - first;
+    if (depth <= 0 || n <= kSerialSortSize) {
+      std::stable_sort(first, last, less);
+      return;
+    }
+    T* mid = first + n / 2;
+    forkJoin(depth,
+      [&]() { mergeSortRange(first, mid, scratch, less, depth - 1); },
+      [&]() { mergeSortRange(mid, last, scratch + n / 2, less, depth - 1); });
+    mergeMoving(first, mid, mid, last, scratch, less, depth);
+    parallelFor(0, n, kSerialSortSize, depth, [&](std::size_t lo, std::size_t hi) {
+      for (std::size_t i = lo; i < hi; i++) {
+        first[i] = std::move(scratch[i]);
+        scratch[i].~T();
+      }
+    });
+}
+
+/**
+* Sorts [first, last) like std::stable_sort, sorting and merging the
+* halves in parallel for the first depth levels. Moving a T must not
+* throw.
+*/
+template<typename T, typename Less>
+void parallelStableSort(T* first, T* last, const Less& less, int depth)
+{
+    if (depth <= 0 || static_cast<std::size_t>(last - first) <= kSerialSortSize) {
+      std::stable_sort(first, last, less);
+      return;
+    }
+    T* scratch = static_cast<T*>(::operator new((last - first) * sizeof(T)));
+    mergeSortRange(first, last, scratch, less, depth);
+    ::operator delete(scratch);
+}
+
+#endif
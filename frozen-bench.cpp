@@ -0,0 +1,81 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <thread>
+#include <cstdint>
+#include <cstdlib>
+#include "bst.h"
+#include "avlbst.h"
+#include "frozenmap.h"
+
+using namespace std;
+
+// Looks up random present keys in an AVLTree and in a FrozenMap made
+// from it, for each tree size given on the command line (1M, 4M and 16M
+// by default), and times freezing the tree.
+
+typedef chrono::steady_clock Clock;
+typedef AVLTree<uint64_t, uint64_t> Tree;
+typedef FrozenMap<uint64_t, uint64_t> Frozen;
+
+static double msSince(Clock::time_point start)
+{
+    return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+    vector<size_t> sizes;
+    for (int i = 1; i < argc; i++) {
+      sizes.push_back(strtoul(argv[i], NULL, 10));
+    }
+    if (sizes.empty()) {
+      sizes.push_back(1000000);
+      sizes.push_back(4000000);
+      sizes.push_back(16000000);
+    }
+
+    cout << "hardware threads: " << thread::hardware_concurrency() << endl;
+    cout << setw(12) << "n" << setw(12) << "freeze ms" << setw(14) << "AVL Mfinds/s"
+         << setw(14) << "frozen Mf/s" << setw(10) << "speedup" << endl;
+    for (size_t s = 0; s < sizes.size(); s++) {
+      size_t n = sizes[s];
+      mt19937_64 rng(104);
+      vector<pair<uint64_t, uint64_t> > items(n);
+      for (size_t i = 0; i < n; i++) {
+        items[i] = make_pair(i * 2654435761u, i);
+      }
+      sort(items.begin(), items.end());
+      vector<uint64_t> probes(4000000);
+      for (size_t i = 0; i < probes.size(); i++) {
+        probes[i] = items[rng() % n].first;
+      }
+      Tree tree;
+      tree.assign(items.begin(), items.end());
+
+      uint64_t checksum = 0;
+      Clock::time_point start = Clock::now();
+      for (size_t i = 0; i < probes.size(); i++) {
+        checksum += tree.find(probes[i])->second;
+      }
+      double treeMs = msSince(start);
+
+      start = Clock::now();
+      Frozen frozen(tree);
+      double freezeMs = msSince(start);
+
+      start = Clock::now();
+      for (size_t i = 0; i < probes.size(); i++) {
+        checksum += frozen.find(probes[i])->second;
+      }
+      double frozenMs = msSince(start);
+
+      cout << setw(12) << n << fixed << setprecision(1) << setw(12) << freezeMs
+           << setw(14) << probes.size() / treeMs / 1000.0 << setw(14) << probes.size() / frozenMs / 1000.0
+           << setw(9) << treeMs / frozenMs << "x   (checksum " << checksum << ")" << endl;
+    }
+    return 0;
+}
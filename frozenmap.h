@@ -0,0 +1,387 @@
+#ifndef FROZENMAP_H
+#define FROZENMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "bst.h"
+
+/**
+* A read-only copy of a map for data that is built once and then only
+* looked up. The keys are stored in one array in Eytzinger order, that
+* is the breadth-first order of a complete binary search tree: the
+* children of the key at (1-based) position k are at 2k and 2k + 1.
+* The values sit at the same positions in a second array, so the
+* search only ever touches keys.
+*
+* A search walks down with k = 2k + (key at k is before the key), which
+* compiles to a conditional move rather than a branch, and always takes
+* the same number of steps. The descendants a few levels below k lie
+* next to each other, so each step also prefetches the cache line
+* holding them, hiding most of the latency of the steps to come.
+*
+* Iteration is in key order like that of BinarySearchTree. Its items
+* are pairs of references, since keys and values live apart.
+*/
+template <typename Key, typename Value, typename Compare = std::less<Key> >
+class FrozenMap
+{
+public:
+    FrozenMap();
+    explicit FrozenMap(const BinarySearchTree<Key, Value, Compare>& tree);
+    template <typename InputIterator>
+    FrozenMap(InputIterator first, InputIterator last, const Compare& comp = Compare());
+
+    /**
+    * An input iterator over the items in key order.
+    */
+    class iterator
+    {
+    public:
+        typedef std::pair<const Key&, const Value&> Item;
+        typedef std::input_iterator_tag iterator_category;
+        typedef Item value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef Item reference;
+
+        /**
+        * Lets it->first and it->second work on an item made on the fly.
+        */
+        class pointer
+        {
+        public:
+            explicit pointer(const Item& item) : item_(item) { }
+            const Item* operator->() const { return &item_; }
+        private:
+            Item item_;
+        };
+
+        iterator();
+
+        Item operator*() const;
+        pointer operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+        iterator operator++(int);
+
+    protected:
+        friend class FrozenMap<Key, Value, Compare>;
+        iterator(const FrozenMap<Key, Value, Compare>* map, std::size_t index);
+        const FrozenMap<Key, Value, Compare>* map_;
+        // 1-based Eytzinger position, 0 at the end
+        std::size_t index_;
+    };
+
+    iterator find(const Key& key) const;
+    iterator lower_bound(const Key& key) const;
+    iterator upper_bound(const Key& key) const;
+    bool contains(const Key& key) const;
+    Value const & operator[](const Key& key) const;
+    iterator begin() const;
+    iterator end() const;
+    bool empty() const;
+    std::size_t size() const;
+
+protected:
+    // keys per cache line: the descendants this many positions below
+    // 1-based position k start at position k * kKeysPerLine
+    static const std::size_t kKeysPerLine = sizeof(Key) >= 64 ? 1 : 64 / sizeof(Key);
+
+    template <typename InputIterator>
+    void build(InputIterator first, InputIterator last);
+    static void place(std::size_t n, std::size_t k, std::size_t& next, std::vector<std::size_t>& order);
+    template <bool Upper>
+    std::size_t search(const Key& key) const;
+    static std::size_t afterRightmost(std::size_t k);
+
+    // keys_[k - 1] and values_[k - 1] hold the item at position k
+    std::vector<Key> keys_;
+    std::vector<Value> values_;
+    Compare comp_;
+};
+
+template <typename Key, typename Value, typename Compare>
+const std::size_t FrozenMap<Key, Value, Compare>::kKeysPerLine;
+
+/*
+--------------------------------------------------------
+Begin implementations for the FrozenMap::iterator class.
+--------------------------------------------------------
+*/
+
+template<class Key, class Value, class Compare>
+FrozenMap<Key, Value, Compare>::iterator::iterator() :
+    map_(NULL), index_(0)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+FrozenMap<Key, Value, Compare>::iterator::iterator(const FrozenMap<Key, Value, Compare>* map, std::size_t index) :
+    map_(map), index_(index)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+typename FrozenMap<Key, Value, Compare>::iterator::Item
+FrozenMap<Key, Value, Compare>::iterator::operator*() const
+{
+    return Item(map_->keys_[index_ - 1], map_->values_[index_ - 1]);
+}
+
+template<class Key, class Value, class Compare>
+typename FrozenMap<Key, Value, Compare>::iterator::pointer
+FrozenMap<Key, Value, Compare>::iterator::operator->() const
+{
+    return pointer(**this);
+}
+
+template<class Key, class Value, class Compare>
+bool FrozenMap<Key, Value, Compare>::iterator::operator==(const iterator& rhs) const
+{
+    return index_ == rhs.index_;
+}
+
+template<class Key, class Value, class Compare>
+bool FrozenMap<Key, Value, Compare>::iterator::operator!=(const iterator& rhs) const
+{
+    return index_ != rhs.index_;
+}
+
+/**
+* Steps to the leftmost position of the right subtree if there is one,
+* otherwise up to the nearest ancestor whose left subtree this was.
+*/
+template<class Key, class Value, class Compare>
+typename FrozenMap<Key, Value, Compare>::iterator&
+FrozenMap<Key, Value, Compare>::iterator::operator++()
+{
+    std::size_t n = map_->keys_.size();
+    if (2 * index_ + 1 <= n) {
+      index_ = 2 * index_ + 1;
+      while (2 * index_ <= n) {
+        index_ *= 2;
+      }
+    }
+    else {
+      index_ = afterRightmost(index_);
+    }
+    return *this;
+}
+
+template<class Key, class Value, class Compare>
+typename FrozenMap<Key, Value, Compare>::iterator
+FrozenMap<Key, Value, Compare>::iterator::operator++(int)
+{
+    iterator before(*this);
+    ++(*this);
+    return before;
+}
+
+/*
+------------------------------------------------------
+End implementations for the FrozenMap::iterator class.
+------------------------------------------------------
+*/
+
+/*
+----------------------------------------------
+Begin implementations for the FrozenMap class.
+----------------------------------------------
+*/
+
+template<class Key, class Value, class Compare>
+FrozenMap<Key, Value, Compare>::FrozenMap() :
+    comp_()
+{
+
+}
+
+/**
+* Copies the items of tree, searching them with the tree's comparator.
+*/
+template<class Key, class Value, class Compare>
+FrozenMap<Key, Value, Compare>::FrozenMap(const BinarySearchTree<Key, Value, Compare>& tree) :
+    comp_(tree.key_comp())
+{
+    build(tree.begin(), tree.end());
+}
+
+/**
+* Copies the pairs in [first, last), which must be sorted by key with
+* no key repeated, e.g. any other map's iterators.
+*/
+template<class Key, class Value, class Compare>
+template <typename InputIterator>
+FrozenMap<Key, Value, Compare>::FrozenMap(InputIterator first, InputIterator last, const Compare& comp) :
+    comp_(comp)
+{
+    build(first, last);
+}
+
+/**
+* Lays the items out in Eytzinger order: an in-order walk of the
+* implicit tree numbers its positions with the ranks of the items.
+*/
+template<class Key, class Value, class Compare>
+template <typename InputIterator>
+void FrozenMap<Key, Value, Compare>::build(InputIterator first, InputIterator last)
+{
+    typedef typename std::iterator_traits<InputIterator>::value_type Item;
+    std::vector<Item> sorted(first, last);
+    std::vector<std::size_t> order(sorted.size() + 1);
+    std::size_t next = 0;
+    place(sorted.size(), 1, next, order);
+    keys_.reserve(sorted.size());
+    values_.reserve(sorted.size());
+    for (std::size_t k = 1; k <= sorted.size(); k++) {
+      keys_.push_back(sorted[order[k]].first);
+      values_.push_back(sorted[order[k]].second);
+    }
+}
+
+/**
+* Numbers the positions of the subtree of k in order, from next on.
+* The recursion is only as deep as the implicit tree.
+*/
+template<class Key, class Value, class Compare>
+void FrozenMap<Key, Value, Compare>::place(std::size_t n, std::size_t k, std::size_t& next, std::vector<std::size_t>& order)
+{
+    if (k > n) {
+      return;
+    }
+    place(n, 2 * k, next, order);
+    order[k] = next++;
+    place(n, 2 * k + 1, next, order);
+}
+
+/**
+* Returns the position that follows the in-order walk from k once the
+* subtree of k is done: k shifted right past its trailing ones and the
+* zero above them (0 if there is none, i.e. k was the last position).
+*/
+template<class Key, class Value, class Compare>
+std::size_t FrozenMap<Key, Value, Compare>::afterRightmost(std::size_t k)
+{
+#if defined(__GNUC__)
+    return k >> __builtin_ffsll(~static_cast<unsigned long long>(k));
+#else
+    while (k & 1) {
+      k >>= 1;
+    }
+    return k >> 1;
+#endif
+}
+
+/**
+* Returns the position of the first key that is not before key (or,
+* for Upper, after it), or 0 if there is none. Every search runs to the
+* bottom of the tree without branching on the comparisons; the walk
+* ends below the answer, which is the last position it went left from.
+*/
+template<class Key, class Value, class Compare>
+template <bool Upper>
+std::size_t FrozenMap<Key, Value, Compare>::search(const Key& key) const
+{
+    const Key* keys = keys_.data();
+    std::size_t n = keys_.size();
+    std::size_t k = 1;
+    while (k <= n) {
+#if defined(__GNUC__)
+      __builtin_prefetch(reinterpret_cast<const void*>(
+          reinterpret_cast<std::uintptr_t>(keys) + (k * kKeysPerLine - 1) * sizeof(Key)));
+#endif
+      bool right = Upper ? !comp_(key, keys[k - 1]) : comp_(keys[k - 1], key);
+      k = 2 * k + right;
+    }
+    return afterRightmost(k);
+}
+
+template<class Key, class Value, class Compare>
+typename FrozenMap<Key, Value, Compare>::iterator
+FrozenMap<Key, Value, Compare>::lower_bound(const Key& key) const
+{
+    return iterator(this, search<false>(key));
+}
+
+template<class Key, class Value, class Compare>
+typename FrozenMap<Key, Value, Compare>::iterator
+FrozenMap<Key, Value, Compare>::upper_bound(const Key& key) const
+{
+    return iterator(this, search<true>(key));
+}
+
+template<class Key, class Value, class Compare>
+typename FrozenMap<Key, Value, Compare>::iterator
+FrozenMap<Key, Value, Compare>::find(const Key& key) const
+{
+    std::size_t k = search<false>(key);
+    if (k == 0 || comp_(key, keys_[k - 1])) {
+      return end();
+    }
+    return iterator(this, k);
+}
+
+template<class Key, class Value, class Compare>
+bool FrozenMap<Key, Value, Compare>::contains(const Key& key) const
+{
+    return find(key) != end();
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value, class Compare>
+Value const & FrozenMap<Key, Value, Compare>::operator[](const Key& key) const
+{
+    std::size_t k = find(key).index_;
+    if(k == 0) throw std::out_of_range("Invalid key");
+    return values_[k - 1];
+}
+
+template<class Key, class Value, class Compare>
+typename FrozenMap<Key, Value, Compare>::iterator
+FrozenMap<Key, Value, Compare>::begin() const
+{
+    std::size_t k = keys_.empty() ? 0 : 1;
+    while (k != 0 && 2 * k <= keys_.size()) {
+      k *= 2;
+    }
+    return iterator(this, k);
+}
+
+template<class Key, class Value, class Compare>
+typename FrozenMap<Key, Value, Compare>::iterator
+FrozenMap<Key, Value, Compare>::end() const
+{
+    return iterator(this, 0);
+}
+
+template<class Key, class Value, class Compare>
+bool FrozenMap<Key, Value, Compare>::empty() const
+{
+    return keys_.empty();
+}
+
+template<class Key, class Value, class Compare>
+std::size_t FrozenMap<Key, Value, Compare>::size() const
+{
+    return keys_.size();
+}
+
+/*
+--------------------------------------------
+End implementations for the FrozenMap class.
+--------------------------------------------
+*/
+
+#endif
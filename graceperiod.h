@@ -0,0 +1,128 @@
+#ifndef GRACEPERIOD_H
+#define GRACEPERIOD_H
+
+#include <atomic>
+#include <thread>
+
+/**
+* Lets a writer wait until every reader that might still see something
+* it just unlinked has finished, so that it can free it (a grace period,
+* as in RCU). Readers announce themselves with a GracePeriod::Reader for
+* as long as they look at shared data; they never wait for anything.
+*
+* Readers are counted per epoch in one of kSlots slots chosen per thread,
+* so readers on different threads rarely touch the same cache line.
+* synchronize() flips the epoch and waits for the count of the old epoch
+* to drop to zero in every slot. Readers that start later can no longer
+* reach what was unlinked before the call.
+*
+* Only one thread may call synchronize() at a time.
+*/
+class GracePeriod
+{
+public:
+    GracePeriod();
+
+    /**
+    * Counts a reader in for as long as it exists.
+    */
+    class Reader
+    {
+    public:
+        explicit Reader(const GracePeriod& grace);
+        ~Reader();
+    private:
+        Reader(const Reader&);
+        Reader& operator=(const Reader&);
+        std::atomic<unsigned>& count_;
+    };
+
+    void synchronize();
+
+private:
+    /**
+    * Slots are padded to two cache lines so that the counters of
+    * different slots never share one, however the array is aligned.
+    */
+    struct Slot
+    {
+        std::atomic<unsigned> count[2];
+        char padding[128 - 2 * sizeof(std::atomic<unsigned>)];
+    };
+    static const unsigned kSlots = 64;
+
+    static unsigned slotOfThread();
+    std::atomic<unsigned>& enter() const;
+
+    mutable std::atomic<unsigned> epoch_;
+    mutable Slot slots_[kSlots];
+
+    GracePeriod(const GracePeriod&);
+    GracePeriod& operator=(const GracePeriod&);
+};
+
+inline GracePeriod::Reader::Reader(const GracePeriod& grace) :
+    count_(grace.enter())
+{
+
+}
+
+inline GracePeriod::Reader::~Reader()
+{
+    count_.fetch_sub(1, std::memory_order_release);
+}
+
+inline GracePeriod::GracePeriod() :
+    epoch_(0)
+{
+    for (unsigned i = 0; i < kSlots; i++) {
+      slots_[i].count[0].store(0, std::memory_order_relaxed);
+      slots_[i].count[1].store(0, std::memory_order_relaxed);
+    }
+}
+
+/**
+* Returns the slot of the calling thread. Threads are spread over the
+* slots in the order they first read something.
+*/
+inline unsigned GracePeriod::slotOfThread()
+{
+    static std::atomic<unsigned> nextSlot(0);
+    static thread_local unsigned slot = nextSlot.fetch_add(1, std::memory_order_relaxed) % kSlots;
+    return slot;
+}
+
+/**
+* Counts a reader in for the current epoch and returns the counter to
+* decrement once it is done. If the epoch moves on meanwhile the count
+* is taken back and tried again, otherwise synchronize() could miss it.
+*/
+inline std::atomic<unsigned>& GracePeriod::enter() const
+{
+    Slot& slot = slots_[slotOfThread()];
+    while (true) {
+      unsigned epoch = epoch_.load();
+      slot.count[epoch].fetch_add(1);
+      if (epoch_.load() == epoch) {
+        return slot.count[epoch];
+      }
+      slot.count[epoch].fetch_sub(1, std::memory_order_release);
+    }
+}
+
+/**
+* Flips the epoch and waits for every reader counted in under the old
+* one to finish.
+*/
+inline void GracePeriod::synchronize()
+{
+    unsigned old = epoch_.load(std::memory_order_relaxed);
+    epoch_.store(old ^ 1);
+    for (unsigned i = 0; i < kSlots; i++) {
+      while (slots_[i].count[old].load() != 0) {
+        std::this_thread::yield();
+      }
+    }
+}
+
+#endif
@@ -0,0 +1,96 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include "bst.h"
+#include "avlbst.h"
+
+using namespace std;
+
+// Times building an AVL tree from sorted, reverse-sorted and nearly-sorted
+// keys, once with plain insert() and once with a hinted insert(): end() as
+// the hint for ascending input and begin() for descending input.
+
+typedef chrono::steady_clock Clock;
+typedef AVLTree<uint64_t, uint64_t> Tree;
+
+static double msSince(Clock::time_point start)
+{
+    return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+double plainInsert(const vector<uint64_t>& keys, int rounds)
+{
+    double ms = 0;
+    for (int r = 0; r < rounds; r++) {
+      Tree tree;
+      Clock::time_point start = Clock::now();
+      for (size_t i = 0; i < keys.size(); i++) {
+        tree.insert(make_pair(keys[i], keys[i]));
+      }
+      ms += msSince(start);
+      if (tree.size() != keys.size()) {
+        cout << "plain insert lost items!" << endl;
+        exit(1);
+      }
+    }
+    return ms / rounds;
+}
+
+double hintedInsert(const vector<uint64_t>& keys, int rounds, bool descending)
+{
+    double ms = 0;
+    for (int r = 0; r < rounds; r++) {
+      Tree tree;
+      Clock::time_point start = Clock::now();
+      for (size_t i = 0; i < keys.size(); i++) {
+        tree.insert(descending ? tree.begin() : tree.end(), make_pair(keys[i], keys[i]));
+      }
+      ms += msSince(start);
+      if (tree.size() != keys.size() || !tree.isBalanced()) {
+        cout << "hinted insert built a bad tree!" << endl;
+        exit(1);
+      }
+    }
+    return ms / rounds;
+}
+
+void report(const char* name, const vector<uint64_t>& keys, int rounds, bool descending)
+{
+    double plain = plainInsert(keys, rounds);
+    double hinted = hintedInsert(keys, rounds, descending);
+    cout << setw(16) << name << setw(10) << keys.size()
+         << setw(12) << fixed << setprecision(2) << plain
+         << setw(12) << hinted
+         << setw(10) << setprecision(2) << plain / hinted << "x" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n = 1000000;
+    int rounds = 3;
+    if (argc > 1) n = strtoul(argv[1], NULL, 10);
+    if (argc > 2) rounds = atoi(argv[2]);
+
+    vector<uint64_t> sorted(n);
+    for (size_t i = 0; i < n; i++) sorted[i] = i;
+    vector<uint64_t> reversed(sorted.rbegin(), sorted.rend());
+    // sorted, except that one key in a hundred is swapped with one a
+    // short distance ahead of it, like slightly late timestamps
+    vector<uint64_t> nearly(sorted);
+    mt19937_64 rng(104);
+    for (size_t i = 0; i + 64 < n; i += 100) {
+      swap(nearly[i], nearly[i + 1 + rng() % 63]);
+    }
+
+    cout << setw(16) << "input" << setw(10) << "n" << setw(12) << "insert ms"
+         << setw(12) << "hinted ms" << setw(11) << "speedup" << endl;
+    report("sorted", sorted, rounds, false);
+    report("reverse-sorted", reversed, rounds, true);
+    report("nearly-sorted", nearly, rounds, false);
+    return 0;
+}
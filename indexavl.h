@@ -0,0 +1,803 @@
+#ifndef INDEXAVL_H
+#define INDEXAVL_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <functional>
+#include "keycompare.h"
+
+/**
+* An AVL tree whose nodes live in one contiguous array and link to each
+* other with 32-bit indices instead of pointers. For small keys and values
+* that shrinks a node to the payload plus 13 bytes (e.g. 32 bytes for
+* uint64_t/uint64_t versus 48 for an AVLNode), so more of a large tree stays
+* in cache. The price is a limit of 2^32 - 1 nodes, and that growing the
+* array moves the items, which invalidates iterators and references just
+* like std::vector.
+*
+* The balancing follows AVLTree (same balance convention, same rotations)
+* and keys are ordered by Compare the same way, this is only a different
+* storage layout.
+*/
+template <typename Key, typename Value, typename Compare = std::less<Key> >
+class IndexedAVLTree
+{
+public:
+    typedef std::uint32_t Index;
+    // the "NULL" index
+    static const Index NIL = 0xFFFFFFFFu;
+
+    IndexedAVLTree();
+    explicit IndexedAVLTree(const Compare& comp);
+    ~IndexedAVLTree();
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    bool isBalanced() const;
+    bool empty() const;
+    std::size_t size() const;
+    std::size_t bytesReserved() const;
+    static std::size_t nodeSize();
+
+    /**
+    * An iterator for in-order traversal, comparable to
+    * BinarySearchTree::iterator.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        std::pair<const Key,Value>& operator*() const;
+        std::pair<const Key,Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class IndexedAVLTree<Key, Value, Compare>;
+        iterator(IndexedAVLTree<Key, Value, Compare>* tree, Index current);
+        IndexedAVLTree<Key, Value, Compare>* tree_;
+        Index current_;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+protected:
+    struct IndexedNode
+    {
+        std::pair<const Key, Value> item;
+        Index parent;
+        Index left;
+        Index right;
+        // kFreeSlot marks a slot on the free list
+        int8_t balance;
+    };
+    static const int8_t kFreeSlot = 127;
+
+    IndexedNode& node(Index i) const;
+    Index allocate(const std::pair<const Key, Value>& keyValuePair, Index parent);
+    void release(Index i);
+    void grow();
+
+    Index internalFind(const Key& key) const;
+    Index findNode(const Key& key, std::true_type threeWay) const;
+    Index findNode(const Key& key, std::false_type threeWay) const;
+    Index successor(Index current) const;
+    void nodeSwap(Index n1, Index n2);
+    void rotateLeft(Index n);
+    void rotateRight(Index n);
+    void addUpdate(Index parent, Index n);
+    void removeUpdate(Index parent, int diff);
+    int balancedHeight(Index n) const;
+
+    IndexedNode* nodes_;
+    Index capacity_;
+    // slots [0, used_) have been handed out at least once
+    Index used_;
+    Index free_;
+    Index root_;
+    std::size_t size_;
+    Compare comp_;
+
+private:
+    IndexedAVLTree(const IndexedAVLTree&);
+    IndexedAVLTree& operator=(const IndexedAVLTree&);
+};
+
+/*
+---------------------------------------------------------
+Begin implementations for the IndexedAVLTree::iterator class.
+---------------------------------------------------------
+*/
+
+template<class Key, class Value, class Compare>
+IndexedAVLTree<Key, Value, Compare>::iterator::iterator(IndexedAVLTree<Key, Value, Compare>* tree, Index current) :
+    tree_(tree), current_(current)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+IndexedAVLTree<Key, Value, Compare>::iterator::iterator() :
+    tree_(NULL), current_(NIL)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+std::pair<const Key,Value> &
+IndexedAVLTree<Key, Value, Compare>::iterator::operator*() const
+{
+    return tree_->node(current_).item;
+}
+
+template<class Key, class Value, class Compare>
+std::pair<const Key,Value> *
+IndexedAVLTree<Key, Value, Compare>::iterator::operator->() const
+{
+    return &(tree_->node(current_).item);
+}
+
+template<class Key, class Value, class Compare>
+bool IndexedAVLTree<Key, Value, Compare>::iterator::operator==(const iterator& rhs) const
+{
+    return current_ == rhs.current_;
+}
+
+template<class Key, class Value, class Compare>
+bool IndexedAVLTree<Key, Value, Compare>::iterator::operator!=(const iterator& rhs) const
+{
+    return current_ != rhs.current_;
+}
+
+template<class Key, class Value, class Compare>
+typename IndexedAVLTree<Key, Value, Compare>::iterator&
+IndexedAVLTree<Key, Value, Compare>::iterator::operator++()
+{
+    current_ = tree_->successor(current_);
+    return *this;
+}
+
+/*
+-------------------------------------------------------
+End implementations for the IndexedAVLTree::iterator class.
+-------------------------------------------------------
+*/
+
+/*
+---------------------------------------------------
+Begin implementations for the IndexedAVLTree class.
+---------------------------------------------------
+*/
+
+template<class Key, class Value, class Compare>
+IndexedAVLTree<Key, Value, Compare>::IndexedAVLTree() :
+    nodes_(NULL), capacity_(0), used_(0), free_(NIL), root_(NIL), size_(0), comp_()
+{
+
+}
+
+template<class Key, class Value, class Compare>
+IndexedAVLTree<Key, Value, Compare>::IndexedAVLTree(const Compare& comp) :
+    nodes_(NULL), capacity_(0), used_(0), free_(NIL), root_(NIL), size_(0), comp_(comp)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+IndexedAVLTree<Key, Value, Compare>::~IndexedAVLTree()
+{
+    clear();
+}
+
+template<class Key, class Value, class Compare>
+bool IndexedAVLTree<Key, Value, Compare>::empty() const
+{
+    return root_ == NIL;
+}
+
+template<class Key, class Value, class Compare>
+std::size_t IndexedAVLTree<Key, Value, Compare>::size() const
+{
+    return size_;
+}
+
+/**
+* Returns the bytes held by the node array.
+*/
+template<class Key, class Value, class Compare>
+std::size_t IndexedAVLTree<Key, Value, Compare>::bytesReserved() const
+{
+    return std::size_t(capacity_) * sizeof(IndexedNode);
+}
+
+/**
+* Returns the size of one node in the array.
+*/
+template<class Key, class Value, class Compare>
+std::size_t IndexedAVLTree<Key, Value, Compare>::nodeSize()
+{
+    return sizeof(IndexedNode);
+}
+
+/**
+* Resolves an index to its node.
+*/
+template<class Key, class Value, class Compare>
+typename IndexedAVLTree<Key, Value, Compare>::IndexedNode&
+IndexedAVLTree<Key, Value, Compare>::node(Index i) const
+{
+    return nodes_[i];
+}
+
+/**
+* Doubles the node array, moving the live items across.
+*/
+template<class Key, class Value, class Compare>
+void IndexedAVLTree<Key, Value, Compare>::grow()
+{
+    std::size_t newCapacity = capacity_ == 0 ? 32 : std::size_t(capacity_) * 2;
+    if (newCapacity > NIL) {
+      if (capacity_ == NIL) {
+        throw std::length_error("IndexedAVLTree is full");
+      }
+      newCapacity = NIL;
+    }
+    IndexedNode* grown = static_cast<IndexedNode*>(::operator new(newCapacity * sizeof(IndexedNode)));
+    for (Index i = 0; i < used_; i++) {
+      IndexedNode& from = nodes_[i];
+      IndexedNode* to = &grown[i];
+      if (from.balance != kFreeSlot) {
+        new (&to->item) std::pair<const Key, Value>(std::move(from.item));
+        from.item.~pair();
+      }
+      to->parent = from.parent;
+      to->left = from.left;
+      to->right = from.right;
+      to->balance = from.balance;
+    }
+    ::operator delete(nodes_);
+    nodes_ = grown;
+    capacity_ = Index(newCapacity);
+}
+
+/**
+* Constructs a new leaf in a free slot and returns its index. The slot
+* is only taken once the item is built, so if copying it throws the
+* slot stays free.
+*/
+template<class Key, class Value, class Compare>
+typename IndexedAVLTree<Key, Value, Compare>::Index
+IndexedAVLTree<Key, Value, Compare>::allocate(const std::pair<const Key, Value>& keyValuePair, Index parent)
+{
+    if (free_ == NIL && used_ == capacity_) {
+      grow();
+    }
+    Index i = free_ != NIL ? free_ : used_;
+    IndexedNode& n = nodes_[i];
+    new (&n.item) std::pair<const Key, Value>(keyValuePair);
+    if (free_ != NIL) {
+      free_ = n.parent;
+    } else {
+      used_++;
+    }
+    n.parent = parent;
+    n.left = NIL;
+    n.right = NIL;
+    n.balance = 0;
+    size_++;
+    return i;
+}
+
+/**
+* Destroys the item in slot i and puts the slot on the free list,
+* which is chained through the parent field.
+*/
+template<class Key, class Value, class Compare>
+void IndexedAVLTree<Key, Value, Compare>::release(Index i)
+{
+    IndexedNode& n = nodes_[i];
+    n.item.~pair();
+    n.balance = kFreeSlot;
+    n.parent = free_;
+    free_ = i;
+    size_--;
+}
+
+/**
+* Removes everything and gives the node array back.
+*/
+template<class Key, class Value, class Compare>
+void IndexedAVLTree<Key, Value, Compare>::clear()
+{
+    if (!std::is_trivially_destructible<std::pair<const Key, Value> >::value) {
+      for (Index i = 0; i < used_; i++) {
+        if (nodes_[i].balance != kFreeSlot) {
+          nodes_[i].item.~pair();
+        }
+      }
+    }
+    ::operator delete(nodes_);
+    nodes_ = NULL;
+    capacity_ = 0;
+    used_ = 0;
+    free_ = NIL;
+    root_ = NIL;
+    size_ = 0;
+}
+
+template<class Key, class Value, class Compare>
+typename IndexedAVLTree<Key, Value, Compare>::iterator
+IndexedAVLTree<Key, Value, Compare>::begin() const
+{
+    Index curr = root_;
+    if (curr != NIL) {
+      while (nodes_[curr].left != NIL) {
+        curr = nodes_[curr].left;
+      }
+    }
+    return iterator(const_cast<IndexedAVLTree<Key, Value, Compare>*>(this), curr);
+}
+
+template<class Key, class Value, class Compare>
+typename IndexedAVLTree<Key, Value, Compare>::iterator
+IndexedAVLTree<Key, Value, Compare>::end() const
+{
+    return iterator(const_cast<IndexedAVLTree<Key, Value, Compare>*>(this), NIL);
+}
+
+template<class Key, class Value, class Compare>
+typename IndexedAVLTree<Key, Value, Compare>::iterator
+IndexedAVLTree<Key, Value, Compare>::find(const Key& key) const
+{
+    return iterator(const_cast<IndexedAVLTree<Key, Value, Compare>*>(this), internalFind(key));
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value, class Compare>
+Value& IndexedAVLTree<Key, Value, Compare>::operator[](const Key& key)
+{
+    Index curr = internalFind(key);
+    if(curr == NIL) throw std::out_of_range("Invalid key");
+    return nodes_[curr].item.second;
+}
+template<class Key, class Value, class Compare>
+Value const & IndexedAVLTree<Key, Value, Compare>::operator[](const Key& key) const
+{
+    Index curr = internalFind(key);
+    if(curr == NIL) throw std::out_of_range("Invalid key");
+    return nodes_[curr].item.second;
+}
+
+template<class Key, class Value, class Compare>
+typename IndexedAVLTree<Key, Value, Compare>::Index
+IndexedAVLTree<Key, Value, Compare>::internalFind(const Key& key) const
+{
+    return findNode(key, typename ThreeWayCompare<Compare, Key, Key>::Available());
+}
+
+/**
+* One three-way comparison per level, see BinarySearchTree::findNode.
+*/
+template<class Key, class Value, class Compare>
+typename IndexedAVLTree<Key, Value, Compare>::Index
+IndexedAVLTree<Key, Value, Compare>::findNode(const Key& key, std::true_type) const
+{
+    Index current = root_;
+    while (current != NIL) {
+      const IndexedNode& n = nodes_[current];
+      int cmp = ThreeWayCompare<Compare, Key, Key>::compare(comp_, key, n.item.first);
+      if (cmp < 0) {
+        current = n.left;
+      } else if (cmp > 0) {
+        current = n.right;
+      } else {
+        return current;
+      }
+    }
+    return NIL;
+}
+
+/**
+* One comp_ call per level plus a final equality check, see
+* BinarySearchTree::findNode.
+*/
+template<class Key, class Value, class Compare>
+typename IndexedAVLTree<Key, Value, Compare>::Index
+IndexedAVLTree<Key, Value, Compare>::findNode(const Key& key, std::false_type) const
+{
+    Index current = root_;
+    Index candidate = NIL;
+    while (current != NIL) {
+      const IndexedNode& n = nodes_[current];
+      if (comp_(n.item.first, key)) {
+        current = n.right;
+      } else {
+        candidate = current;
+        current = n.left;
+      }
+    }
+    if (candidate != NIL && !comp_(key, nodes_[candidate].item.first)) {
+      return candidate;
+    }
+    return NIL;
+}
+
+template<class Key, class Value, class Compare>
+typename IndexedAVLTree<Key, Value, Compare>::Index
+IndexedAVLTree<Key, Value, Compare>::successor(Index current) const
+{
+    if (nodes_[current].right != NIL) {
+      current = nodes_[current].right;
+      while (nodes_[current].left != NIL) {
+        current = nodes_[current].left;
+      }
+      return current;
+    }
+    Index parent = nodes_[current].parent;
+    while (parent != NIL && nodes_[parent].right == current) {
+      current = parent;
+      parent = nodes_[parent].parent;
+    }
+    return parent;
+}
+
+/**
+* Same as AVLTree::insert: walk down, link a new leaf, then retrace.
+* An existing key has its value overwritten.
+*/
+template<class Key, class Value, class Compare>
+void IndexedAVLTree<Key, Value, Compare>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    Index child = root_;
+    Index parent = NIL;
+    Index candidate = NIL;
+    bool left = false;
+    while (child != NIL) {
+      IndexedNode& n = nodes_[child];
+      parent = child;
+      left = comp_(keyValuePair.first, n.item.first);
+      if (left) {
+        child = n.left;
+      } else {
+        candidate = child;
+        child = n.right;
+      }
+    }
+    // the last node we went right at is the only one that can be equal
+    if (candidate != NIL && !comp_(nodes_[candidate].item.first, keyValuePair.first)) {
+      nodes_[candidate].item.second = keyValuePair.second;
+      return;
+    }
+    Index added = allocate(keyValuePair, parent);
+    if (parent == NIL) {
+      root_ = added;
+      return;
+    }
+    if (left) {
+      nodes_[parent].left = added;
+    } else {
+      nodes_[parent].right = added;
+    }
+    addUpdate(parent, added);
+}
+
+/**
+* Same as AVLTree::remove: a node with two children is first swapped
+* with its predecessor, then the node (now with at most one child) is
+* spliced out and the balances are retraced.
+*/
+template<class Key, class Value, class Compare>
+void IndexedAVLTree<Key, Value, Compare>::remove(const Key& key)
+{
+    Index removed = internalFind(key);
+    if (removed == NIL) {
+      return;
+    }
+    if (nodes_[removed].left != NIL && nodes_[removed].right != NIL) {
+      Index predec = nodes_[removed].left;
+      while (nodes_[predec].right != NIL) {
+        predec = nodes_[predec].right;
+      }
+      nodeSwap(removed, predec);
+    }
+    IndexedNode& n = nodes_[removed];
+    Index child = n.left != NIL ? n.left : n.right;
+    Index parent = n.parent;
+    if (child != NIL) {
+      nodes_[child].parent = parent;
+    }
+    int diff = 0;
+    if (parent == NIL) {
+      root_ = child;
+    } else if (nodes_[parent].left == removed) {
+      nodes_[parent].left = child;
+      diff = -1;
+    } else {
+      nodes_[parent].right = child;
+      diff = 1;
+    }
+    release(removed);
+    if (parent != NIL) {
+      removeUpdate(parent, diff);
+    }
+}
+
+/**
+* Swaps the positions of two nodes in the tree (and their balances),
+* mirroring BinarySearchTree::nodeSwap.
+*/
+template<class Key, class Value, class Compare>
+void IndexedAVLTree<Key, Value, Compare>::nodeSwap(Index n1, Index n2)
+{
+    if (n1 == n2 || n1 == NIL || n2 == NIL) {
+      return;
+    }
+    IndexedNode& a = nodes_[n1];
+    IndexedNode& b = nodes_[n2];
+    Index n1p = a.parent, n1r = a.right, n1lt = a.left;
+    Index n2p = b.parent, n2r = b.right, n2lt = b.left;
+    bool n1isLeft = n1p != NIL && nodes_[n1p].left == n1;
+    bool n2isLeft = n2p != NIL && nodes_[n2p].left == n2;
+
+    std::swap(a.parent, b.parent);
+    std::swap(a.left, b.left);
+    std::swap(a.right, b.right);
+    std::swap(a.balance, b.balance);
+
+    if (n1r == n2) {
+      b.right = n1;
+      a.parent = n2;
+    } else if (n2r == n1) {
+      a.right = n2;
+      b.parent = n1;
+    } else if (n1lt == n2) {
+      b.left = n1;
+      a.parent = n2;
+    } else if (n2lt == n1) {
+      a.left = n2;
+      b.parent = n1;
+    }
+
+    if (n1p != NIL && n1p != n2) {
+      if (n1isLeft) nodes_[n1p].left = n2;
+      else nodes_[n1p].right = n2;
+    }
+    if (n1r != NIL && n1r != n2) nodes_[n1r].parent = n2;
+    if (n1lt != NIL && n1lt != n2) nodes_[n1lt].parent = n2;
+
+    if (n2p != NIL && n2p != n1) {
+      if (n2isLeft) nodes_[n2p].left = n1;
+      else nodes_[n2p].right = n1;
+    }
+    if (n2r != NIL && n2r != n1) nodes_[n2r].parent = n1;
+    if (n2lt != NIL && n2lt != n1) nodes_[n2lt].parent = n1;
+
+    if (root_ == n1) {
+      root_ = n2;
+    } else if (root_ == n2) {
+      root_ = n1;
+    }
+}
+
+template<class Key, class Value, class Compare>
+void IndexedAVLTree<Key, Value, Compare>::rotateLeft(Index n)
+{
+    Index newhead = nodes_[n].right;
+    Index initialSubtree = nodes_[newhead].left;
+    Index parent = nodes_[n].parent;
+
+    if (parent == NIL) {
+      root_ = newhead;
+    } else if (nodes_[parent].left == n) {
+      nodes_[parent].left = newhead;
+    } else {
+      nodes_[parent].right = newhead;
+    }
+    nodes_[newhead].parent = parent;
+    nodes_[newhead].left = n;
+    nodes_[n].parent = newhead;
+    nodes_[n].right = initialSubtree;
+    if (initialSubtree != NIL) {
+      nodes_[initialSubtree].parent = n;
+    }
+}
+
+template<class Key, class Value, class Compare>
+void IndexedAVLTree<Key, Value, Compare>::rotateRight(Index n)
+{
+    Index newhead = nodes_[n].left;
+    Index initialSubtree = nodes_[newhead].right;
+    Index parent = nodes_[n].parent;
+
+    if (parent == NIL) {
+      root_ = newhead;
+    } else if (nodes_[parent].left == n) {
+      nodes_[parent].left = newhead;
+    } else {
+      nodes_[parent].right = newhead;
+    }
+    nodes_[newhead].parent = parent;
+    nodes_[newhead].right = n;
+    nodes_[n].parent = newhead;
+    nodes_[n].left = initialSubtree;
+    if (initialSubtree != NIL) {
+      nodes_[initialSubtree].parent = n;
+    }
+}
+
+/**
+* Retraces after inserting n below parent; see AVLTree::addUpdate.
+*/
+template<class Key, class Value, class Compare>
+void IndexedAVLTree<Key, Value, Compare>::addUpdate(Index parent, Index n)
+{
+    while (parent != NIL) {
+      IndexedNode& p = nodes_[parent];
+      p.balance += (p.left == n) ? 1 : -1;
+      if (p.balance == 0) {
+        return;
+      }
+      if (p.balance == 1 || p.balance == -1) {
+        n = parent;
+        parent = p.parent;
+        continue;
+      }
+      IndexedNode& c = nodes_[n];
+      if (p.balance == 2 && c.balance == -1) {
+        // left right
+        Index gchild = c.right;
+        int gchildbf = nodes_[gchild].balance;
+        rotateLeft(n);
+        rotateRight(parent);
+        c.balance = gchildbf == -1 ? 1 : 0;
+        p.balance = gchildbf == 1 ? -1 : 0;
+        nodes_[gchild].balance = 0;
+      } else if (p.balance == -2 && c.balance == 1) {
+        // right left
+        Index gchild = c.left;
+        int gchildbf = nodes_[gchild].balance;
+        rotateRight(n);
+        rotateLeft(parent);
+        c.balance = gchildbf == 1 ? -1 : 0;
+        p.balance = gchildbf == -1 ? 1 : 0;
+        nodes_[gchild].balance = 0;
+      } else if (p.balance == 2) {
+        // left left
+        rotateRight(parent);
+        p.balance = 0;
+        c.balance = 0;
+      } else {
+        // right right
+        rotateLeft(parent);
+        p.balance = 0;
+        c.balance = 0;
+      }
+      return;
+    }
+}
+
+/**
+* Retraces after a removal; diff is -1 if parent lost height on the
+* left and 1 if on the right. See AVLTree::removeUpdate.
+*/
+template<class Key, class Value, class Compare>
+void IndexedAVLTree<Key, Value, Compare>::removeUpdate(Index parent, int diff)
+{
+    while (parent != NIL) {
+      IndexedNode& p = nodes_[parent];
+      p.balance += diff;
+
+      Index gparent = p.parent;
+      int ndiff = 0;
+      if (gparent != NIL) {
+        ndiff = nodes_[gparent].right == parent ? 1 : -1;
+      }
+
+      if (p.balance == 1 || p.balance == -1) {
+        return;
+      }
+      if (p.balance == 2) {
+        Index child = p.left;
+        IndexedNode& c = nodes_[child];
+        int childBalance = c.balance;
+        if (childBalance == -1) {
+          // left right
+          Index gchild = c.right;
+          int gchildbf = nodes_[gchild].balance;
+          rotateLeft(child);
+          rotateRight(parent);
+          c.balance = gchildbf == -1 ? 1 : 0;
+          p.balance = gchildbf == 1 ? -1 : 0;
+          nodes_[gchild].balance = 0;
+        } else {
+          // left left
+          rotateRight(parent);
+          if (childBalance == 0) {
+            p.balance = 1;
+            c.balance = -1;
+            return;
+          }
+          p.balance = 0;
+          c.balance = 0;
+        }
+      } else if (p.balance == -2) {
+        Index child = p.right;
+        IndexedNode& c = nodes_[child];
+        int childBalance = c.balance;
+        if (childBalance == 1) {
+          // right left
+          Index gchild = c.left;
+          int gchildbf = nodes_[gchild].balance;
+          rotateRight(child);
+          rotateLeft(parent);
+          c.balance = gchildbf == 1 ? -1 : 0;
+          p.balance = gchildbf == -1 ? 1 : 0;
+          nodes_[gchild].balance = 0;
+        } else {
+          // right right
+          rotateLeft(parent);
+          if (childBalance == 0) {
+            p.balance = -1;
+            c.balance = 1;
+            return;
+          }
+          p.balance = 0;
+          c.balance = 0;
+        }
+      }
+      // the subtree got shorter, keep going up
+      parent = gparent;
+      diff = ndiff;
+    }
+}
+
+/**
+ * Return true iff the tree is balanced.
+ */
+template<class Key, class Value, class Compare>
+bool IndexedAVLTree<Key, Value, Compare>::isBalanced() const
+{
+    return balancedHeight(root_) != -1;
+}
+
+template<class Key, class Value, class Compare>
+int IndexedAVLTree<Key, Value, Compare>::balancedHeight(Index n) const
+{
+    if (n == NIL) {
+      return 0;
+    }
+    int leftheight = balancedHeight(nodes_[n].left);
+    int rightheight = balancedHeight(nodes_[n].right);
+    if (leftheight == -1 || rightheight == -1) {
+      return -1;
+    }
+    if (leftheight - rightheight > 1 || rightheight - leftheight > 1) {
+      return -1;
+    }
+    return 1 + (leftheight > rightheight ? leftheight : rightheight);
+}
+
+/*
+-------------------------------------------------
+End implementations for the IndexedAVLTree class.
+-------------------------------------------------
+*/
+
+#endif
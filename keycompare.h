@@ -0,0 +1,106 @@
+#ifndef KEYCOMPARE_H
+#define KEYCOMPARE_H
+
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+/*
+  Comparison helpers shared by the search trees.
+
+  Every tree takes a Compare functor (std::less<Key> by default) and
+  orders keys with comp(a, b) meaning "a before b". A descent that only
+  has that needs two calls to tell less, greater and equal apart, so the
+  trees use one of two cheaper strategies instead:
+
+  - If a three-way comparison is available (see ThreeWayCompare below),
+    one call per level decides left, right or found.
+  - Otherwise the descent only ever asks comp(node, key) and remembers
+    the last candidate, doing a single equality check at the bottom.
+*/
+
+/**
+* Maps any well-formed type to void, for detecting members (std::void_t
+* is C++17).
+*/
+template<typename T>
+struct VoidType
+{
+    typedef void type;
+};
+
+/**
+* True for comparators that declare is_transparent (such as std::less<>),
+* which lets the trees look up keys of other types without converting
+* them to Key first.
+*/
+template<typename Compare, typename = void>
+struct IsTransparent : std::false_type { };
+
+template<typename Compare>
+struct IsTransparent<Compare, typename VoidType<typename Compare::is_transparent>::type> : std::true_type { };
+
+/**
+* True if the comparator itself offers int compare(a, b) returning
+* <0, 0 or >0.
+*/
+template<typename Compare, typename A, typename B, typename = void>
+struct ComparatorHasThreeWay : std::false_type { };
+
+template<typename Compare, typename A, typename B>
+struct ComparatorHasThreeWay<Compare, A, B,
+    typename VoidType<decltype(std::declval<const Compare&>().compare(std::declval<const A&>(), std::declval<const B&>()))>::type>
+    : std::is_convertible<decltype(std::declval<const Compare&>().compare(std::declval<const A&>(), std::declval<const B&>())), int> { };
+
+/**
+* True if a key type has an int a.compare(b) member, like std::string
+* and std::string_view do.
+*/
+template<typename A, typename B, typename = void>
+struct KeyHasThreeWay : std::false_type { };
+
+template<typename A, typename B>
+struct KeyHasThreeWay<A, B,
+    typename VoidType<decltype(std::declval<const A&>().compare(std::declval<const B&>()))>::type>
+    : std::is_same<decltype(std::declval<const A&>().compare(std::declval<const B&>())), int> { };
+
+/**
+* True for std::less<T> (including std::less<void>), whose order is the
+* one a key's own compare() member agrees with.
+*/
+template<typename Compare>
+struct IsStdLess : std::false_type { };
+
+template<typename T>
+struct IsStdLess<std::less<T> > : std::true_type { };
+
+/**
+* Decides whether keys of type A can be compared against stored keys of
+* type B with a single three-way call under Compare. That is the case if
+* the comparator has a compare() member, or if it is std::less and the key
+* has one. compare() returns <0, 0 or >0 for a before, equal to, or after b.
+*/
+template<typename Compare, typename A, typename B>
+struct ThreeWayCompare
+{
+    typedef std::integral_constant<bool, ComparatorHasThreeWay<Compare, A, B>::value> ViaComparator;
+    typedef std::integral_constant<bool, ViaComparator::value ||
+        (IsStdLess<Compare>::value && KeyHasThreeWay<A, B>::value)> Available;
+
+    static int compare(const Compare& comp, const A& a, const B& b)
+    {
+        return compare(comp, a, b, ViaComparator());
+    }
+
+private:
+    static int compare(const Compare& comp, const A& a, const B& b, std::true_type)
+    {
+        return comp.compare(a, b);
+    }
+    static int compare(const Compare&, const A& a, const B& b, std::false_type)
+    {
+        return a.compare(b);
+    }
+};
+
+#endif
@@ -0,0 +1,81 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include "bst.h"
+#include "avlbst.h"
+#include "indexavl.h"
+
+using namespace std;
+
+// Reports the memory used per element by each AVL node layout, along with
+// random lookup speed so the effect of the smaller footprint shows up.
+
+typedef chrono::steady_clock Clock;
+
+// exposes the pool size of a pointer-based tree
+template<typename Tree>
+class Measured : public Tree
+{
+public:
+    size_t poolBytes() const { return this->pool_.bytesReserved(); }
+};
+
+template<typename Tree>
+size_t poolBytes(const Measured<Tree>& tree) { return tree.poolBytes(); }
+
+template<typename Key, typename Value>
+size_t poolBytes(const IndexedAVLTree<Key, Value>& tree) { return tree.bytesReserved(); }
+
+template<typename Tree>
+void report(const char* name, size_t nodeSize, const vector<uint64_t>& keys, const vector<uint64_t>& probes)
+{
+    Tree tree;
+    for (size_t i = 0; i < keys.size(); i++) {
+      tree.insert(make_pair(keys[i], keys[i]));
+    }
+    if (!tree.isBalanced()) {
+      cout << name << ": tree is not balanced!" << endl;
+      exit(1);
+    }
+
+    uint64_t sum = 0;
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < probes.size(); i++) {
+      sum += tree.find(probes[i])->second;
+    }
+    double ns = chrono::duration<double, nano>(Clock::now() - start).count() / probes.size();
+
+    cout << setw(14) << name << setw(10) << keys.size() << setw(12) << nodeSize
+         << setw(14) << fixed << setprecision(1) << double(poolBytes(tree)) / keys.size()
+         << setw(14) << ns << "   (checksum " << sum << ")" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n = 1000000;
+    if (argc > 1) n = strtoul(argv[1], NULL, 10);
+
+    vector<uint64_t> keys(n);
+    for (size_t i = 0; i < n; i++) keys[i] = i;
+    mt19937_64 rng(104);
+    shuffle(keys.begin(), keys.end(), rng);
+    vector<uint64_t> probes(keys);
+    shuffle(probes.begin(), probes.end(), rng);
+
+    typedef AVLTree<uint64_t, uint64_t> Plain;
+    typedef AVLTree<uint64_t, uint64_t, std::less<uint64_t>, PackedAVLNode<uint64_t, uint64_t> > Packed;
+    typedef AVLTree<uint64_t, uint64_t, std::less<uint64_t>, SizedAVLNode<uint64_t, uint64_t> > Sized;
+
+    cout << setw(14) << "layout" << setw(10) << "n" << setw(12) << "node bytes"
+         << setw(14) << "bytes/elem" << setw(14) << "find ns/op" << endl;
+    report<Measured<Plain> >("avl", sizeof(AVLNode<uint64_t, uint64_t>), keys, probes);
+    report<Measured<Packed> >("avl-packed", sizeof(PackedAVLNode<uint64_t, uint64_t>), keys, probes);
+    report<Measured<Sized> >("avl-sized", sizeof(SizedAVLNode<uint64_t, uint64_t>), keys, probes);
+    report<IndexedAVLTree<uint64_t, uint64_t> >("avl-index32", IndexedAVLTree<uint64_t, uint64_t>::nodeSize(), keys, probes);
+    return 0;
+}
@@ -0,0 +1,377 @@
+#ifndef NODEPOOL_H
+#define NODEPOOL_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+/**
+ * A slab allocator for the fixed-size nodes of a search tree.
+ * Slots are carved out of large slabs with a bump pointer, and
+ * slots handed back by deallocate() go on a free list so that
+ * they are reused before the slab is grown. release() returns
+ * every slab to the system in O(number of slabs) without looking
+ * at the slots, so the owner must already have destroyed any
+ * objects whose destructors matter.
+ *
+ * The slot size is chosen at run time so that one pool type can
+ * back both a BinarySearchTree and the larger nodes of an AVLTree.
+ *
+ * Trees that hand nodes to each other (AVLTree::split() and join())
+ * call share(), after which the receiving pool keeps the giving pool's
+ * slabs alive until it is released itself. Only the pool that made a
+ * slab ever carves slots out of it, but freed slots go on the free list
+ * of whichever pool the node belongs to by then.
+ *
+ * Compiling with -DBST_NO_NODE_POOL turns the pool into a thin
+ * wrapper around ::operator new/delete (one call per node), which
+ * is what the trees did before the pool existed. That mode is
+ * only kept around for benchmarking.
+ */
+class NodePool
+{
+public:
+    NodePool(std::size_t slotSize, std::size_t slotAlign);
+    NodePool(NodePool&& other);
+    ~NodePool();
+
+    void* allocate();
+    void* allocateBlock(std::size_t count);
+    void deallocate(void* slot);
+    void release();
+    void swap(NodePool& other);
+    void share(const NodePool& other);
+    bool shared() const;
+
+    std::size_t slotSize() const;
+    std::size_t bytesReserved() const;
+
+#ifdef BST_NO_NODE_POOL
+    // every node has to be handed back one at a time in this mode
+    static const bool releasesInBulk = false;
+#else
+    static const bool releasesInBulk = true;
+#endif
+
+private:
+    // header that sits at the front of every slab, slots follow it
+    struct Slab
+    {
+        Slab* next;
+        std::size_t bytes;
+    };
+    // a freed slot is reused to hold the free list link
+    struct FreeSlot
+    {
+        FreeSlot* next;
+    };
+    // the slabs made by one pool, freed once no pool refers to them
+    struct Arena
+    {
+        Slab* slabs;
+        Arena() : slabs(NULL) { }
+        ~Arena();
+    };
+
+    static std::size_t roundUp(std::size_t n, std::size_t align);
+    void grow();
+    char* addSlab(std::size_t slots);
+    void keep(const std::shared_ptr<Arena>& arena);
+
+    // smallest and largest number of slots allocated per slab
+    static const std::size_t kFirstSlabSlots = 32;
+    static const std::size_t kMaxSlabSlots = 8192;
+
+    std::size_t slotSize_;
+    std::size_t headerSize_;
+    std::size_t nextSlabSlots_;
+    std::size_t reserved_;
+    // our own slabs, and those of the pools we were given nodes by
+    std::shared_ptr<Arena> arena_;
+    std::vector<std::shared_ptr<Arena> > shared_;
+    FreeSlot* free_;
+    char* bump_;
+    char* bumpEnd_;
+
+    // a pool owns raw memory, so it can be moved but not copied
+    NodePool(const NodePool&);
+    NodePool& operator=(const NodePool&);
+};
+
+/*
+  -------------------------------------------
+  Begin implementations for the NodePool class.
+  -------------------------------------------
+*/
+
+/**
+* Rounds n up to the next multiple of align (a power of two).
+*/
+inline std::size_t NodePool::roundUp(std::size_t n, std::size_t align)
+{
+    return (n + align - 1) & ~(align - 1);
+}
+
+/**
+* Constructs an empty pool. No memory is reserved until the
+* first allocate().
+*/
+inline NodePool::NodePool(std::size_t slotSize, std::size_t slotAlign) :
+    nextSlabSlots_(kFirstSlabSlots),
+    reserved_(0),
+    free_(NULL),
+    bump_(NULL),
+    bumpEnd_(NULL)
+{
+    // malloc only guarantees max_align_t, and a free slot must be able to hold a link
+    if (slotAlign < alignof(FreeSlot)) {
+      slotAlign = alignof(FreeSlot);
+    }
+    if (slotSize < sizeof(FreeSlot)) {
+      slotSize = sizeof(FreeSlot);
+    }
+    slotSize_ = roundUp(slotSize, slotAlign);
+    headerSize_ = roundUp(sizeof(Slab), alignof(std::max_align_t));
+}
+
+/**
+* Takes over every slab of other, leaving it empty. Slots that
+* were handed out by other stay valid and now belong to this pool.
+*/
+inline NodePool::NodePool(NodePool&& other) :
+    slotSize_(other.slotSize_),
+    headerSize_(other.headerSize_),
+    nextSlabSlots_(other.nextSlabSlots_),
+    reserved_(other.reserved_),
+    arena_(std::move(other.arena_)),
+    shared_(std::move(other.shared_)),
+    free_(other.free_),
+    bump_(other.bump_),
+    bumpEnd_(other.bumpEnd_)
+{
+    other.nextSlabSlots_ = kFirstSlabSlots;
+    other.reserved_ = 0;
+    other.shared_.clear();
+    other.free_ = NULL;
+    other.bump_ = NULL;
+    other.bumpEnd_ = NULL;
+}
+
+/**
+* Destructor, which gives every slab back.
+*/
+inline NodePool::~NodePool()
+{
+    release();
+}
+
+/**
+* Returns uninitialized storage for one node. Freed slots are
+* reused first, then the current slab, then a new slab.
+*/
+inline void* NodePool::allocate()
+{
+#ifdef BST_NO_NODE_POOL
+    reserved_ += slotSize_;
+    return ::operator new(slotSize_);
+#else
+    if (free_ != NULL) {
+      FreeSlot* slot = free_;
+      free_ = slot->next;
+      return slot;
+    }
+    if (bump_ == bumpEnd_) {
+      grow();
+    }
+    void* slot = bump_;
+    bump_ += slotSize_;
+    return slot;
+#endif
+}
+
+/**
+* Returns count consecutive slots (slot i is slotSize() * i bytes past
+* the first) from a slab of their own, so that many nodes can be built
+* at once, even from several threads. Each slot is handed back with
+* deallocate() like any other. Returns NULL when the pool is compiled
+* out, since the nodes then have to be deleted one by one.
+*/
+inline void* NodePool::allocateBlock(std::size_t count)
+{
+#ifdef BST_NO_NODE_POOL
+    (void)count;
+    return NULL;
+#else
+    return addSlab(count);
+#endif
+}
+
+/**
+* Hands a slot back to the pool. The object in it must already
+* have been destroyed.
+*/
+inline void NodePool::deallocate(void* slot)
+{
+#ifdef BST_NO_NODE_POOL
+    reserved_ -= slotSize_;
+    ::operator delete(slot);
+#else
+    FreeSlot* freed = static_cast<FreeSlot*>(slot);
+    freed->next = free_;
+    free_ = freed;
+#endif
+}
+
+/**
+* Frees every slab at once and resets the pool to empty.
+* Any slot still in use becomes invalid, unless the slab it is in
+* was shared with a pool that still holds on to it.
+*/
+inline void NodePool::release()
+{
+    arena_.reset();
+    shared_.clear();
+    free_ = NULL;
+    bump_ = NULL;
+    bumpEnd_ = NULL;
+    nextSlabSlots_ = kFirstSlabSlots;
+#ifndef BST_NO_NODE_POOL
+    reserved_ = 0;
+#endif
+}
+
+/**
+* Exchanges the slabs of two pools in O(1). Slots keep belonging
+* to the slabs they came from.
+*/
+inline void NodePool::swap(NodePool& other)
+{
+    std::swap(slotSize_, other.slotSize_);
+    std::swap(headerSize_, other.headerSize_);
+    std::swap(nextSlabSlots_, other.nextSlabSlots_);
+    std::swap(reserved_, other.reserved_);
+    arena_.swap(other.arena_);
+    shared_.swap(other.shared_);
+    std::swap(free_, other.free_);
+    std::swap(bump_, other.bump_);
+    std::swap(bumpEnd_, other.bumpEnd_);
+}
+
+/**
+* Keeps the slabs of other alive for as long as this pool is, so that
+* nodes other allocated can be handed to our tree. Both pools must
+* have the same slot size.
+*/
+inline void NodePool::share(const NodePool& other)
+{
+#ifndef BST_NO_NODE_POOL
+    if (&other == this) {
+      return;
+    }
+    keep(other.arena_);
+    for (std::size_t i = 0; i < other.shared_.size(); i++) {
+      keep(other.shared_[i]);
+    }
+#else
+    (void)other;
+#endif
+}
+
+/**
+* True if slabs of this pool may hold nodes of another pool's tree, or
+* the other way around, so that release() could pull slots out from
+* under a tree.
+*/
+inline bool NodePool::shared() const
+{
+    return !shared_.empty() || (arena_ && arena_.use_count() > 1);
+}
+
+/**
+* Adds arena to the ones we keep alive, unless we already do.
+*/
+inline void NodePool::keep(const std::shared_ptr<Arena>& arena)
+{
+    if (!arena || arena == arena_) {
+      return;
+    }
+    for (std::size_t i = 0; i < shared_.size(); i++) {
+      if (shared_[i] == arena) {
+        return;
+      }
+    }
+    shared_.push_back(arena);
+}
+
+/**
+* Allocates a new slab, doubling the slab size each time up to
+* kMaxSlabSlots so small trees stay small.
+*/
+inline void NodePool::grow()
+{
+    bump_ = addSlab(nextSlabSlots_);
+    bumpEnd_ = bump_ + nextSlabSlots_ * slotSize_;
+    if (nextSlabSlots_ < kMaxSlabSlots) {
+      nextSlabSlots_ *= 2;
+    }
+}
+
+/**
+* Adds a slab with room for the given number of slots to our arena
+* and returns its first slot.
+*/
+inline char* NodePool::addSlab(std::size_t slots)
+{
+    if (!arena_) {
+      arena_ = std::make_shared<Arena>();
+    }
+    std::size_t bytes = headerSize_ + slots * slotSize_;
+    Slab* slab = static_cast<Slab*>(std::malloc(bytes));
+    if (slab == NULL) {
+      throw std::bad_alloc();
+    }
+    slab->next = arena_->slabs;
+    slab->bytes = bytes;
+    arena_->slabs = slab;
+    reserved_ += bytes;
+    return reinterpret_cast<char*>(slab) + headerSize_;
+}
+
+/**
+* Returns the size of one slot, after padding for alignment.
+*/
+inline std::size_t NodePool::slotSize() const
+{
+    return slotSize_;
+}
+
+/**
+* Returns how many bytes the pool currently holds from the system.
+*/
+inline std::size_t NodePool::bytesReserved() const
+{
+    return reserved_;
+}
+
+/**
+* Gives every slab of the arena back to the system.
+*/
+inline NodePool::Arena::~Arena()
+{
+    while (slabs != NULL) {
+      Slab* next = slabs->next;
+      std::free(slabs);
+      slabs = next;
+    }
+}
+
+/*
+  -----------------------------------------
+  End implementations for the NodePool class.
+  -----------------------------------------
+*/
+
+#endif
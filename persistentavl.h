@@ -0,0 +1,635 @@
+#ifndef PERSISTENTAVL_H
+#define PERSISTENTAVL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+#include "keycompare.h"
+
+/**
+* A node of a persistent AVL tree. Nodes never change once built and may
+* sit in any number of versions of a tree at once, so there is no parent
+* pointer, and each node counts the versions and parents that refer to it.
+* The count is atomic since versions can be dropped on any thread.
+*/
+template<typename Key, typename Value>
+struct PersistentAVLNode
+{
+    PersistentAVLNode(const std::pair<const Key, Value>& item, const PersistentAVLNode* left, const PersistentAVLNode* right);
+
+    const std::pair<const Key, Value> item;
+    const PersistentAVLNode* const left;
+    const PersistentAVLNode* const right;
+    // height of the subtree, a leaf has height 1
+    const uint8_t height;
+    mutable std::atomic<unsigned> refs;
+};
+
+/**
+* A read-only version of a PersistentAVLTree. Taking one is O(1) and it
+* stays valid and unchanged however the tree is modified afterwards, so
+* it can be handed to another thread and read there without locks. As
+* with a std::shared_ptr, each Snapshot object should only be used by one
+* thread at a time, but copies of it can be used anywhere. Nodes that
+* only old versions need are freed as soon as the last of those is gone.
+*/
+template <typename Key, typename Value, typename Compare = std::less<Key> >
+class PersistentAVLSnapshot
+{
+public:
+    typedef PersistentAVLNode<Key, Value> NodeType;
+
+    PersistentAVLSnapshot();
+    explicit PersistentAVLSnapshot(const Compare& comp);
+    PersistentAVLSnapshot(const PersistentAVLSnapshot& other);
+    PersistentAVLSnapshot& operator=(const PersistentAVLSnapshot& other);
+    ~PersistentAVLSnapshot();
+
+    /**
+    * An in-order iterator. Without parent pointers it keeps the path of
+    * nodes that still lie ahead on a stack. It does not keep its version
+    * alive: it is good for as long as the Snapshot (or the unmodified
+    * tree) it came from.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        const std::pair<const Key,Value>& operator*() const;
+        const std::pair<const Key,Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class PersistentAVLSnapshot<Key, Value, Compare>;
+        void pushLeftSpine(const NodeType* n);
+        // the current node is on top, below it the nodes whose left
+        // subtree it is in
+        std::vector<const NodeType*> path_;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    bool isBalanced() const;
+    bool empty() const;
+    std::size_t size() const;
+
+protected:
+    static const NodeType* retain(const NodeType* n);
+    static void release(const NodeType* n);
+    static int height(const NodeType* n);
+    const NodeType* findNode(const Key& key) const;
+    int compareKeys(const Key& a, const Key& b) const;
+    int compareKeys(const Key& a, const Key& b, std::true_type threeWay) const;
+    int compareKeys(const Key& a, const Key& b, std::false_type threeWay) const;
+    int balancedHeight(const NodeType* n) const;
+
+    const NodeType* root_;
+    std::size_t size_;
+    Compare comp_;
+};
+
+/**
+* An AVL tree that keeps its old versions. insert() and remove() copy
+* only the O(log n) nodes on the path from the root to the change and
+* share everything else with the previous version, which snapshot()
+* hands out in O(1). Copying the tree itself is O(1) as well.
+*
+* Nodes come from plain new and delete rather than a NodePool, since the
+* last version that needs a node may be dropped on any thread. Should an
+* allocation fail halfway through a change, the tree keeps its previous
+* version but the nodes already built for the new one are leaked.
+*/
+template <typename Key, typename Value, typename Compare = std::less<Key> >
+class PersistentAVLTree : public PersistentAVLSnapshot<Key, Value, Compare>
+{
+public:
+    typedef PersistentAVLNode<Key, Value> NodeType;
+    typedef PersistentAVLSnapshot<Key, Value, Compare> Snapshot;
+
+    PersistentAVLTree();
+    explicit PersistentAVLTree(const Compare& comp);
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    Snapshot snapshot() const;
+
+protected:
+    const NodeType* makeNode(const std::pair<const Key, Value>& item, const NodeType* left, const NodeType* right) const;
+    const NodeType* rebalance(const std::pair<const Key, Value>& item, const NodeType* left, const NodeType* right) const;
+    const NodeType* insertInto(const NodeType* n, const std::pair<const Key, Value>& keyValuePair, bool& added) const;
+    const NodeType* removeFrom(const NodeType* n, const Key& key) const;
+    const NodeType* removeMin(const NodeType* n) const;
+    void replaceRoot(const NodeType* root);
+};
+
+/*
+------------------------------------------------------
+Begin implementations for the PersistentAVLNode class.
+------------------------------------------------------
+*/
+
+/**
+* Takes over one reference to each child and starts out with one
+* reference of its own, held by whoever asked for the node.
+*/
+template<typename Key, typename Value>
+PersistentAVLNode<Key, Value>::PersistentAVLNode(const std::pair<const Key, Value>& item, const PersistentAVLNode* left, const PersistentAVLNode* right) :
+    item(item),
+    left(left),
+    right(right),
+    height(uint8_t(1 + std::max<int>(left == NULL ? 0 : left->height, right == NULL ? 0 : right->height))),
+    refs(1)
+{
+
+}
+
+/*
+----------------------------------------------------
+End implementations for the PersistentAVLNode class.
+----------------------------------------------------
+*/
+
+/*
+-------------------------------------------------------------------
+Begin implementations for the PersistentAVLSnapshot::iterator class.
+-------------------------------------------------------------------
+*/
+
+template<class Key, class Value, class Compare>
+PersistentAVLSnapshot<Key, Value, Compare>::iterator::iterator()
+{
+
+}
+
+template<class Key, class Value, class Compare>
+const std::pair<const Key,Value> &
+PersistentAVLSnapshot<Key, Value, Compare>::iterator::operator*() const
+{
+    return path_.back()->item;
+}
+
+template<class Key, class Value, class Compare>
+const std::pair<const Key,Value> *
+PersistentAVLSnapshot<Key, Value, Compare>::iterator::operator->() const
+{
+    return &(path_.back()->item);
+}
+
+template<class Key, class Value, class Compare>
+bool PersistentAVLSnapshot<Key, Value, Compare>::iterator::operator==(const iterator& rhs) const
+{
+    if (path_.empty() || rhs.path_.empty()) {
+      return path_.empty() == rhs.path_.empty();
+    }
+    return path_.back() == rhs.path_.back();
+}
+
+template<class Key, class Value, class Compare>
+bool PersistentAVLSnapshot<Key, Value, Compare>::iterator::operator!=(const iterator& rhs) const
+{
+    return !(*this == rhs);
+}
+
+template<class Key, class Value, class Compare>
+typename PersistentAVLSnapshot<Key, Value, Compare>::iterator&
+PersistentAVLSnapshot<Key, Value, Compare>::iterator::operator++()
+{
+    const NodeType* current = path_.back();
+    path_.pop_back();
+    pushLeftSpine(current->right);
+    return *this;
+}
+
+/**
+* Pushes n and its left descendants, the smallest ending up on top.
+*/
+template<class Key, class Value, class Compare>
+void PersistentAVLSnapshot<Key, Value, Compare>::iterator::pushLeftSpine(const NodeType* n)
+{
+    while (n != NULL) {
+      path_.push_back(n);
+      n = n->left;
+    }
+}
+
+/*
+-----------------------------------------------------------------
+End implementations for the PersistentAVLSnapshot::iterator class.
+-----------------------------------------------------------------
+*/
+
+/*
+----------------------------------------------------------
+Begin implementations for the PersistentAVLSnapshot class.
+----------------------------------------------------------
+*/
+
+template<class Key, class Value, class Compare>
+PersistentAVLSnapshot<Key, Value, Compare>::PersistentAVLSnapshot() :
+    root_(NULL), size_(0), comp_()
+{
+
+}
+
+template<class Key, class Value, class Compare>
+PersistentAVLSnapshot<Key, Value, Compare>::PersistentAVLSnapshot(const Compare& comp) :
+    root_(NULL), size_(0), comp_(comp)
+{
+
+}
+
+/**
+* Shares other's version, O(1).
+*/
+template<class Key, class Value, class Compare>
+PersistentAVLSnapshot<Key, Value, Compare>::PersistentAVLSnapshot(const PersistentAVLSnapshot& other) :
+    root_(retain(other.root_)), size_(other.size_), comp_(other.comp_)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+PersistentAVLSnapshot<Key, Value, Compare>&
+PersistentAVLSnapshot<Key, Value, Compare>::operator=(const PersistentAVLSnapshot& other)
+{
+    const NodeType* old = root_;
+    root_ = retain(other.root_);
+    size_ = other.size_;
+    comp_ = other.comp_;
+    release(old);
+    return *this;
+}
+
+template<class Key, class Value, class Compare>
+PersistentAVLSnapshot<Key, Value, Compare>::~PersistentAVLSnapshot()
+{
+    release(root_);
+}
+
+template<class Key, class Value, class Compare>
+bool PersistentAVLSnapshot<Key, Value, Compare>::empty() const
+{
+    return root_ == NULL;
+}
+
+template<class Key, class Value, class Compare>
+std::size_t PersistentAVLSnapshot<Key, Value, Compare>::size() const
+{
+    return size_;
+}
+
+template<class Key, class Value, class Compare>
+typename PersistentAVLSnapshot<Key, Value, Compare>::iterator
+PersistentAVLSnapshot<Key, Value, Compare>::begin() const
+{
+    iterator it;
+    it.pushLeftSpine(root_);
+    return it;
+}
+
+template<class Key, class Value, class Compare>
+typename PersistentAVLSnapshot<Key, Value, Compare>::iterator
+PersistentAVLSnapshot<Key, Value, Compare>::end() const
+{
+    return iterator();
+}
+
+/**
+* Walks down to key, remembering the nodes it went left at, which are
+* the ones the iterator visits after key.
+*/
+template<class Key, class Value, class Compare>
+typename PersistentAVLSnapshot<Key, Value, Compare>::iterator
+PersistentAVLSnapshot<Key, Value, Compare>::find(const Key& key) const
+{
+    iterator it;
+    const NodeType* current = root_;
+    while (current != NULL) {
+      int cmp = compareKeys(key, current->item.first);
+      if (cmp == 0) {
+        it.path_.push_back(current);
+        return it;
+      }
+      if (cmp < 0) {
+        it.path_.push_back(current);
+        current = current->left;
+      } else {
+        current = current->right;
+      }
+    }
+    return end();
+}
+
+template<class Key, class Value, class Compare>
+const typename PersistentAVLSnapshot<Key, Value, Compare>::NodeType*
+PersistentAVLSnapshot<Key, Value, Compare>::findNode(const Key& key) const
+{
+    const NodeType* current = root_;
+    while (current != NULL) {
+      int cmp = compareKeys(key, current->item.first);
+      if (cmp == 0) {
+        return current;
+      }
+      current = cmp < 0 ? current->left : current->right;
+    }
+    return NULL;
+}
+
+template<class Key, class Value, class Compare>
+const typename PersistentAVLSnapshot<Key, Value, Compare>::NodeType*
+PersistentAVLSnapshot<Key, Value, Compare>::retain(const NodeType* n)
+{
+    if (n != NULL) {
+      n->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    return n;
+}
+
+/**
+* Drops a reference to n, freeing it (and dropping its references to its
+* children) if that was the last one. Only the path down to nodes that
+* are still shared is ever visited.
+*/
+template<class Key, class Value, class Compare>
+void PersistentAVLSnapshot<Key, Value, Compare>::release(const NodeType* n)
+{
+    while (n != NULL && n->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      const NodeType* right = n->right;
+      release(n->left);
+      delete n;
+      n = right;
+    }
+}
+
+template<class Key, class Value, class Compare>
+int PersistentAVLSnapshot<Key, Value, Compare>::height(const NodeType* n)
+{
+    return n == NULL ? 0 : n->height;
+}
+
+template<class Key, class Value, class Compare>
+int PersistentAVLSnapshot<Key, Value, Compare>::compareKeys(const Key& a, const Key& b) const
+{
+    return compareKeys(a, b, typename ThreeWayCompare<Compare, Key, Key>::Available());
+}
+
+template<class Key, class Value, class Compare>
+int PersistentAVLSnapshot<Key, Value, Compare>::compareKeys(const Key& a, const Key& b, std::true_type) const
+{
+    return ThreeWayCompare<Compare, Key, Key>::compare(comp_, a, b);
+}
+
+/**
+* Two comp_ calls when a is not less than b, see
+* ConcurrentAVLTree::compareKeys.
+*/
+template<class Key, class Value, class Compare>
+int PersistentAVLSnapshot<Key, Value, Compare>::compareKeys(const Key& a, const Key& b, std::false_type) const
+{
+    if (comp_(a, b)) {
+      return -1;
+    }
+    return comp_(b, a) ? 1 : 0;
+}
+
+/**
+ * Return true iff the version is balanced (and the stored heights agree).
+ */
+template<class Key, class Value, class Compare>
+bool PersistentAVLSnapshot<Key, Value, Compare>::isBalanced() const
+{
+    return balancedHeight(root_) != -1;
+}
+
+template<class Key, class Value, class Compare>
+int PersistentAVLSnapshot<Key, Value, Compare>::balancedHeight(const NodeType* n) const
+{
+    if (n == NULL) {
+      return 0;
+    }
+    int leftheight = balancedHeight(n->left);
+    int rightheight = balancedHeight(n->right);
+    if (leftheight == -1 || rightheight == -1) {
+      return -1;
+    }
+    if (leftheight - rightheight > 1 || rightheight - leftheight > 1) {
+      return -1;
+    }
+    int h = 1 + (leftheight > rightheight ? leftheight : rightheight);
+    return h == n->height ? h : -1;
+}
+
+/*
+--------------------------------------------------------
+End implementations for the PersistentAVLSnapshot class.
+--------------------------------------------------------
+*/
+
+/*
+------------------------------------------------------
+Begin implementations for the PersistentAVLTree class.
+------------------------------------------------------
+*/
+
+template<class Key, class Value, class Compare>
+PersistentAVLTree<Key, Value, Compare>::PersistentAVLTree() :
+    Snapshot()
+{
+
+}
+
+template<class Key, class Value, class Compare>
+PersistentAVLTree<Key, Value, Compare>::PersistentAVLTree(const Compare& comp) :
+    Snapshot(comp)
+{
+
+}
+
+/**
+* Returns the current version, O(1).
+*/
+template<class Key, class Value, class Compare>
+typename PersistentAVLTree<Key, Value, Compare>::Snapshot
+PersistentAVLTree<Key, Value, Compare>::snapshot() const
+{
+    return Snapshot(*this);
+}
+
+/**
+* Makes root the current version and lets go of the previous one, which
+* frees whatever no snapshot still shares.
+*/
+template<class Key, class Value, class Compare>
+void PersistentAVLTree<Key, Value, Compare>::replaceRoot(const NodeType* root)
+{
+    const NodeType* old = this->root_;
+    this->root_ = root;
+    this->release(old);
+}
+
+/**
+* An existing key gets the new value, in a new version like any change.
+*/
+template<class Key, class Value, class Compare>
+void PersistentAVLTree<Key, Value, Compare>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    bool added = false;
+    replaceRoot(insertInto(this->root_, keyValuePair, added));
+    if (added) {
+      this->size_++;
+    }
+}
+
+template<class Key, class Value, class Compare>
+void PersistentAVLTree<Key, Value, Compare>::remove(const Key& key)
+{
+    if (this->findNode(key) == NULL) {
+      return;
+    }
+    replaceRoot(removeFrom(this->root_, key));
+    this->size_--;
+}
+
+template<class Key, class Value, class Compare>
+void PersistentAVLTree<Key, Value, Compare>::clear()
+{
+    replaceRoot(NULL);
+    this->size_ = 0;
+}
+
+/**
+* Builds a node that takes over the given references to its children.
+*/
+template<class Key, class Value, class Compare>
+const typename PersistentAVLTree<Key, Value, Compare>::NodeType*
+PersistentAVLTree<Key, Value, Compare>::makeNode(const std::pair<const Key, Value>& item, const NodeType* left, const NodeType* right) const
+{
+    return new NodeType(item, left, right);
+}
+
+/**
+* Builds a node for item over left and right (taking over the references
+* to them), doing the single or double rotation that is needed if their
+* heights differ by two. Shared nodes cannot be rotated in place, so the
+* nodes that a rotation moves are rebuilt and the originals released.
+*/
+template<class Key, class Value, class Compare>
+const typename PersistentAVLTree<Key, Value, Compare>::NodeType*
+PersistentAVLTree<Key, Value, Compare>::rebalance(const std::pair<const Key, Value>& item, const NodeType* left, const NodeType* right) const
+{
+    int leftheight = this->height(left);
+    int rightheight = this->height(right);
+    const NodeType* result;
+    if (leftheight > rightheight + 1) {
+      if (this->height(left->left) >= this->height(left->right)) {
+        // left left
+        result = makeNode(left->item, this->retain(left->left),
+            makeNode(item, this->retain(left->right), right));
+      } else {
+        // left right
+        const NodeType* gchild = left->right;
+        result = makeNode(gchild->item,
+            makeNode(left->item, this->retain(left->left), this->retain(gchild->left)),
+            makeNode(item, this->retain(gchild->right), right));
+      }
+      this->release(left);
+    } else if (rightheight > leftheight + 1) {
+      if (this->height(right->right) >= this->height(right->left)) {
+        // right right
+        result = makeNode(right->item, makeNode(item, left, this->retain(right->left)),
+            this->retain(right->right));
+      } else {
+        // right left
+        const NodeType* gchild = right->left;
+        result = makeNode(gchild->item,
+            makeNode(item, left, this->retain(gchild->left)),
+            makeNode(right->item, this->retain(gchild->right), this->retain(right->right)));
+      }
+      this->release(right);
+    } else {
+      result = makeNode(item, left, right);
+    }
+    return result;
+}
+
+/**
+* Returns a new version of the subtree at n with keyValuePair in it,
+* sharing every node off the search path.
+*/
+template<class Key, class Value, class Compare>
+const typename PersistentAVLTree<Key, Value, Compare>::NodeType*
+PersistentAVLTree<Key, Value, Compare>::insertInto(const NodeType* n, const std::pair<const Key, Value>& keyValuePair, bool& added) const
+{
+    if (n == NULL) {
+      added = true;
+      return makeNode(keyValuePair, NULL, NULL);
+    }
+    int cmp = this->compareKeys(keyValuePair.first, n->item.first);
+    if (cmp == 0) {
+      return makeNode(keyValuePair, this->retain(n->left), this->retain(n->right));
+    }
+    if (cmp < 0) {
+      return rebalance(n->item, insertInto(n->left, keyValuePair, added), this->retain(n->right));
+    }
+    return rebalance(n->item, this->retain(n->left), insertInto(n->right, keyValuePair, added));
+}
+
+/**
+* Returns a new version of the subtree at n without key, which must be
+* in it. A node with two children is replaced by its successor.
+*/
+template<class Key, class Value, class Compare>
+const typename PersistentAVLTree<Key, Value, Compare>::NodeType*
+PersistentAVLTree<Key, Value, Compare>::removeFrom(const NodeType* n, const Key& key) const
+{
+    int cmp = this->compareKeys(key, n->item.first);
+    if (cmp < 0) {
+      return rebalance(n->item, removeFrom(n->left, key), this->retain(n->right));
+    }
+    if (cmp > 0) {
+      return rebalance(n->item, this->retain(n->left), removeFrom(n->right, key));
+    }
+    if (n->left == NULL) {
+      return this->retain(n->right);
+    }
+    if (n->right == NULL) {
+      return this->retain(n->left);
+    }
+    const NodeType* successor = n->right;
+    while (successor->left != NULL) {
+      successor = successor->left;
+    }
+    // successor stays alive through n, which the caller still holds
+    return rebalance(successor->item, this->retain(n->left), removeMin(n->right));
+}
+
+/**
+* Returns a new version of the subtree at n without its smallest item.
+*/
+template<class Key, class Value, class Compare>
+const typename PersistentAVLTree<Key, Value, Compare>::NodeType*
+PersistentAVLTree<Key, Value, Compare>::removeMin(const NodeType* n) const
+{
+    if (n->left == NULL) {
+      return this->retain(n->right);
+    }
+    return rebalance(n->item, removeMin(n->left), this->retain(n->right));
+}
+
+/*
+----------------------------------------------------
+End implementations for the PersistentAVLTree class.
+----------------------------------------------------
+*/
+
+#endif
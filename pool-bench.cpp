@@ -0,0 +1,90 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include "bst.h"
+#include "avlbst.h"
+
+using namespace std;
+
+// Times insert/remove/clear churn on a tree. Build this file twice, once
+// normally and once with -DBST_NO_NODE_POOL (see "make bench"), to compare
+// the slab pool against the old per-node new/delete.
+
+typedef chrono::steady_clock Clock;
+
+static double msSince(Clock::time_point start)
+{
+    return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+template<typename Tree>
+void runChurn(const char* name, const vector<uint64_t>& keys, int rounds)
+{
+    double insertMs = 0, removeMs = 0, clearMs = 0;
+    size_t reserved = 0;
+    for (int r = 0; r < rounds; r++) {
+      Tree tree;
+      Clock::time_point start = Clock::now();
+      for (size_t i = 0; i < keys.size(); i++) {
+        tree.insert(make_pair(keys[i], keys[i]));
+      }
+      insertMs += msSince(start);
+
+      // remove every other key and put them back so the free list gets used
+      start = Clock::now();
+      for (size_t i = 0; i < keys.size(); i += 2) {
+        tree.remove(keys[i]);
+      }
+      for (size_t i = 0; i < keys.size(); i += 2) {
+        tree.insert(make_pair(keys[i], keys[i]));
+      }
+      removeMs += msSince(start);
+      reserved = tree.poolBytes();
+
+      start = Clock::now();
+      tree.clear();
+      clearMs += msSince(start);
+    }
+    cout << setw(6) << name << setw(10) << keys.size()
+         << setw(12) << fixed << setprecision(2) << insertMs / rounds
+         << setw(14) << removeMs / rounds
+         << setw(12) << clearMs / rounds
+         << setw(14) << setprecision(1) << double(reserved) / keys.size() << endl;
+}
+
+// exposes the pool size, which is all the benchmark needs from the internals
+template<typename Tree>
+class Measured : public Tree
+{
+public:
+    size_t poolBytes() const { return this->pool_.bytesReserved(); }
+};
+
+int main(int argc, char *argv[])
+{
+    size_t n = 1000000;
+    int rounds = 3;
+    if (argc > 1) n = strtoul(argv[1], NULL, 10);
+    if (argc > 2) rounds = atoi(argv[2]);
+
+    vector<uint64_t> keys(n);
+    for (size_t i = 0; i < n; i++) keys[i] = i;
+    mt19937_64 rng(104);
+    shuffle(keys.begin(), keys.end(), rng);
+
+#ifdef BST_NO_NODE_POOL
+    cout << "allocator: per-node new/delete" << endl;
+#else
+    cout << "allocator: slab pool" << endl;
+#endif
+    cout << setw(6) << "tree" << setw(10) << "n" << setw(12) << "insert ms"
+         << setw(14) << "rm+reins ms" << setw(12) << "clear ms" << setw(14) << "bytes/elem" << endl;
+    runChurn<Measured<BinarySearchTree<uint64_t, uint64_t> > >("bst", keys, rounds);
+    runChurn<Measured<AVLTree<uint64_t, uint64_t> > >("avl", keys, rounds);
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include "bst.h"
+#include "avlbst.h"
+
+using namespace std;
+
+// Sums the values of every key in [lo, hi) for a batch of random ranges,
+// once with a range view and once by filtering a full in-order scan,
+// which is what callers had to do before lower_bound existed.
+
+typedef chrono::steady_clock Clock;
+
+static double msSince(Clock::time_point start)
+{
+    return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n = 1000000;
+    size_t width = 1000;
+    int queries = 50;
+    if (argc > 1) n = strtoul(argv[1], NULL, 10);
+    if (argc > 2) width = strtoul(argv[2], NULL, 10);
+    if (argc > 3) queries = atoi(argv[3]);
+
+    vector<uint64_t> keys(n);
+    for (size_t i = 0; i < n; i++) keys[i] = i;
+    mt19937_64 rng(104);
+    shuffle(keys.begin(), keys.end(), rng);
+    AVLTree<uint64_t, uint64_t> tree;
+    for (size_t i = 0; i < n; i++) {
+      tree.insert(make_pair(keys[i], keys[i]));
+    }
+    vector<uint64_t> starts(queries);
+    for (int q = 0; q < queries; q++) starts[q] = rng() % n;
+
+    uint64_t viewSum = 0;
+    Clock::time_point start = Clock::now();
+    for (int q = 0; q < queries; q++) {
+      AVLTree<uint64_t, uint64_t>::RangeView view = tree.range(starts[q], starts[q] + width);
+      for (AVLTree<uint64_t, uint64_t>::iterator it = view.begin(); it != view.end(); ++it) {
+        viewSum += it->second;
+      }
+    }
+    double viewMs = msSince(start);
+
+    uint64_t scanSum = 0;
+    start = Clock::now();
+    for (int q = 0; q < queries; q++) {
+      for (AVLTree<uint64_t, uint64_t>::iterator it = tree.begin(); it != tree.end(); ++it) {
+        if (it->first >= starts[q] && it->first < starts[q] + width) {
+          scanSum += it->second;
+        }
+      }
+    }
+    double scanMs = msSince(start);
+
+    if (viewSum != scanSum) {
+      cout << "checksums differ: " << viewSum << " vs " << scanSum << endl;
+      return 1;
+    }
+    cout << "n=" << n << " width=" << width << " queries=" << queries << endl;
+    cout << setw(14) << "range view" << setw(12) << fixed << setprecision(3) << viewMs / queries << " ms/query" << endl;
+    cout << setw(14) << "filtered scan" << setw(12) << scanMs / queries << " ms/query" << endl;
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <thread>
+#include <cstdint>
+#include <cstdlib>
+#include "bst.h"
+#include "avlbst.h"
+
+using namespace std;
+
+// Merges two AVL trees of random keys, first the old way by inserting
+// every item of one into the other, then with the join-based unionWith(),
+// and times intersectWith() and differenceWith() on the same inputs.
+// The join-based versions fork across hardware threads, so run this on
+// a multi-core machine to see them scale.
+
+typedef chrono::steady_clock Clock;
+typedef AVLTree<uint64_t, uint64_t> Tree;
+
+static double msSince(Clock::time_point start)
+{
+    return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+static void build(Tree& tree, const vector<uint64_t>& keys)
+{
+    for (size_t i = 0; i < keys.size(); i++) {
+      tree.insert(make_pair(keys[i], keys[i]));
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n = 1000000;
+    size_t m = 1000000;
+    if (argc > 1) n = strtoul(argv[1], NULL, 10);
+    if (argc > 2) m = strtoul(argv[2], NULL, 10);
+
+    // keys from a range twice as large as both trees, so about a
+    // third of the smaller tree's keys collide
+    mt19937_64 rng(104);
+    vector<uint64_t> first(n), second(m);
+    for (size_t i = 0; i < n; i++) first[i] = rng() % (2 * (n + m));
+    for (size_t i = 0; i < m; i++) second[i] = rng() % (2 * (n + m));
+    auto sum = [](uint64_t ours, uint64_t theirs) { return ours + theirs; };
+
+    cout << "hardware threads: " << thread::hardware_concurrency() << endl;
+    cout << setw(22) << "operation" << setw(10) << "n" << setw(10) << "m"
+         << setw(12) << "ms" << setw(12) << "result" << endl;
+
+    double ms;
+    {
+      Tree a, b;
+      build(a, first);
+      build(b, second);
+      Clock::time_point start = Clock::now();
+      for (Tree::iterator it = b.begin(); it != b.end(); ++it) {
+        Tree::iterator found = a.find(it->first);
+        if (found == a.end()) {
+          a.insert(*it);
+        } else {
+          found->second += it->second;
+        }
+      }
+      ms = msSince(start);
+      cout << setw(22) << "insert loop" << setw(10) << n << setw(10) << m
+           << setw(12) << fixed << setprecision(1) << ms << setw(12) << a.size() << endl;
+    }
+    {
+      Tree a, b;
+      build(a, first);
+      build(b, second);
+      Clock::time_point start = Clock::now();
+      a.unionWith(b, sum);
+      ms = msSince(start);
+      cout << setw(22) << "unionWith" << setw(10) << n << setw(10) << m
+           << setw(12) << ms << setw(12) << a.size() << endl;
+    }
+    {
+      Tree a, b;
+      build(a, first);
+      build(b, second);
+      Clock::time_point start = Clock::now();
+      a.intersectWith(b, sum);
+      ms = msSince(start);
+      cout << setw(22) << "intersectWith" << setw(10) << n << setw(10) << m
+           << setw(12) << ms << setw(12) << a.size() << endl;
+    }
+    {
+      Tree a, b;
+      build(a, first);
+      build(b, second);
+      Clock::time_point start = Clock::now();
+      a.differenceWith(b);
+      ms = msSince(start);
+      cout << setw(22) << "differenceWith" << setw(10) << n << setw(10) << m
+           << setw(12) << ms << setw(12) << a.size() << endl;
+    }
+    return 0;
+}
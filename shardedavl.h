@@ -0,0 +1,616 @@
+#ifndef SHARDEDAVL_H
+#define SHARDEDAVL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "avlbst.h"
+#include "graceperiod.h"
+
+/**
+* A map whose key space is split by range over several AVLTree shards,
+* each behind a mutex of its own, so that updates to different ranges
+* run in parallel. insert(), remove(), find(key, value) and size() may
+* be called from any thread at any time.
+*
+* Shard i holds the keys from bounds[i - 1] up to (not including)
+* bounds[i]. A new map starts out with a single shard in use. When a
+* shard grows past twice the size of a neighbour (plus
+* kMinRebalanceSize), the boundary between the two is moved so that they
+* share the items evenly, which is O(log n) with AVLTree::split() and
+* join(). If the last shard in use is the one that grew, the next one is
+* taken into use instead, until all are. The shards are sized
+* AVLTrees so that the new boundary can be found with select().
+*
+* The bounds themselves are an immutable vector that a rebalance
+* replaces as a whole. An operation routes a key with the bounds it
+* finds, locks that shard and checks that the bounds are still the same
+* (a rebalance holds the locks of both shards it changes). Old bounds
+* are freed after a grace period, since routing takes no lock.
+*
+* The rest of the interface follows BinarySearchTree. Iterators,
+* references and find(key) look at the shards without locking them, so
+* like those of a plain tree they are only safe while no other thread
+* modifies the map. Any insert() may move items between shards and
+* invalidates all iterators.
+*/
+template <typename Key, typename Value, typename Compare = std::less<Key> >
+class ShardedAVLTree
+{
+public:
+    typedef AVLTree<Key, Value, Compare, SizedAVLNode<Key, Value> > ShardTree;
+    static const std::size_t kDefaultShards = 16;
+
+    explicit ShardedAVLTree(std::size_t shards = kDefaultShards);
+    ShardedAVLTree(std::size_t shards, const Compare& comp);
+    explicit ShardedAVLTree(const std::vector<Key>& bounds, const Compare& comp = Compare());
+    ~ShardedAVLTree();
+
+    /**
+    * A forward iterator over all items in key order, one shard after
+    * the other.
+    */
+    class iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef std::pair<const Key, Value> value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef std::pair<const Key, Value>* pointer;
+        typedef std::pair<const Key, Value>& reference;
+
+        iterator();
+
+        std::pair<const Key,Value>& operator*() const;
+        std::pair<const Key,Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+        iterator operator++(int);
+
+    protected:
+        friend class ShardedAVLTree<Key, Value, Compare>;
+        iterator(const ShardedAVLTree<Key, Value, Compare>* map, std::size_t shard, typename ShardTree::iterator current);
+        void skipEmptyShards();
+        const ShardedAVLTree<Key, Value, Compare>* map_;
+        std::size_t shard_;
+        typename ShardTree::iterator current_;
+    };
+
+    std::pair<iterator, bool> insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    bool find(const Key& key, Value& value) const;
+    iterator find(const Key& key) const;
+    iterator begin() const;
+    iterator end() const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+    bool isBalanced() const;
+    bool empty() const;
+    std::size_t size() const;
+    std::size_t shardsInUse() const;
+
+protected:
+    struct Shard
+    {
+        Shard() : count(0) { }
+        std::mutex lock;
+        ShardTree tree;
+        // tree.size(), for reading without the lock
+        std::atomic<std::size_t> count;
+    };
+    // the upper bounds of all shards in use but the last
+    typedef std::vector<Key> Bounds;
+
+    // neither of two neighbours is rebalanced before one has this many items
+    static const std::size_t kMinRebalanceSize = 4096;
+
+    void init(std::size_t shards);
+    std::size_t shardOf(const Bounds& bounds, const Key& key) const;
+    Shard& lockShard(const Key& key, std::unique_lock<std::mutex>& lock) const;
+    bool skewed(std::size_t larger, std::size_t smaller) const;
+    std::size_t skewedNeighbour(std::size_t i) const;
+    void rebalance(std::size_t left);
+    static void concat(ShardTree& a, ShardTree& b);
+
+    std::unique_ptr<Shard[]> shards_;
+    std::size_t shardCount_;
+    std::atomic<const Bounds*> bounds_;
+    // bounds_->size() + 1
+    std::atomic<std::size_t> inUse_;
+    mutable GracePeriod routing_;
+    // serializes rebalancing
+    mutable std::mutex rebalanceLock_;
+    Compare comp_;
+
+private:
+    ShardedAVLTree(const ShardedAVLTree&);
+    ShardedAVLTree& operator=(const ShardedAVLTree&);
+};
+
+template <typename Key, typename Value, typename Compare>
+const std::size_t ShardedAVLTree<Key, Value, Compare>::kDefaultShards;
+
+/*
+-------------------------------------------------------------
+Begin implementations for the ShardedAVLTree::iterator class.
+-------------------------------------------------------------
+*/
+
+template<class Key, class Value, class Compare>
+ShardedAVLTree<Key, Value, Compare>::iterator::iterator() :
+    map_(NULL), shard_(0), current_()
+{
+
+}
+
+template<class Key, class Value, class Compare>
+ShardedAVLTree<Key, Value, Compare>::iterator::iterator(const ShardedAVLTree<Key, Value, Compare>* map, std::size_t shard,
+                                                        typename ShardTree::iterator current) :
+    map_(map), shard_(shard), current_(current)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+std::pair<const Key,Value> &
+ShardedAVLTree<Key, Value, Compare>::iterator::operator*() const
+{
+    return *current_;
+}
+
+template<class Key, class Value, class Compare>
+std::pair<const Key,Value> *
+ShardedAVLTree<Key, Value, Compare>::iterator::operator->() const
+{
+    return &(*current_);
+}
+
+template<class Key, class Value, class Compare>
+bool ShardedAVLTree<Key, Value, Compare>::iterator::operator==(const iterator& rhs) const
+{
+    return shard_ == rhs.shard_ && current_ == rhs.current_;
+}
+
+template<class Key, class Value, class Compare>
+bool ShardedAVLTree<Key, Value, Compare>::iterator::operator!=(const iterator& rhs) const
+{
+    return !(*this == rhs);
+}
+
+template<class Key, class Value, class Compare>
+typename ShardedAVLTree<Key, Value, Compare>::iterator&
+ShardedAVLTree<Key, Value, Compare>::iterator::operator++()
+{
+    ++current_;
+    skipEmptyShards();
+    return *this;
+}
+
+template<class Key, class Value, class Compare>
+typename ShardedAVLTree<Key, Value, Compare>::iterator
+ShardedAVLTree<Key, Value, Compare>::iterator::operator++(int)
+{
+    iterator before(*this);
+    ++(*this);
+    return before;
+}
+
+/**
+* Moves on from the end of a shard to the first item of the next shard
+* that has any, or to end().
+*/
+template<class Key, class Value, class Compare>
+void ShardedAVLTree<Key, Value, Compare>::iterator::skipEmptyShards()
+{
+    std::size_t inUse = map_->inUse_.load(std::memory_order_relaxed);
+    while (shard_ < inUse && current_ == map_->shards_[shard_].tree.end()) {
+      shard_++;
+      current_ = shard_ < inUse ? map_->shards_[shard_].tree.begin() : typename ShardTree::iterator();
+    }
+}
+
+/*
+-----------------------------------------------------------
+End implementations for the ShardedAVLTree::iterator class.
+-----------------------------------------------------------
+*/
+
+/*
+---------------------------------------------------
+Begin implementations for the ShardedAVLTree class.
+---------------------------------------------------
+*/
+
+/**
+* A map of up to shards shards (at least one), which start out empty
+* and are taken into use as the map grows.
+*/
+template<class Key, class Value, class Compare>
+ShardedAVLTree<Key, Value, Compare>::ShardedAVLTree(std::size_t shards) :
+    comp_()
+{
+    init(shards);
+    bounds_.store(new Bounds(), std::memory_order_relaxed);
+    inUse_.store(1, std::memory_order_relaxed);
+}
+
+template<class Key, class Value, class Compare>
+ShardedAVLTree<Key, Value, Compare>::ShardedAVLTree(std::size_t shards, const Compare& comp) :
+    comp_(comp)
+{
+    init(shards);
+    bounds_.store(new Bounds(), std::memory_order_relaxed);
+    inUse_.store(1, std::memory_order_relaxed);
+}
+
+/**
+* A map with one shard more than there are bounds, all in use from the
+* start. bounds must be in increasing order. Rebalancing still moves the
+* boundaries later on if the shards become skewed.
+*/
+template<class Key, class Value, class Compare>
+ShardedAVLTree<Key, Value, Compare>::ShardedAVLTree(const std::vector<Key>& bounds, const Compare& comp) :
+    comp_(comp)
+{
+    init(bounds.size() + 1);
+    bounds_.store(new Bounds(bounds), std::memory_order_relaxed);
+    inUse_.store(bounds.size() + 1, std::memory_order_relaxed);
+}
+
+template<class Key, class Value, class Compare>
+void ShardedAVLTree<Key, Value, Compare>::init(std::size_t shards)
+{
+    shardCount_ = shards == 0 ? 1 : shards;
+    shards_.reset(new Shard[shardCount_]);
+    for (std::size_t i = 0; i < shardCount_; i++) {
+      shards_[i].tree = ShardTree(comp_);
+    }
+}
+
+/**
+* No other thread may be using the map any more.
+*/
+template<class Key, class Value, class Compare>
+ShardedAVLTree<Key, Value, Compare>::~ShardedAVLTree()
+{
+    delete bounds_.load(std::memory_order_relaxed);
+}
+
+template<class Key, class Value, class Compare>
+std::size_t ShardedAVLTree<Key, Value, Compare>::size() const
+{
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < shardCount_; i++) {
+      total += shards_[i].count.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+template<class Key, class Value, class Compare>
+bool ShardedAVLTree<Key, Value, Compare>::empty() const
+{
+    return size() == 0;
+}
+
+template<class Key, class Value, class Compare>
+std::size_t ShardedAVLTree<Key, Value, Compare>::shardsInUse() const
+{
+    return inUse_.load(std::memory_order_relaxed);
+}
+
+/**
+* The shard that key belongs to: the first whose upper bound is after it.
+*/
+template<class Key, class Value, class Compare>
+std::size_t ShardedAVLTree<Key, Value, Compare>::shardOf(const Bounds& bounds, const Key& key) const
+{
+    return std::upper_bound(bounds.begin(), bounds.end(), key, comp_) - bounds.begin();
+}
+
+/**
+* Locks the shard that key belongs to and returns it. The bounds cannot
+* be freed while they are being routed with, and if they were replaced
+* before the lock was taken, routing starts over with the new ones.
+*/
+template<class Key, class Value, class Compare>
+typename ShardedAVLTree<Key, Value, Compare>::Shard&
+ShardedAVLTree<Key, Value, Compare>::lockShard(const Key& key, std::unique_lock<std::mutex>& lock) const
+{
+    GracePeriod::Reader routing(routing_);
+    while (true) {
+      const Bounds* bounds = bounds_.load(std::memory_order_acquire);
+      Shard& shard = shards_[shardOf(*bounds, key)];
+      std::unique_lock<std::mutex> locked(shard.lock);
+      if (bounds_.load(std::memory_order_acquire) == bounds) {
+        lock.swap(locked);
+        return shard;
+      }
+    }
+}
+
+/**
+* Adds or overwrites an item. If the shard it went into is now much
+* larger than a neighbour, the boundary between the two is moved before
+* returning.
+*/
+template<class Key, class Value, class Compare>
+std::pair<typename ShardedAVLTree<Key, Value, Compare>::iterator, bool>
+ShardedAVLTree<Key, Value, Compare>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    std::size_t neighbour = shardCount_;
+    std::size_t i;
+    std::pair<typename ShardTree::iterator, bool> result;
+    {
+      std::unique_lock<std::mutex> lock;
+      Shard& shard = lockShard(keyValuePair.first, lock);
+      i = &shard - &shards_[0];
+      result = shard.tree.insert(keyValuePair);
+      if (result.second) {
+        shard.count.store(shard.count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        neighbour = skewedNeighbour(i);
+      }
+    }
+    if (neighbour == shardCount_) {
+      return std::make_pair(iterator(this, i, result.first), result.second);
+    }
+    rebalance(neighbour < i ? neighbour : i);
+    return std::make_pair(find(keyValuePair.first), true);
+}
+
+template<class Key, class Value, class Compare>
+void ShardedAVLTree<Key, Value, Compare>::remove(const Key& key)
+{
+    std::unique_lock<std::mutex> lock;
+    Shard& shard = lockShard(key, lock);
+    std::size_t before = shard.tree.size();
+    shard.tree.remove(key);
+    if (shard.tree.size() != before) {
+      shard.count.store(before - 1, std::memory_order_relaxed);
+    }
+}
+
+/**
+* Removes every item. The boundaries stay where they are.
+*/
+template<class Key, class Value, class Compare>
+void ShardedAVLTree<Key, Value, Compare>::clear()
+{
+    std::lock_guard<std::mutex> rebalancing(rebalanceLock_);
+    for (std::size_t i = 0; i < shardCount_; i++) {
+      std::lock_guard<std::mutex> lock(shards_[i].lock);
+      shards_[i].tree.clear();
+      shards_[i].count.store(0, std::memory_order_relaxed);
+    }
+}
+
+/**
+* Looks key up and copies its value into value. Safe to call at any
+* time from any thread.
+*/
+template<class Key, class Value, class Compare>
+bool ShardedAVLTree<Key, Value, Compare>::find(const Key& key, Value& value) const
+{
+    std::unique_lock<std::mutex> lock;
+    Shard& shard = lockShard(key, lock);
+    typename ShardTree::iterator it = shard.tree.find(key);
+    if (it == shard.tree.end()) {
+      return false;
+    }
+    value = it->second;
+    return true;
+}
+
+template<class Key, class Value, class Compare>
+typename ShardedAVLTree<Key, Value, Compare>::iterator
+ShardedAVLTree<Key, Value, Compare>::find(const Key& key) const
+{
+    std::unique_lock<std::mutex> lock;
+    Shard& shard = lockShard(key, lock);
+    typename ShardTree::iterator it = shard.tree.find(key);
+    if (it == shard.tree.end()) {
+      return end();
+    }
+    return iterator(this, &shard - &shards_[0], it);
+}
+
+template<class Key, class Value, class Compare>
+typename ShardedAVLTree<Key, Value, Compare>::iterator
+ShardedAVLTree<Key, Value, Compare>::begin() const
+{
+    iterator it(this, 0, shards_[0].tree.begin());
+    it.skipEmptyShards();
+    return it;
+}
+
+template<class Key, class Value, class Compare>
+typename ShardedAVLTree<Key, Value, Compare>::iterator
+ShardedAVLTree<Key, Value, Compare>::end() const
+{
+    return iterator(this, inUse_.load(std::memory_order_relaxed), typename ShardTree::iterator());
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value, class Compare>
+Value& ShardedAVLTree<Key, Value, Compare>::operator[](const Key& key)
+{
+    iterator it = find(key);
+    if(it == end()) throw std::out_of_range("Invalid key");
+    return it->second;
+}
+template<class Key, class Value, class Compare>
+Value const & ShardedAVLTree<Key, Value, Compare>::operator[](const Key& key) const
+{
+    iterator it = find(key);
+    if(it == end()) throw std::out_of_range("Invalid key");
+    return it->second;
+}
+
+/**
+* Returns true iff every shard is balanced and holds only keys within
+* its bounds.
+*/
+template<class Key, class Value, class Compare>
+bool ShardedAVLTree<Key, Value, Compare>::isBalanced() const
+{
+    std::lock_guard<std::mutex> rebalancing(rebalanceLock_);
+    const Bounds& bounds = *bounds_.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i < shardCount_; i++) {
+      Shard& shard = shards_[i];
+      std::lock_guard<std::mutex> lock(shard.lock);
+      if (!shard.tree.isBalanced() || shard.tree.size() != shard.count.load(std::memory_order_relaxed)) {
+        return false;
+      }
+      if (shard.tree.empty()) {
+        continue;
+      }
+      if (i > bounds.size()
+          || (i > 0 && comp_(shard.tree.begin()->first, bounds[i - 1]))
+          || (i < bounds.size() && !comp_((--shard.tree.end())->first, bounds[i]))) {
+        return false;
+      }
+    }
+    return true;
+}
+
+/**
+* True if a shard of larger items is worth evening out with one of
+* smaller items.
+*/
+template<class Key, class Value, class Compare>
+bool ShardedAVLTree<Key, Value, Compare>::skewed(std::size_t larger, std::size_t smaller) const
+{
+    return larger >= 2 * smaller + kMinRebalanceSize;
+}
+
+/**
+* Returns a neighbour of shard i (whose lock the caller holds) that i
+* has become too large for, preferring the smaller one, or shardCount_
+* if there is none. The shard after the last one in use counts as an
+* empty neighbour.
+*/
+template<class Key, class Value, class Compare>
+std::size_t ShardedAVLTree<Key, Value, Compare>::skewedNeighbour(std::size_t i) const
+{
+    std::size_t count = shards_[i].count.load(std::memory_order_relaxed);
+    std::size_t inUse = inUse_.load(std::memory_order_relaxed);
+    std::size_t best = shardCount_;
+    std::size_t bestCount = 0;
+    if (i > 0) {
+      best = i - 1;
+      bestCount = shards_[i - 1].count.load(std::memory_order_relaxed);
+    }
+    if (i + 1 < shardCount_) {
+      std::size_t nextCount = i + 1 < inUse ? shards_[i + 1].count.load(std::memory_order_relaxed) : 0;
+      if (best == shardCount_ || nextCount < bestCount) {
+        best = i + 1;
+        bestCount = nextCount;
+      }
+    }
+    if (best == shardCount_ || !skewed(count, bestCount)) {
+      return shardCount_;
+    }
+    return best;
+}
+
+/**
+* Evens out shards left and left + 1 if they are (still) skewed, taking
+* the latter into use if it is not yet. The larger one gives its items
+* nearest to the other away with a split() at the item select() finds,
+* and the two parts are joined onto their new shards. Skipped if another
+* rebalance is already running, that one will have been for good reason.
+*/
+template<class Key, class Value, class Compare>
+void ShardedAVLTree<Key, Value, Compare>::rebalance(std::size_t left)
+{
+    std::unique_lock<std::mutex> rebalancing(rebalanceLock_, std::try_to_lock);
+    if (!rebalancing.owns_lock()) {
+      return;
+    }
+    const Bounds* old = bounds_.load(std::memory_order_relaxed);
+    std::size_t inUse = old->size() + 1;
+    if (left + 1 >= shardCount_ || left + 1 > inUse) {
+      return;
+    }
+    std::unique_ptr<Bounds> fresh(new Bounds(*old));
+    fresh->reserve(inUse);
+    {
+      Shard& a = shards_[left];
+      Shard& b = shards_[left + 1];
+      std::lock_guard<std::mutex> lockA(a.lock);
+      std::lock_guard<std::mutex> lockB(b.lock);
+      std::size_t countA = a.tree.size();
+      std::size_t countB = b.tree.size();
+      if (!skewed(countA, countB) && !skewed(countB, countA)) {
+        return;
+      }
+      std::size_t keep = (countA + countB) / 2;
+      ShardTree less(comp_), greater(comp_);
+      if (countA > keep) {
+        Key bound = a.tree.select(keep)->first;
+        a.tree.split(bound, less, greater);
+        concat(a.tree, greater);
+        concat(a.tree, b.tree);
+        b.tree.swap(a.tree);
+        a.tree.swap(less);
+        if (left + 1 == inUse) {
+          fresh->push_back(bound);
+        } else {
+          (*fresh)[left] = bound;
+        }
+      } else {
+        Key bound = b.tree.select(keep - countA)->first;
+        b.tree.split(bound, less, greater);
+        concat(b.tree, greater);
+        concat(a.tree, less);
+        (*fresh)[left] = bound;
+      }
+      a.count.store(a.tree.size(), std::memory_order_relaxed);
+      b.count.store(b.tree.size(), std::memory_order_relaxed);
+      bounds_.store(fresh.release(), std::memory_order_release);
+      inUse_.store(inUse + (left + 1 == inUse ? 1 : 0), std::memory_order_relaxed);
+    }
+    // routing may still be looking at the old bounds
+    routing_.synchronize();
+    delete old;
+}
+
+/**
+* Appends the items of b (which must all come after those of a) to a,
+* leaving b empty: b's first item becomes the pivot of a join().
+*/
+template<class Key, class Value, class Compare>
+void ShardedAVLTree<Key, Value, Compare>::concat(ShardTree& a, ShardTree& b)
+{
+    if (b.empty()) {
+      return;
+    }
+    if (a.empty()) {
+      a.swap(b);
+      return;
+    }
+    std::pair<const Key, Value> pivot = *b.begin();
+    b.remove(pivot.first);
+    a.join(a, pivot, b);
+}
+
+/*
+-------------------------------------------------
+End implementations for the ShardedAVLTree class.
+-------------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,127 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <thread>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include "bst.h"
+#include "avlbst.h"
+#include "splaytree.h"
+
+using namespace std;
+
+// Compares AVLTree with SplayTree, splaying to the root and
+// semi-splaying, on lookups drawn from a Zipf distribution over the
+// keys, for each tree size given on the command line (1M, 4M and 16M by
+// default). The skewed lookups are timed once the tree has settled,
+// then a scan looks up every key once in random order, and the skewed
+// lookups right after it show how much of the hot set survived.
+
+typedef chrono::steady_clock Clock;
+
+static double msSince(Clock::time_point start)
+{
+    return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+template<typename Tree>
+uint64_t lookups(Tree& tree, const vector<uint64_t>& probes, size_t first, size_t count, double& ms)
+{
+    uint64_t checksum = 0;
+    Clock::time_point start = Clock::now();
+    for (size_t i = first; i < first + count; i++) {
+      checksum += tree.find(probes[i])->second;
+    }
+    ms = msSince(start);
+    return checksum;
+}
+
+template<typename Tree>
+void run(const char* name, Tree& tree, const vector<uint64_t>& keys, const vector<uint64_t>& probes, const vector<uint64_t>& scan)
+{
+    for (size_t i = 0; i < keys.size(); i++) {
+      tree.insert(make_pair(keys[i], i));
+    }
+    // warm up, then time the skewed lookups
+    size_t quarter = probes.size() / 4;
+    double warmMs, zipfMs, scanMs, afterMs;
+    uint64_t checksum = lookups(tree, probes, 0, quarter, warmMs);
+    checksum += lookups(tree, probes, quarter, 2 * quarter, zipfMs);
+    checksum += lookups(tree, scan, 0, scan.size(), scanMs);
+    // the first few hundred thousand lookups after the scan
+    size_t after = min(quarter, (size_t)200000);
+    checksum += lookups(tree, probes, 3 * quarter, after, afterMs);
+
+    cout << setw(16) << name << setw(10) << keys.size() << fixed << setprecision(2)
+         << setw(12) << 2 * quarter / zipfMs / 1000.0 << setw(12) << scan.size() / scanMs / 1000.0
+         << setw(14) << after / afterMs / 1000.0 << "   (checksum " << checksum << ")" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    vector<size_t> sizes;
+    for (int i = 1; i < argc; i++) {
+      sizes.push_back(strtoul(argv[i], NULL, 10));
+    }
+    if (sizes.empty()) {
+      sizes.push_back(1000000);
+      sizes.push_back(4000000);
+      sizes.push_back(16000000);
+    }
+    // with this exponent over 90% of the lookups go to the top 1% of
+    // the keys
+    const double exponent = 1.3;
+
+    cout << "hardware threads: " << thread::hardware_concurrency() << endl;
+    cout << "Zipf exponent " << exponent << ", throughput in M lookups/s" << endl;
+    cout << setw(16) << "tree" << setw(10) << "n" << setw(12) << "zipf"
+         << setw(12) << "cold scan" << setw(14) << "zipf after" << endl;
+    for (size_t s = 0; s < sizes.size(); s++) {
+      size_t n = sizes[s];
+      mt19937_64 rng(104);
+      vector<uint64_t> keys(n);
+      for (size_t i = 0; i < n; i++) {
+        keys[i] = i * 2654435761u;
+      }
+      shuffle(keys.begin(), keys.end(), rng);
+
+      // keys[r] is the key of popularity rank r
+      vector<double> cdf(n);
+      double total = 0;
+      for (size_t r = 0; r < n; r++) {
+        total += 1.0 / pow(double(r + 1), exponent);
+        cdf[r] = total;
+      }
+      cout << "top 1% of keys get " << setprecision(1) << fixed << 100.0 * cdf[n / 100] / total
+           << "% of the lookups" << endl;
+      uniform_real_distribution<double> uniform(0.0, total);
+      vector<uint64_t> probes(4000000);
+      for (size_t i = 0; i < probes.size(); i++) {
+        size_t r = lower_bound(cdf.begin(), cdf.end(), uniform(rng)) - cdf.begin();
+        probes[i] = keys[min(r, n - 1)];
+      }
+      vector<uint64_t> scan(keys);
+      shuffle(scan.begin(), scan.end(), rng);
+      vector<uint64_t> build(keys);
+      shuffle(build.begin(), build.end(), rng);
+
+      {
+        AVLTree<uint64_t, uint64_t> tree;
+        run("AVLTree", tree, build, probes, scan);
+      }
+      {
+        SplayTree<uint64_t, uint64_t> tree;
+        run("SplayTree", tree, build, probes, scan);
+      }
+      {
+        SplayTree<uint64_t, uint64_t> tree;
+        tree.setSplayMode(SplayTree<uint64_t, uint64_t>::kSemiSplay);
+        run("SplayTree/semi", tree, build, probes, scan);
+      }
+    }
+    return 0;
+}
@@ -0,0 +1,304 @@
+#ifndef SPLAYTREE_H
+#define SPLAYTREE_H
+
+#include <functional>
+#include <stdexcept>
+#include <utility>
+#include "bst.h"
+
+/**
+* A self-adjusting search tree: find() and insertions move the item
+* they reach towards the root with splay steps, and removals splay the
+* parent of the node taken out, so keys that are used often end up a
+* few levels from the root whatever the size of the tree. It uses
+* plain BST nodes and keeps no balance data; a splay tree's cost
+* bounds are amortized, and single operations can take O(n).
+*
+* By default every access splays the node all the way to the root.
+* With setSplayMode(kSemiSplay) the tree semi-splays instead (Sleator
+* and Tarjan): the accessed node only rises to about half its depth,
+* so a key that is used once disturbs the keys near the root less,
+* while keys used again and again still climb to the top. The amortized
+* bounds are the same.
+*
+* Only the non-const find() and operator[] splay. Iteration, the const
+* lookups and the ordered searches of the BST leave the tree as it is,
+* so a scan through them evicts nothing, and they are safe on a const
+* tree shared between readers.
+*/
+template <class Key, class Value, class Compare = std::less<Key> >
+class SplayTree : public BinarySearchTree<Key, Value, Compare>
+{
+public:
+    SplayTree();
+    explicit SplayTree(const Compare& comp);
+    template<typename ForwardIterator>
+    SplayTree(ForwardIterator first, ForwardIterator last, const Compare& comp = Compare());
+    SplayTree(const SplayTree& other);
+    SplayTree(SplayTree&& other);
+    SplayTree& operator=(const SplayTree& other);
+    SplayTree& operator=(SplayTree&& other);
+    void swap(SplayTree& other);
+
+    /**
+    * The BST iterator, which find() has to make from the node it
+    * splayed. Every BST iterator converts to it.
+    */
+    class iterator : public BinarySearchTree<Key, Value, Compare>::iterator
+    {
+    public:
+        iterator();
+        iterator(const typename BinarySearchTree<Key, Value, Compare>::iterator& it);
+
+    protected:
+        friend class SplayTree<Key, Value, Compare>;
+        iterator(Node<Key, Value>* ptr, const SplayTree<Key, Value, Compare>* tree);
+    };
+
+    // Lookups that splay the item they find
+    using BinarySearchTree<Key, Value, Compare>::find;
+    using BinarySearchTree<Key, Value, Compare>::operator[];
+    iterator find(const Key& key);
+    Value& operator[](const Key& key);
+
+    // How far an access lifts a node: to the root (the default), or
+    // semi-splayed to about half its depth
+    enum SplayMode { kFullSplay, kSemiSplay };
+    void setSplayMode(SplayMode mode);
+    SplayMode splayMode() const;
+
+protected:
+    void splay(Node<Key, Value>* node);
+
+    virtual void insertFixup(Node<Key, Value>* node);
+    virtual void eraseNode(Node<Key, Value>* node);
+
+    SplayMode mode_;
+};
+
+/*
+----------------------------------------------
+Begin implementations for the SplayTree class.
+----------------------------------------------
+*/
+
+template<class Key, class Value, class Compare>
+SplayTree<Key, Value, Compare>::SplayTree() :
+    mode_(kFullSplay)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+SplayTree<Key, Value, Compare>::SplayTree(const Compare& comp) :
+    BinarySearchTree<Key, Value, Compare>(comp), mode_(kFullSplay)
+{
+
+}
+
+/**
+* Constructs a tree holding the items of a sorted range in O(n),
+* see BinarySearchTree::assign(). It starts out balanced.
+*/
+template<class Key, class Value, class Compare>
+template<typename ForwardIterator>
+SplayTree<Key, Value, Compare>::SplayTree(ForwardIterator first, ForwardIterator last, const Compare& comp) :
+    BinarySearchTree<Key, Value, Compare>(first, last, comp), mode_(kFullSplay)
+{
+
+}
+
+/**
+* Copy constructor, which copies the shape of other and its mode.
+*/
+template<class Key, class Value, class Compare>
+SplayTree<Key, Value, Compare>::SplayTree(const SplayTree& other) :
+    BinarySearchTree<Key, Value, Compare>(other), mode_(other.mode_)
+{
+
+}
+
+/**
+* Move constructor, O(1). other is left empty.
+*/
+template<class Key, class Value, class Compare>
+SplayTree<Key, Value, Compare>::SplayTree(SplayTree&& other) :
+    BinarySearchTree<Key, Value, Compare>(std::move(other)), mode_(other.mode_)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+SplayTree<Key, Value, Compare>& SplayTree<Key, Value, Compare>::operator=(const SplayTree& other)
+{
+    BinarySearchTree<Key, Value, Compare>::operator=(other);
+    mode_ = other.mode_;
+    return *this;
+}
+
+template<class Key, class Value, class Compare>
+SplayTree<Key, Value, Compare>& SplayTree<Key, Value, Compare>::operator=(SplayTree&& other)
+{
+    BinarySearchTree<Key, Value, Compare>::operator=(std::move(other));
+    mode_ = other.mode_;
+    return *this;
+}
+
+/**
+* Exchanges the contents and modes of two trees in O(1), see
+* BinarySearchTree::swap().
+*/
+template<class Key, class Value, class Compare>
+void SplayTree<Key, Value, Compare>::swap(SplayTree& other)
+{
+    BinarySearchTree<Key, Value, Compare>::swap(other);
+    std::swap(mode_, other.mode_);
+}
+
+/**
+* Non-member swap, so that swap(a, b) finds the O(1) version.
+*/
+template<class Key, class Value, class Compare>
+void swap(SplayTree<Key, Value, Compare>& a, SplayTree<Key, Value, Compare>& b)
+{
+    a.swap(b);
+}
+
+/**
+* Default constructor, which makes an end() iterator.
+*/
+template<class Key, class Value, class Compare>
+SplayTree<Key, Value, Compare>::iterator::iterator()
+{
+
+}
+
+/**
+* Converts any iterator of the underlying BST, e.g. the result of insert().
+*/
+template<class Key, class Value, class Compare>
+SplayTree<Key, Value, Compare>::iterator::iterator(const typename BinarySearchTree<Key, Value, Compare>::iterator& it) :
+    BinarySearchTree<Key, Value, Compare>::iterator(it)
+{
+
+}
+
+/**
+* Constructor that points the iterator at the given node.
+*/
+template<class Key, class Value, class Compare>
+SplayTree<Key, Value, Compare>::iterator::iterator(Node<Key, Value>* ptr, const SplayTree<Key, Value, Compare>* tree)
+{
+    this->current_ = ptr;
+    this->tree_ = tree;
+}
+
+/**
+* Finds key and splays its node, see setSplayMode().
+*/
+template<class Key, class Value, class Compare>
+typename SplayTree<Key, Value, Compare>::iterator
+SplayTree<Key, Value, Compare>::find(const Key& key)
+{
+    Node<Key, Value>* node = this->internalFind(key);
+    if (node != NULL) {
+      splay(node);
+    }
+    return iterator(node, this);
+}
+
+/**
+ * @precondition The key exists in the tree
+ * Returns the value associated with the key, after splaying it
+ */
+template<class Key, class Value, class Compare>
+Value& SplayTree<Key, Value, Compare>::operator[](const Key& key)
+{
+    Node<Key, Value>* node = this->internalFind(key);
+    if(node == NULL) throw std::out_of_range("Invalid key");
+    splay(node);
+    return node->getValue();
+}
+
+template<class Key, class Value, class Compare>
+void SplayTree<Key, Value, Compare>::setSplayMode(SplayMode mode)
+{
+    mode_ = mode;
+}
+
+template<class Key, class Value, class Compare>
+typename SplayTree<Key, Value, Compare>::SplayMode SplayTree<Key, Value, Compare>::splayMode() const
+{
+    return mode_;
+}
+
+/**
+* Lifts node by splay steps: zig-zig (rotate the parent, then node)
+* when node and its parent are on the same side, zig-zag (rotate node
+* twice) when they aren't, and a single zig below the root. A semi-splay
+* leaves out the second rotation of a zig-zig and carries on from the
+* parent, which roughly halves the depth of everything on the path
+* instead of bringing node to the top.
+*/
+template<class Key, class Value, class Compare>
+void SplayTree<Key, Value, Compare>::splay(Node<Key, Value>* node)
+{
+    while (node->getParent() != NULL) {
+      Node<Key, Value>* parent = node->getParent();
+      Node<Key, Value>* grand = parent->getParent();
+      if (grand == NULL) {
+        this->rotateUp(node);
+      } else if ((grand->getLeft() == parent) == (parent->getLeft() == node)) {
+        this->rotateUp(parent);
+        if (mode_ == kSemiSplay) {
+          node = parent;
+        } else {
+          this->rotateUp(node);
+        }
+      } else {
+        this->rotateUp(node);
+        this->rotateUp(node);
+      }
+    }
+}
+
+/**
+* Every insertion path of the BST ends here, so new nodes are splayed.
+*/
+template<class Key, class Value, class Compare>
+void SplayTree<Key, Value, Compare>::insertFixup(Node<Key, Value>* node)
+{
+    splay(node);
+}
+
+/**
+* Removes the node as the BST does (a node with two children trades
+* places with its predecessor first), then splays the node that the
+* removal happened under.
+*/
+template<class Key, class Value, class Compare>
+void SplayTree<Key, Value, Compare>::eraseNode(Node<Key, Value>* node)
+{
+    if (node == NULL) {
+      return;
+    }
+    Node<Key, Value>* above = node->getParent();
+    if (node->getLeft() != NULL && node->getRight() != NULL) {
+      Node<Key, Value>* before = this->predecessor(node);
+      // the predecessor takes node's place, and node is spliced out
+      // below where the predecessor was
+      above = before->getParent() == node ? before : before->getParent();
+    }
+    BinarySearchTree<Key, Value, Compare>::eraseNode(node);
+    if (above != NULL) {
+      splay(above);
+    }
+}
+
+/*
+--------------------------------------------
+End implementations for the SplayTree class.
+--------------------------------------------
+*/
+
+#endif